@@ -9,6 +9,9 @@
 #include <chrono>
 #include <limits.h>
 #include <functional>
+#include <string>
+#include <string_view>
+#include <cstdlib>
 
 #include <imgui.h>
 #include <imgui_impl_sdl2.h>
@@ -17,45 +20,127 @@
 
 #include "debug/Logging.h"
 #include "debug/Assertions.h"
+#include "utils/CpuProfiler.h"
 
 namespace {
 	constexpr int WINDOW_WIDTH{ 1920 / 2 };
 	constexpr int WINDOW_HEIGHT{ 1080 / 2 };
 
+	constexpr uint64_t DEFAULT_HEADLESS_FRAME_COUNT{ 1000 };
+
+	// written when F3 is pressed
+	constexpr const char* CPU_TRACE_PATH{ "cpu_trace.json" };
+
 	struct KeyState {
 		std::vector<SDL_Scancode> keysPressed;
 		std::vector<SDL_Scancode> keysLifted;
 	};
 
+	struct EngineConfig {
+		bool headless{};
+		uint32_t width{ WINDOW_WIDTH };
+		uint32_t height{ WINDOW_HEIGHT };
+
+		// headless run limits, 0 means unbounded
+		uint64_t maxFrames{};
+		float maxSeconds{};
+
+		uint32_t framesInFlight{ 2 };
+		uint32_t recordThreads{};
+		VulkanRenderer::PresentMode presentMode{
+			VulkanRenderer::PresentMode::mailbox
+		};
+
+		// written on shutdown when set
+		std::string gpuTracePath;
+		std::string cpuTracePath;
+
+		bool cpuProfiler{ true };
+
+		// empty starts every run with a cold pipeline cache
+		std::string pipelineCachePath{ "pipeline_cache.bin" };
+
+		bool shaderHotReload{};
+
+		std::string workgroupCachePath{ "workgroup_sizes.txt" };
+		bool retuneWorkgroups{};
+
+		// in MiB
+		uint64_t textureBudget{ 512 };
+		uint64_t defragmentBudget{ 8 };
+	};
+
+	// frames of the current one second report window
+	struct FrameRate {
+		std::chrono::high_resolution_clock::time_point startTime;
+		int framesRendered;
+	};
+
 	struct AppState {
 		SDL_Window* window;
 		KeyState keyState;
+		EngineConfig config;
 	};
 
 	AppState* s_AppState{};
+
+	EngineConfig parseArgs(int argc, char* argv[]);
+	std::optional<VulkanRenderer::PresentMode>
+		parsePresentMode(std::string_view name);
+
+	void runWindowed(AppState& state);
+	void runHeadless(AppState& state);
+	// counts a frame that ended at frameEndTime, prints once a second
+	void reportFrameRate(
+		FrameRate& frameRate,
+		const std::chrono::high_resolution_clock::time_point frameEndTime
+	);
 }  // namespace
 
-void CAEngine::startup() {
+void CAEngine::startup(int argc, char* argv[]) {
+	EngineConfig config{ parseArgs(argc, argv) };
+
+	CpuProfiler::setEnabled(config.cpuProfiler);
+	CpuProfiler::setThreadName("main");
+	CPU_ZONE("startup");
+
 	if (SDL_Init(SDL_INIT_EVENTS) != 0) {
 		std::cerr << "could not init sdl: " << SDL_GetError() << std::endl;
 	}
 
-	SDL_Window* window{ SDL_CreateWindow(
-		"vulkan :D",
-		SDL_WINDOWPOS_UNDEFINED,
-		SDL_WINDOWPOS_UNDEFINED,
-		WINDOW_WIDTH,
-		WINDOW_HEIGHT,
-		SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE
-	) };
-	assertFatal(window, "window could not be created: ", SDL_GetError());
+	SDL_Window* window{};
+	if (!config.headless) {
+		window = SDL_CreateWindow(
+			"vulkan :D",
+			SDL_WINDOWPOS_UNDEFINED,
+			SDL_WINDOWPOS_UNDEFINED,
+			config.width,
+			config.height,
+			SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE
+		);
+		assertFatal(window, "window could not be created: ", SDL_GetError());
 
-	ImGui::CreateContext();
+		ImGui::CreateContext();
+	}
 
 	auto startTime{ std::chrono::high_resolution_clock::now() };
 	auto fpsTime{ startTime };
 
-	VulkanRenderer::init(window);
+	VulkanRenderer::RendererSettings rendererSettings{
+		.headless = config.headless,
+		.renderWidth = config.width,
+		.renderHeight = config.height,
+		.framesInFlight = config.framesInFlight,
+		.presentMode = config.presentMode,
+		.recordThreads = config.recordThreads,
+		.pipelineCachePath = config.pipelineCachePath,
+		.shaderHotReload = config.shaderHotReload,
+		.workgroupCachePath = config.workgroupCachePath,
+		.retuneWorkgroups = config.retuneWorkgroups,
+		.textureBudget = config.textureBudget * 1024 * 1024,
+		.defragmentBytesPerFrame = config.defragmentBudget * 1024 * 1024,
+	};
+	VulkanRenderer::init(window, rendererSettings);
 
 	auto currentTime{ std::chrono::high_resolution_clock::now() };
 	float duration{
@@ -68,65 +153,272 @@ void CAEngine::startup() {
 	fpsTime = currentTime;
 	std::cout << "vulkan init: " << duration << "ms" << std::endl;
 
-	s_AppState = new AppState{ .window = window };
+	s_AppState = new AppState{ .window = window, .config = config };
 }
 
 void CAEngine::run() {
 	AppState& state{ *s_AppState };
 
-	SDL_Event event{};
-	bool running{ true };
+	if (state.config.headless) {
+		runHeadless(state);
+	} else {
+		runWindowed(state);
+	}
+}
 
-	int framesRendered{};
+void CAEngine::shutdown() {
+	AppState& state{ *s_AppState };
 
-	auto frameStartTime{ std::chrono::high_resolution_clock::now() };
-	while (running) {
-		while (SDL_PollEvent(&event)) {
-			switch (event.type) {
-				case SDL_QUIT:
-					running = false;
-					break;
-				case SDL_KEYDOWN:
-					if (event.key.keysym.scancode == SDL_SCANCODE_TAB) {
-						running = false;
+	if (!state.config.gpuTracePath.empty()) {
+		VulkanRenderer::exportGpuTrace(state.config.gpuTracePath);
+	}
+	if (!state.config.cpuTracePath.empty()) {
+		CpuProfiler::writeTrace(state.config.cpuTracePath);
+	}
+	VulkanRenderer::cleanup();
+
+	if (!state.config.headless) {
+		SDL_DestroyWindow(state.window);
+
+		ImGui_ImplSDL2_Shutdown();
+		ImGui::DestroyContext();
+	}
+	SDL_Quit();
+
+	delete s_AppState;
+	s_AppState = nullptr;
+}
+
+namespace {
+	EngineConfig parseArgs(int argc, char* argv[]) {
+		EngineConfig config{};
+
+		for (int i{ 1 }; i < argc; i++) {
+			std::string_view arg{ argv[i] };
+			bool hasValue{ i + 1 < argc };
+
+			if (arg == "--headless") {
+				config.headless = true;
+			} else if (arg == "--width" && hasValue) {
+				config.width = std::strtoul(argv[++i], nullptr, 10);
+			} else if (arg == "--height" && hasValue) {
+				config.height = std::strtoul(argv[++i], nullptr, 10);
+			} else if (arg == "--frames" && hasValue) {
+				config.maxFrames = std::strtoull(argv[++i], nullptr, 10);
+			} else if (arg == "--seconds" && hasValue) {
+				config.maxSeconds = std::strtof(argv[++i], nullptr);
+			} else if (arg == "--gpu-trace" && hasValue) {
+				config.gpuTracePath = argv[++i];
+			} else if (arg == "--cpu-trace" && hasValue) {
+				config.cpuTracePath = argv[++i];
+			} else if (arg == "--no-cpu-profiler") {
+				config.cpuProfiler = false;
+			} else if (arg == "--pipeline-cache" && hasValue) {
+				config.pipelineCachePath = argv[++i];
+			} else if (arg == "--no-pipeline-cache") {
+				config.pipelineCachePath.clear();
+			} else if (arg == "--hot-reload") {
+				config.shaderHotReload = true;
+			} else if (arg == "--workgroup-cache" && hasValue) {
+				config.workgroupCachePath = argv[++i];
+			} else if (arg == "--retune") {
+				config.retuneWorkgroups = true;
+			} else if (arg == "--record-threads" && hasValue) {
+				config.recordThreads = std::strtoul(argv[++i], nullptr, 10);
+			} else if (arg == "--texture-budget" && hasValue) {
+				config.textureBudget = std::strtoull(argv[++i], nullptr, 10);
+			} else if (arg == "--defrag-budget" && hasValue) {
+				config.defragmentBudget =
+					std::strtoull(argv[++i], nullptr, 10);
+			} else if (arg == "--frames-in-flight" && hasValue) {
+				config.framesInFlight = std::strtoul(argv[++i], nullptr, 10);
+			} else if (arg == "--present-mode" && hasValue) {
+				std::string_view name{ argv[++i] };
+				auto presentMode{ parsePresentMode(name) };
+				if (presentMode) {
+					config.presentMode = *presentMode;
+				} else {
+					logWarning("unknown present mode: ", name);
+				}
+			} else {
+				logWarning("unknown argument: ", arg);
+			}
+		}
+
+		if (config.width == 0 || config.height == 0) {
+			logWarning("render size cannot be 0, using default");
+			config.width = WINDOW_WIDTH;
+			config.height = WINDOW_HEIGHT;
+		}
+
+		if (config.framesInFlight == 0) {
+			logWarning("frames in flight cannot be 0, using 1");
+			config.framesInFlight = 1;
+		}
+
+		if (config.headless && config.maxFrames == 0 &&
+			config.maxSeconds <= 0.f) {
+			config.maxFrames = DEFAULT_HEADLESS_FRAME_COUNT;
+		}
+
+		return config;
+	}
+
+	std::optional<VulkanRenderer::PresentMode>
+		parsePresentMode(std::string_view name) {
+		if (name == "mailbox") {
+			return VulkanRenderer::PresentMode::mailbox;
+		} else if (name == "fifo") {
+			return VulkanRenderer::PresentMode::fifo;
+		} else if (name == "fifo-relaxed") {
+			return VulkanRenderer::PresentMode::fifoRelaxed;
+		} else if (name == "immediate") {
+			return VulkanRenderer::PresentMode::immediate;
+		}
+
+		return {};
+	}
+
+	void runWindowed(AppState& state) {
+		SDL_Event event{};
+		bool running{ true };
+		bool minimized{};
+
+		FrameRate frameRate{ .startTime =
+								 std::chrono::high_resolution_clock::now() };
+		while (running) {
+			CPU_ZONE("frame");
+
+			{
+				CPU_ZONE("events");
+
+				// a minimized window has nothing to present, block until the
+				// next event instead of spinning
+				bool hasEvent{ minimized ? SDL_WaitEvent(&event) != 0
+										 : SDL_PollEvent(&event) != 0 };
+				while (hasEvent) {
+					switch (event.type) {
+						case SDL_QUIT:
+							running = false;
+							break;
+						case SDL_KEYDOWN:
+							if (event.key.keysym.scancode == SDL_SCANCODE_TAB) {
+								running = false;
+							} else if (event.key.keysym.scancode ==
+									   SDL_SCANCODE_F3) {
+								CpuProfiler::writeTrace(CPU_TRACE_PATH);
+							}
+							break;
+						case SDL_WINDOWEVENT:
+							switch (event.window.event) {
+								case SDL_WINDOWEVENT_SIZE_CHANGED:
+									VulkanRenderer::onWindowResized();
+									break;
+								case SDL_WINDOWEVENT_MINIMIZED:
+									minimized = true;
+									break;
+								case SDL_WINDOWEVENT_RESTORED:
+								case SDL_WINDOWEVENT_MAXIMIZED:
+									minimized = false;
+									break;
+								default:
+									break;
+							}
+							break;
+						default:
+							break;
 					}
-					break;
-				case SDL_WINDOWEVENT_RESIZED:
-				default:
-					break;
+
+					ImGui_ImplSDL2_ProcessEvent(&event);
+					hasEvent = SDL_PollEvent(&event) != 0;
+				}
+			}
+
+			if (minimized) {
+				continue;
 			}
 
-			ImGui_ImplSDL2_ProcessEvent(&event);
+			ImGui_ImplSDL2_NewFrame();
+			VulkanRenderer::renderFrame(state.window);
+			reportFrameRate(
+				frameRate, std::chrono::high_resolution_clock::now()
+			);
 		}
+	}
+
+	void runHeadless(AppState& state) {
+		const EngineConfig& config{ state.config };
+
+		SDL_Event event{};
+		bool running{ true };
+
+		uint64_t totalFrames{};
+
+		auto runStartTime{ std::chrono::high_resolution_clock::now() };
+		FrameRate frameRate{ .startTime = runStartTime };
+		while (running) {
+			CPU_ZONE("frame");
+
+			// SDL turns SIGINT / SIGTERM into SDL_QUIT
+			while (SDL_PollEvent(&event)) {
+				if (event.type == SDL_QUIT) {
+					running = false;
+				}
+			}
 
-		ImGui_ImplSDL2_NewFrame();
-		VulkanRenderer::renderFrame(state.window);
-		framesRendered++;
+			VulkanRenderer::renderFrame(nullptr);
+			totalFrames++;
+
+			auto frameEndTime{ std::chrono::high_resolution_clock::now() };
+			reportFrameRate(frameRate, frameEndTime);
+
+			float runDuration{
+				std::chrono::duration<float, std::chrono::seconds::period>(
+					frameEndTime - runStartTime
+				)
+					.count()
+			};
+			if (config.maxFrames && totalFrames >= config.maxFrames) {
+				running = false;
+			}
+			if (config.maxSeconds > 0.f && runDuration >= config.maxSeconds) {
+				running = false;
+			}
+		}
+
+		auto runEndTime{ std::chrono::high_resolution_clock::now() };
+		float runDuration{
+			std::chrono::duration<float, std::chrono::seconds::period>(
+				runEndTime - runStartTime
+			)
+				.count()
+		};
+		std::cout << "headless run: " << totalFrames << " frames at "
+				  << config.width << "x" << config.height << " in "
+				  << runDuration << "s | ms per frame: "
+				  << (runDuration / totalFrames) * 1000
+				  << " | frames per second: " << totalFrames / runDuration
+				  << std::endl;
+	}
+
+	void reportFrameRate(
+		FrameRate& frameRate,
+		const std::chrono::high_resolution_clock::time_point frameEndTime
+	) {
+		frameRate.framesRendered++;
 
-		auto frameEndTime{ std::chrono::high_resolution_clock::now() };
 		float duration{
 			std::chrono::duration<float, std::chrono::seconds::period>(
-				frameEndTime - frameStartTime
+				frameEndTime - frameRate.startTime
 			)
 				.count()
 		};
 		if (duration >= 1) {
-			frameStartTime = frameEndTime;
-			std::cout << "frames renderered: " << framesRendered
-					  << " | ms per frame: " << (1.f / framesRendered) * 1000
-					  << std::endl;
-			framesRendered = 0;
+			frameRate.startTime = frameEndTime;
+			std::cout << "frames renderered: " << frameRate.framesRendered
+					  << " | ms per frame: "
+					  << (1.f / frameRate.framesRendered) * 1000 << std::endl;
+			frameRate.framesRendered = 0;
 		}
 	}
-}
-
-void CAEngine::shutdown() {
-	AppState& state{ *s_AppState };
-
-	VulkanRenderer::cleanup();
-	SDL_DestroyWindow(state.window);
-
-	ImGui_ImplSDL2_Shutdown();
-	ImGui::DestroyContext();
-	SDL_Quit();
-}
+}  // namespace
@@ -1,7 +1,7 @@
 #pragma once
 
 namespace CAEngine {
-	void startup();
+	void startup(int argc, char* argv[]);
 	void run();
 	void shutdown();
 }
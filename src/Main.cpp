@@ -2,7 +2,7 @@
 #include "CAEngine/CAEngine.h"
 
 int main(int argc, char* argv[]) {
-	CAEngine::startup();
+	CAEngine::startup(argc, argv);
 
 	CAEngine::run();
 
@@ -0,0 +1,596 @@
+#include "RendererPCH.h"
+
+#include "AsyncUploader.h"
+
+#include "debug/Debug.h"
+
+#include "vkutils/Synchronization.h"
+#include "Context.h"
+#include "DefaultCreateInfos.h"
+
+#include <array>
+#include <cstring>
+
+using namespace VulkanRenderer;
+
+namespace {
+	// staging is handed out from chunks of this size, bigger uploads get a
+	// buffer of their own
+	constexpr VkDeviceSize STAGING_CHUNK_SIZE{ 16 * 1024 * 1024 };
+	// covers the texel size of every uncompressed format and the 4 byte
+	// alignment of buffer to image copies
+	constexpr VkDeviceSize STAGING_ALIGNMENT{ 16 };
+	// chunks kept around after a burst of uploads, the rest are freed
+	constexpr size_t MAX_FREE_CHUNKS{ 4 };
+
+	struct StagingRange {
+		VkBuffer buffer;
+		VkDeviceSize offset;
+	};
+
+	StagingRange writeStaging(
+		const VulkanContext& ctx,
+		AsyncUploader& uploader,
+		const std::span<const char> data
+	);
+
+	VkCommandPool createUploadCommandPool(
+		const VulkanContext& ctx, const uint32_t family
+	);
+	VkCommandBuffer getCommandBuffer(
+		const VulkanContext& ctx,
+		const VkCommandPool pool,
+		std::vector<VkCommandBuffer>& freeCmdBuffers
+	);
+
+	void submitBatch(const VulkanContext& ctx, AsyncUploader& uploader);
+	void acquireFinishedBatches(
+		const VulkanContext& ctx, AsyncUploader& uploader
+	);
+	void retireBatches(const VulkanContext& ctx, AsyncUploader& uploader);
+	void destroyBatch(const VulkanContext& ctx, UploadBatch& batch);
+
+	// the ownership transfer half of a copy's barrier, without stages and
+	// accesses
+	VkBufferMemoryBarrier2 getOwnershipBarrier(
+		const AsyncUploader& uploader, const PendingBufferCopy& copy
+	);
+	VkImageMemoryBarrier2 getOwnershipBarrier(
+		const AsyncUploader& uploader, const PendingImageCopy& copy
+	);
+
+	void cmdBarriers(
+		VkCommandBuffer cmdBuffer,
+		const std::span<const VkBufferMemoryBarrier2> bufferBarriers,
+		const std::span<const VkImageMemoryBarrier2> imageBarriers
+	);
+
+	bool isSameFamily(const AsyncUploader& uploader);
+	VkDeviceSize
+		alignUp(const VkDeviceSize value, const VkDeviceSize alignment);
+}  // namespace
+
+AsyncUploader VulkanRenderer::createAsyncUploader(
+	const VulkanContext& ctx,
+	const VkQueue transferQueue,
+	const VkQueue graphicsQueue
+) {
+	const QueueFamilyIndices& familyIndices{ ctx.device.queueFamilyIndices };
+
+	AsyncUploader uploader{
+		.transfer = { .queue = transferQueue,
+					  .familyIndex = familyIndices.transferIndex,
+					  .timeline = vkutils::createTimelineSemaphore(ctx, 0) },
+		.graphicsQueue = graphicsQueue,
+		.graphicsFamilyIndex = familyIndices.graphicsIndex,
+		.acquireTimeline = vkutils::createTimelineSemaphore(ctx, 0),
+		.transferPool =
+			createUploadCommandPool(ctx, familyIndices.transferIndex),
+		.graphicsPool =
+			createUploadCommandPool(ctx, familyIndices.graphicsIndex),
+		.open = { .value = 1 },
+	};
+
+	return uploader;
+}
+
+void VulkanRenderer::destroyAsyncUploader(
+	const VulkanContext& ctx, AsyncUploader& uploader
+) {
+	destroyBatch(ctx, uploader.open);
+	for (auto& batch : uploader.submitted) {
+		destroyBatch(ctx, batch);
+	}
+	uploader.submitted.clear();
+
+	for (const auto& chunk : uploader.freeChunks) {
+		destroyBuffer(ctx, chunk);
+	}
+	uploader.freeChunks.clear();
+
+	vkDestroyCommandPool(ctx.device.logical, uploader.transferPool, nullptr);
+	vkDestroyCommandPool(ctx.device.logical, uploader.graphicsPool, nullptr);
+	vkDestroySemaphore(
+		ctx.device.logical, uploader.transfer.timeline, nullptr
+	);
+	vkDestroySemaphore(ctx.device.logical, uploader.acquireTimeline, nullptr);
+}
+
+UploadTicket VulkanRenderer::enqueueBufferUpload(
+	const VulkanContext& ctx,
+	AsyncUploader& uploader,
+	const VkBuffer dst,
+	const VkDeviceSize dstOffset,
+	const std::span<const char> data
+) {
+	if (data.empty()) {
+		return {};
+	}
+
+	StagingRange staging{ writeStaging(ctx, uploader, data) };
+	uploader.open.bufferCopies.emplace_back(PendingBufferCopy{
+		.src = staging.buffer,
+		.dst = dst,
+		.region = { .srcOffset = staging.offset,
+					.dstOffset = dstOffset,
+					.size = data.size() },
+	});
+
+	return { .value = uploader.open.value };
+}
+
+UploadTicket VulkanRenderer::enqueueImageUpload(
+	const VulkanContext& ctx,
+	AsyncUploader& uploader,
+	const ImageUpload& upload
+) {
+	if (upload.data.empty()) {
+		return {};
+	}
+
+	StagingRange staging{ writeStaging(ctx, uploader, upload.data) };
+	uploader.open.imageCopies.emplace_back(PendingImageCopy{
+		.src = staging.buffer,
+		.dst = upload.image,
+		.region = { .bufferOffset = staging.offset,
+					.imageSubresource = { .aspectMask = upload.aspect,
+										  .mipLevel = upload.mipLevel,
+										  .baseArrayLayer = upload.arrayLayer,
+										  .layerCount = 1 },
+					.imageExtent = upload.extent },
+		.finalLayout = upload.finalLayout,
+	});
+
+	return { .value = uploader.open.value };
+}
+
+void VulkanRenderer::updateUploads(
+	const VulkanContext& ctx, AsyncUploader& uploader
+) {
+	retireBatches(ctx, uploader);
+	submitBatch(ctx, uploader);
+	acquireFinishedBatches(ctx, uploader);
+}
+
+bool VulkanRenderer::isUploadComplete(
+	const AsyncUploader& uploader, const UploadTicket ticket
+) {
+	return ticket.value <= uploader.acquiredValue;
+}
+
+void VulkanRenderer::waitForUpload(
+	const VulkanContext& ctx,
+	AsyncUploader& uploader,
+	const UploadTicket ticket
+) {
+	if (isUploadComplete(uploader, ticket)) {
+		return;
+	}
+
+	if (ticket.value > uploader.transfer.value) {
+		submitBatch(ctx, uploader);
+	}
+
+	vkutils::waitForTimeline(ctx, uploader.transfer.timeline, ticket.value);
+	acquireFinishedBatches(ctx, uploader);
+}
+
+namespace {
+	StagingRange writeStaging(
+		const VulkanContext& ctx,
+		AsyncUploader& uploader,
+		const std::span<const char> data
+	) {
+		UploadBatch& batch{ uploader.open };
+
+		if (data.size() > STAGING_CHUNK_SIZE) {
+			Buffer buffer{ createBuffer(
+				ctx,
+				data.size(),
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				BufferMemory::upload,
+				MemoryCategory::staging
+			) };
+			std::memcpy(buffer.mapped, data.data(), data.size());
+			batch.dedicated.emplace_back(buffer);
+
+			return { .buffer = buffer.handle, .offset = 0 };
+		}
+
+		VkDeviceSize offset{ alignUp(batch.chunkUsed, STAGING_ALIGNMENT) };
+		if (batch.chunks.empty() || offset + data.size() > STAGING_CHUNK_SIZE) {
+			if (!uploader.freeChunks.empty()) {
+				batch.chunks.emplace_back(uploader.freeChunks.back());
+				uploader.freeChunks.pop_back();
+			} else {
+				batch.chunks.emplace_back(createBuffer(
+					ctx,
+					STAGING_CHUNK_SIZE,
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					BufferMemory::upload,
+					MemoryCategory::staging
+				));
+			}
+			offset = 0;
+		}
+
+		const Buffer& chunk{ batch.chunks.back() };
+		std::memcpy((char*)chunk.mapped + offset, data.data(), data.size());
+		batch.chunkUsed = offset + data.size();
+
+		return { .buffer = chunk.handle, .offset = offset };
+	}
+
+	VkCommandPool createUploadCommandPool(
+		const VulkanContext& ctx, const uint32_t family
+	) {
+		VkCommandPoolCreateInfo poolCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+			.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+					 VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+			.queueFamilyIndex = family,
+		};
+
+		VkCommandPool pool{};
+		if (vkCreateCommandPool(
+				ctx.device.logical, &poolCreateInfo, nullptr, &pool
+			) != VK_SUCCESS) {
+			logFatal("could not create upload command pool");
+		}
+
+		return pool;
+	}
+
+	VkCommandBuffer getCommandBuffer(
+		const VulkanContext& ctx,
+		const VkCommandPool pool,
+		std::vector<VkCommandBuffer>& freeCmdBuffers
+	) {
+		if (!freeCmdBuffers.empty()) {
+			VkCommandBuffer cmdBuffer{ freeCmdBuffers.back() };
+			freeCmdBuffers.pop_back();
+			return cmdBuffer;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+
+		VkCommandBuffer cmdBuffer{};
+		CHECK_VK_FATAL(
+			vkAllocateCommandBuffers(ctx.device.logical, &allocInfo, &cmdBuffer)
+		);
+
+		return cmdBuffer;
+	}
+
+	void submitBatch(const VulkanContext& ctx, AsyncUploader& uploader) {
+		UploadBatch& batch{ uploader.open };
+		if (batch.bufferCopies.empty() && batch.imageCopies.empty()) {
+			return;
+		}
+
+		const bool sameFamily{ isSameFamily(uploader) };
+
+		batch.transferCmdBuffer = getCommandBuffer(
+			ctx, uploader.transferPool, uploader.freeTransferCmdBuffers
+		);
+		const VkCommandBuffer cmdBuffer{ batch.transferCmdBuffer };
+
+		VkCommandBufferBeginInfo beginInfo{ vkdefaults::commandBufferBeginInfo(
+			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+		) };
+		CHECK_VK_FATAL(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+
+		std::vector<VkImageMemoryBarrier2> imageBarriers;
+		imageBarriers.reserve(batch.imageCopies.size());
+		for (const auto& copy : batch.imageCopies) {
+			VkImageMemoryBarrier2 barrier{
+				getOwnershipBarrier(uploader, copy)
+			};
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			imageBarriers.emplace_back(barrier);
+		}
+		cmdBarriers(cmdBuffer, {}, imageBarriers);
+
+		for (const auto& copy : batch.bufferCopies) {
+			vkCmdCopyBuffer(cmdBuffer, copy.src, copy.dst, 1, &copy.region);
+		}
+		for (const auto& copy : batch.imageCopies) {
+			vkCmdCopyBufferToImage(
+				cmdBuffer,
+				copy.src,
+				copy.dst,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1,
+				&copy.region
+			);
+		}
+
+		// within one family the timeline wait of the acquire submission
+		// makes the copies visible, only the layouts are left. otherwise
+		// this is the release half of the ownership transfer
+		std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+		if (!sameFamily) {
+			bufferBarriers.reserve(batch.bufferCopies.size());
+			for (const auto& copy : batch.bufferCopies) {
+				VkBufferMemoryBarrier2 barrier{
+					getOwnershipBarrier(uploader, copy)
+				};
+				barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+				barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+				bufferBarriers.emplace_back(barrier);
+			}
+		}
+
+		imageBarriers.clear();
+		for (const auto& copy : batch.imageCopies) {
+			VkImageMemoryBarrier2 barrier{
+				getOwnershipBarrier(uploader, copy)
+			};
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			imageBarriers.emplace_back(barrier);
+		}
+		cmdBarriers(cmdBuffer, bufferBarriers, imageBarriers);
+
+		CHECK_VK_FATAL(vkEndCommandBuffer(cmdBuffer));
+
+		for (const auto& chunk : batch.chunks) {
+			CHECK_VK_FATAL(vmaFlushAllocation(
+				ctx.allocator, chunk.allocation, 0, VK_WHOLE_SIZE
+			));
+		}
+		for (const auto& buffer : batch.dedicated) {
+			CHECK_VK_FATAL(vmaFlushAllocation(
+				ctx.allocator, buffer.allocation, 0, VK_WHOLE_SIZE
+			));
+		}
+
+		std::array cmdBufferInfos{ vkdefaults::cmdBufferSubmitInfo(cmdBuffer) };
+		std::array signalInfos{ vkdefaults::semSubmitInfo(
+			uploader.transfer.timeline,
+			VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			batch.value
+		) };
+		VkSubmitInfo2 submitInfo{
+			vkdefaults::submitInfo(cmdBufferInfos, {}, signalInfos)
+		};
+		CHECK_VK_FATAL(vkQueueSubmit2(
+			uploader.transfer.queue, 1, &submitInfo, VK_NULL_HANDLE
+		));
+
+		uploader.transfer.value = batch.value;
+		uploader.submitted.emplace_back(std::move(batch));
+		uploader.open = { .value = uploader.transfer.value + 1 };
+	}
+
+	void acquireFinishedBatches(
+		const VulkanContext& ctx, AsyncUploader& uploader
+	) {
+		const uint64_t transferred{
+			vkutils::getTimelineValue(ctx, uploader.transfer.timeline)
+		};
+		if (transferred <= uploader.acquiredValue) {
+			return;
+		}
+
+		// one submission for every batch that finished, the timeline wait is
+		// already satisfied so the graphics queue never stalls on it
+		VkCommandBuffer cmdBuffer{};
+		if (!isSameFamily(uploader)) {
+			std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+			std::vector<VkImageMemoryBarrier2> imageBarriers;
+			for (const auto& batch : uploader.submitted) {
+				if (batch.value <= uploader.acquiredValue ||
+					batch.value > transferred) {
+					continue;
+				}
+
+				for (const auto& copy : batch.bufferCopies) {
+					VkBufferMemoryBarrier2 barrier{
+						getOwnershipBarrier(uploader, copy)
+					};
+					barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+					barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT |
+											VK_ACCESS_2_MEMORY_WRITE_BIT;
+					bufferBarriers.emplace_back(barrier);
+				}
+				for (const auto& copy : batch.imageCopies) {
+					VkImageMemoryBarrier2 barrier{
+						getOwnershipBarrier(uploader, copy)
+					};
+					barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+					barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT |
+											VK_ACCESS_2_MEMORY_WRITE_BIT;
+					imageBarriers.emplace_back(barrier);
+				}
+			}
+
+			cmdBuffer = getCommandBuffer(
+				ctx, uploader.graphicsPool, uploader.freeGraphicsCmdBuffers
+			);
+
+			VkCommandBufferBeginInfo beginInfo{
+				vkdefaults::commandBufferBeginInfo(
+					VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+				)
+			};
+			CHECK_VK_FATAL(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+			cmdBarriers(cmdBuffer, bufferBarriers, imageBarriers);
+			CHECK_VK_FATAL(vkEndCommandBuffer(cmdBuffer));
+		}
+
+		std::vector<VkCommandBufferSubmitInfo> cmdBufferInfos;
+		if (cmdBuffer != VK_NULL_HANDLE) {
+			cmdBufferInfos.emplace_back(
+				vkdefaults::cmdBufferSubmitInfo(cmdBuffer)
+			);
+		}
+		std::array waitInfos{ vkdefaults::semSubmitInfo(
+			uploader.transfer.timeline,
+			VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			transferred
+		) };
+		std::array signalInfos{ vkdefaults::semSubmitInfo(
+			uploader.acquireTimeline,
+			VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			transferred
+		) };
+		VkSubmitInfo2 submitInfo{
+			vkdefaults::submitInfo(cmdBufferInfos, waitInfos, signalInfos)
+		};
+		CHECK_VK_FATAL(vkQueueSubmit2(
+			uploader.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE
+		));
+
+		for (auto& batch : uploader.submitted) {
+			if (batch.value > uploader.acquiredValue &&
+				batch.value <= transferred) {
+				batch.acquired = true;
+			}
+			if (batch.value == transferred) {
+				batch.acquireCmdBuffer = cmdBuffer;
+			}
+		}
+		uploader.acquiredValue = transferred;
+	}
+
+	void retireBatches(const VulkanContext& ctx, AsyncUploader& uploader) {
+		const uint64_t acquired{
+			vkutils::getTimelineValue(ctx, uploader.acquireTimeline)
+		};
+
+		while (!uploader.submitted.empty()) {
+			UploadBatch& batch{ uploader.submitted.front() };
+			if (!batch.acquired || batch.value > acquired) {
+				break;
+			}
+
+			uploader.freeTransferCmdBuffers.emplace_back(
+				batch.transferCmdBuffer
+			);
+			if (batch.acquireCmdBuffer != VK_NULL_HANDLE) {
+				uploader.freeGraphicsCmdBuffers.emplace_back(
+					batch.acquireCmdBuffer
+				);
+			}
+
+			for (const auto& chunk : batch.chunks) {
+				if (uploader.freeChunks.size() < MAX_FREE_CHUNKS) {
+					uploader.freeChunks.emplace_back(chunk);
+				} else {
+					destroyBuffer(ctx, chunk);
+				}
+			}
+			for (const auto& buffer : batch.dedicated) {
+				destroyBuffer(ctx, buffer);
+			}
+
+			uploader.submitted.pop_front();
+		}
+	}
+
+	void destroyBatch(const VulkanContext& ctx, UploadBatch& batch) {
+		for (const auto& chunk : batch.chunks) {
+			destroyBuffer(ctx, chunk);
+		}
+		for (const auto& buffer : batch.dedicated) {
+			destroyBuffer(ctx, buffer);
+		}
+		batch.chunks.clear();
+		batch.dedicated.clear();
+	}
+
+	VkBufferMemoryBarrier2 getOwnershipBarrier(
+		const AsyncUploader& uploader, const PendingBufferCopy& copy
+	) {
+		return VkBufferMemoryBarrier2{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+			.srcQueueFamilyIndex = uploader.transfer.familyIndex,
+			.dstQueueFamilyIndex = uploader.graphicsFamilyIndex,
+			.buffer = copy.dst,
+			.offset = copy.region.dstOffset,
+			.size = copy.region.size,
+		};
+	}
+
+	VkImageMemoryBarrier2 getOwnershipBarrier(
+		const AsyncUploader& uploader, const PendingImageCopy& copy
+	) {
+		const VkImageSubresourceLayers& layers{ copy.region.imageSubresource };
+
+		bool sameFamily{ isSameFamily(uploader) };
+		return VkImageMemoryBarrier2{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.newLayout = copy.finalLayout,
+			.srcQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED
+											  : uploader.transfer.familyIndex,
+			.dstQueueFamilyIndex = sameFamily ? VK_QUEUE_FAMILY_IGNORED
+											  : uploader.graphicsFamilyIndex,
+			.image = copy.dst,
+			.subresourceRange = { .aspectMask = layers.aspectMask,
+								  .baseMipLevel = layers.mipLevel,
+								  .levelCount = 1,
+								  .baseArrayLayer = layers.baseArrayLayer,
+								  .layerCount = 1 },
+		};
+	}
+
+	void cmdBarriers(
+		VkCommandBuffer cmdBuffer,
+		const std::span<const VkBufferMemoryBarrier2> bufferBarriers,
+		const std::span<const VkImageMemoryBarrier2> imageBarriers
+	) {
+		if (bufferBarriers.empty() && imageBarriers.empty()) {
+			return;
+		}
+
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.bufferMemoryBarrierCount = (uint32_t)bufferBarriers.size(),
+			.pBufferMemoryBarriers = bufferBarriers.data(),
+			.imageMemoryBarrierCount = (uint32_t)imageBarriers.size(),
+			.pImageMemoryBarriers = imageBarriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+	}
+
+	bool isSameFamily(const AsyncUploader& uploader) {
+		return uploader.transfer.familyIndex == uploader.graphicsFamilyIndex;
+	}
+
+	VkDeviceSize
+		alignUp(const VkDeviceSize value, const VkDeviceSize alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}  // namespace
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "Buffer.h"
+#include "vkutils/Synchronization.h"
+
+// forward declerations
+struct VulkanContext;
+
+namespace VulkanRenderer {
+	// the uploads enqueued before it are usable by the graphics queue once
+	// the ticket is complete
+	struct UploadTicket {
+		uint64_t value;
+	};
+
+	// a whole mip level of one layer
+	struct ImageUpload {
+		VkImage image;
+		VkImageAspectFlags aspect;
+		uint32_t mipLevel;
+		uint32_t arrayLayer;
+		VkExtent3D extent;
+		std::span<const char> data;
+
+		// the image's contents are discarded, it ends up in finalLayout
+		VkImageLayout finalLayout;
+	};
+
+	struct PendingBufferCopy {
+		VkBuffer src;
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+
+	struct PendingImageCopy {
+		VkBuffer src;
+		VkImage dst;
+		VkBufferImageCopy region;
+		VkImageLayout finalLayout;
+	};
+
+	// copies submitted together and acquired by the graphics queue together
+	struct UploadBatch {
+		// value of the transfer and acquire timelines once done
+		uint64_t value;
+
+		// staging, the last chunk is the one being filled
+		std::vector<Buffer> chunks;
+		VkDeviceSize chunkUsed;
+		// uploads bigger than a chunk, freed instead of reused
+		std::vector<Buffer> dedicated;
+
+		std::vector<PendingBufferCopy> bufferCopies;
+		std::vector<PendingImageCopy> imageCopies;
+
+		VkCommandBuffer transferCmdBuffer;
+		// null when the batch was acquired together with a later one
+		VkCommandBuffer acquireCmdBuffer;
+		bool acquired;
+	};
+
+	// gathers buffer and image copies on the render thread and submits them
+	// once per frame on the transfer queue, the render loop never waits on
+	// them. finished batches are handed to the graphics family with
+	// release and acquire barriers when the transfer queue is a family of
+	// its own. only the graphics queue may use uploaded resources. not
+	// thread safe
+	struct AsyncUploader {
+		// the timeline's value is the number of the last submitted batch
+		vkutils::TimelineQueue transfer;
+		VkQueue graphicsQueue;
+		uint32_t graphicsFamilyIndex;
+		// signalled by acquire submissions with their last batch's number
+		VkSemaphore acquireTimeline;
+		// batches up to this one can be used by graphics submissions made
+		// from now on
+		uint64_t acquiredValue;
+
+		VkCommandPool transferPool;
+		VkCommandPool graphicsPool;
+		std::vector<VkCommandBuffer> freeTransferCmdBuffers;
+		std::vector<VkCommandBuffer> freeGraphicsCmdBuffers;
+		std::vector<Buffer> freeChunks;
+
+		UploadBatch open;
+		// oldest first, kept until their acquire submission finished
+		std::deque<UploadBatch> submitted;
+	};
+
+	AsyncUploader createAsyncUploader(
+		const VulkanContext& ctx,
+		const VkQueue transferQueue,
+		const VkQueue graphicsQueue
+	);
+	// every submitted batch must have finished
+	void destroyAsyncUploader(
+		const VulkanContext& ctx, AsyncUploader& uploader
+	);
+
+	// data is copied to staging memory right away. dst must not be in use
+	// by the gpu until the ticket is complete, its contents outside the
+	// range are undefined afterwards when the transfer queue is a family of
+	// its own
+	UploadTicket enqueueBufferUpload(
+		const VulkanContext& ctx,
+		AsyncUploader& uploader,
+		const VkBuffer dst,
+		const VkDeviceSize dstOffset,
+		const std::span<const char> data
+	);
+	UploadTicket enqueueImageUpload(
+		const VulkanContext& ctx,
+		AsyncUploader& uploader,
+		const ImageUpload& upload
+	);
+
+	// submits everything enqueued since the last call in one batch, and
+	// acquires the batches the transfer queue finished in one graphics
+	// submission. call once per frame before submitting the frame
+	void updateUploads(const VulkanContext& ctx, AsyncUploader& uploader);
+
+	bool isUploadComplete(
+		const AsyncUploader& uploader, const UploadTicket ticket
+	);
+	// blocks until the ticket is complete, submitting its batch if needed
+	void waitForUpload(
+		const VulkanContext& ctx,
+		AsyncUploader& uploader,
+		const UploadTicket ticket
+	);
+}  // namespace VulkanRenderer
@@ -1,64 +1,215 @@
-// #include "RendererPCH.h"
-//
-// #include "Buffer.h"
-// #include "Memory.h"
-// #include "Commands.h"
-// #include "Device.h"
-// #include "debug/Debug.h"
-//
-// namespace vkutils {
-// 	void createBuffer(
-// 	    const Device& device,
-// 	    const VkDeviceSize size,
-// 	    const VkBufferUsageFlags usage,
-// 	    const VkMemoryPropertyFlags memFlags,
-// 		const VkSharingMode sharingMode,
-// 		VkBuffer* buffer,
-// 	    VkDeviceMemory* bufferMemory
-// 	) {
-// 		VkBufferCreateInfo bufferCreateInfo{};
-// 		bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-// 		bufferCreateInfo.sharingMode = sharingMode;
-// 		bufferCreateInfo.usage = usage;
-// 		bufferCreateInfo.size = size;
-//
-// 		if (vkCreateBuffer(device.logical, &bufferCreateInfo, nullptr, buffer) !=
-// VK_SUCCESS) { 			logFatal("could not create buffer");
-// 		}
-//
-// 		VkMemoryRequirements bufferMemoryRequirements{};
-// 		vkGetBufferMemoryRequirements(device.logical, *buffer,
-// &bufferMemoryRequirements);
-//
-// 		VkMemoryAllocateInfo memAllocInfo{};
-// 		memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-// 		memAllocInfo.allocationSize = bufferMemoryRequirements.size;
-// 		memAllocInfo.memoryTypeIndex = findValidMemoryTypeIndex(device,
-// bufferMemoryRequirements.memoryTypeBits, memFlags);
-//
-// 		// TODO: use a better allocation strategy
-// 		if (vkAllocateMemory(device.logical, &memAllocInfo, nullptr, bufferMemory)
-// != VK_SUCCESS) { 			logFatal("could not allocate buffer");
-// 		}
-//
-// 		vkBindBufferMemory(device.logical, *buffer, *bufferMemory, 0);
-// 	}
-// 	void copyBuffers(
-// 		const Device& device,
-// 		const VkCommandPool transferCmdPool,
-// 		const VkQueue transferQueue,
-// 		const VkBuffer srcBuffer,
-// 		const VkBuffer dstBuffer,
-// 		const VkDeviceSize copyAmmount
-// 	) {
-// 		VkCommandBuffer cmdBuffer{beginTransientCommands(device,
-// transferCmdPool)};
-//
-// 		VkBufferCopy bufCopyRegion{};
-// 		bufCopyRegion.size = copyAmmount;
-//
-// 		vkCmdCopyBuffer(cmdBuffer, srcBuffer, dstBuffer, 1, &bufCopyRegion);
-//
-// 		endTransientCommands(device, transferCmdPool, cmdBuffer, transferQueue);
-// 	}
-// }
+#include "RendererPCH.h"
+
+#include "Buffer.h"
+
+#include "debug/Debug.h"
+
+#include "vkutils/Commands.h"
+#include "Context.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace {
+	VmaAllocationCreateInfo getAllocationCreateInfo(const BufferMemory memory
+	);
+}  // namespace
+
+Buffer VulkanRenderer::createBuffer(
+	const VulkanContext& ctx,
+	const VkDeviceSize size,
+	const VkBufferUsageFlags usage,
+	const BufferMemory memory,
+	const MemoryCategory category
+) {
+	Buffer buffer{ .size = size };
+
+	VkBufferUsageFlags bufferUsage{ usage };
+	if (memory == BufferMemory::gpuOnly) {
+		bufferUsage |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+
+	VkBufferCreateInfo bufferCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.size = size,
+		.usage = bufferUsage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+	};
+
+	VmaAllocationCreateInfo allocCreateInfo{ getAllocationCreateInfo(memory) };
+
+	VmaAllocationInfo allocInfo{};
+	if (vmaCreateBuffer(
+			ctx.allocator,
+			&bufferCreateInfo,
+			&allocCreateInfo,
+			&buffer.handle,
+			&buffer.allocation,
+			&allocInfo
+		) != VK_SUCCESS) {
+		logFatal("could not create buffer");
+	}
+
+	trackAllocation(ctx, buffer.allocation, category);
+	buffer.mapped = allocInfo.pMappedData;
+
+	if (bufferUsage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+		VkBufferDeviceAddressInfo addressInfo{
+			.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+			.buffer = buffer.handle,
+		};
+		buffer.address =
+			vkGetBufferDeviceAddress(ctx.device.logical, &addressInfo);
+	}
+
+	return buffer;
+}
+
+void VulkanRenderer::destroyBuffer(
+	const VulkanContext& ctx, const Buffer& buffer
+) {
+	untrackAllocation(ctx, buffer.allocation);
+	vmaDestroyBuffer(ctx.allocator, buffer.handle, buffer.allocation);
+}
+
+void VulkanRenderer::writeBuffer(
+	const VulkanContext& ctx,
+	const Buffer& buffer,
+	const std::span<const char> data,
+	const VkDeviceSize offset
+) {
+	if (!buffer.mapped || offset + data.size() > buffer.size) {
+		logWarning("write outside of mapped buffer memory");
+		return;
+	}
+
+	std::memcpy((char*)buffer.mapped + offset, data.data(), data.size());
+
+	// no-op on coherent memory
+	CHECK_VK_FATAL(vmaFlushAllocation(
+		ctx.allocator, buffer.allocation, offset, data.size()
+	));
+}
+
+void VulkanRenderer::readBuffer(
+	const VulkanContext& ctx,
+	const Buffer& buffer,
+	std::span<char> data,
+	const VkDeviceSize offset
+) {
+	if (!buffer.mapped || offset + data.size() > buffer.size) {
+		logWarning("read outside of mapped buffer memory");
+		return;
+	}
+
+	CHECK_VK_FATAL(vmaInvalidateAllocation(
+		ctx.allocator, buffer.allocation, offset, data.size()
+	));
+
+	std::memcpy(data.data(), (char*)buffer.mapped + offset, data.size());
+}
+
+void VulkanRenderer::uploadBuffers(
+	const VulkanContext& ctx,
+	const std::span<const BufferUpload> uploads,
+	const VkCommandBuffer cmdBuffer,
+	const VkQueue queue,
+	VkFence fence
+) {
+	VkDeviceSize stagingSize{};
+	for (const auto& upload : uploads) {
+		stagingSize += upload.data.size();
+	}
+
+	if (stagingSize == 0) {
+		return;
+	}
+
+	Buffer staging{ createBuffer(
+		ctx,
+		stagingSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		BufferMemory::upload,
+		MemoryCategory::staging
+	) };
+
+	// one copy region per upload, offsets into the staging buffer are packed
+	std::vector<std::pair<VkBuffer, VkBufferCopy>> copies;
+	copies.reserve(uploads.size());
+
+	VkDeviceSize stagingOffset{};
+	for (const auto& upload : uploads) {
+		if (upload.data.empty()) {
+			continue;
+		}
+
+		std::memcpy(
+			(char*)staging.mapped + stagingOffset,
+			upload.data.data(),
+			upload.data.size()
+		);
+
+		copies.emplace_back(
+			upload.dst,
+			VkBufferCopy{ .srcOffset = stagingOffset,
+						  .dstOffset = upload.dstOffset,
+						  .size = upload.data.size() }
+		);
+		stagingOffset += upload.data.size();
+	}
+
+	CHECK_VK_FATAL(
+		vmaFlushAllocation(ctx.allocator, staging.allocation, 0, stagingSize)
+	);
+
+	vkutils::immediateSubmit(ctx, cmdBuffer, queue, fence, [&]() {
+		for (const auto& [dst, region] : copies) {
+			vkCmdCopyBuffer(cmdBuffer, staging.handle, dst, 1, &region);
+		}
+
+		// the fence only makes the copies visible to the host
+		VkMemoryBarrier2 barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.dstAccessMask =
+				VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+		};
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+		vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+	});
+
+	destroyBuffer(ctx, staging);
+}
+
+namespace {
+	VmaAllocationCreateInfo getAllocationCreateInfo(const BufferMemory memory
+	) {
+		switch (memory) {
+			case BufferMemory::upload:
+				return VmaAllocationCreateInfo{
+					.flags =
+						VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+						VMA_ALLOCATION_CREATE_MAPPED_BIT,
+					.usage = VMA_MEMORY_USAGE_AUTO,
+				};
+			case BufferMemory::readback:
+				return VmaAllocationCreateInfo{
+					.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT |
+							 VMA_ALLOCATION_CREATE_MAPPED_BIT,
+					.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST,
+				};
+			case BufferMemory::gpuOnly:
+			default:
+				return VmaAllocationCreateInfo{
+					.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+				};
+		}
+	}
+}  // namespace
@@ -1,28 +1,78 @@
-// #pragma once
-// 
-// #include <vulkan/vulkan.h>
-// 
-// // forward declerations
-// struct Device;
-// 
-// namespace vkutils {
-// 	void createBuffer(
-// 	    const Device& device,
-// 	    const VkDeviceSize size,
-// 	    const VkBufferUsageFlags usage,
-// 	    const VkMemoryPropertyFlags memFlags, 
-// 		const VkSharingMode sharingMode,
-// 		VkBuffer* buffer,
-// 	    VkDeviceMemory* bufferMemory
-// 	);
-// 	
-// 	void copyBuffers(
-// 		const Device& device,
-// 		const VkCommandPool transferCmdPool,
-// 		const VkQueue transferQueue,
-// 		const VkBuffer srcBuffer,
-// 		const VkBuffer dstBuffer,
-// 		const VkDeviceSize copyAmmount
-// 	);
-// 
-// }
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+#include <span>
+
+#include "MemoryBudget.h"
+
+// forward declerations
+struct VulkanContext;
+
+enum class BufferMemory : uint32_t {
+	// device local, filled through staged uploads. can always be the
+	// destination of a transfer
+	gpuOnly = 0,
+	// persistently mapped and written sequentially by the cpu, device local
+	// when the device has host visible vram
+	upload,
+	// persistently mapped and cached, for the cpu to read gpu results
+	readback,
+};
+
+struct Buffer {
+	VkBuffer handle{};
+	VmaAllocation allocation{};
+	VkDeviceSize size{};
+
+	// mapped for the buffer's whole lifetime, null for gpuOnly buffers
+	void* mapped{};
+	// 0 unless created with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+	VkDeviceAddress address{};
+};
+
+// a copy of data into dst at dstOffset, data only has to stay alive until
+// the upload call returns
+struct BufferUpload {
+	VkBuffer dst;
+	VkDeviceSize dstOffset;
+	std::span<const char> data;
+};
+
+namespace VulkanRenderer {
+	Buffer createBuffer(
+		const VulkanContext& ctx,
+		const VkDeviceSize size,
+		const VkBufferUsageFlags usage,
+		const BufferMemory memory,
+		const MemoryCategory category
+	);
+	void destroyBuffer(const VulkanContext& ctx, const Buffer& buffer);
+
+	// through the mapping, flushed when the memory isn't host coherent
+	void writeBuffer(
+		const VulkanContext& ctx,
+		const Buffer& buffer,
+		const std::span<const char> data,
+		const VkDeviceSize offset = 0
+	);
+	// invalidated first when the memory isn't host coherent
+	void readBuffer(
+		const VulkanContext& ctx,
+		const Buffer& buffer,
+		std::span<char> data,
+		const VkDeviceSize offset = 0
+	);
+
+	// every upload goes through one staging buffer and one submission on
+	// queue, waited on with fence. the copies are visible to every later
+	// submission on queue once this returns
+	void uploadBuffers(
+		const VulkanContext& ctx,
+		const std::span<const BufferUpload> uploads,
+		const VkCommandBuffer cmdBuffer,
+		const VkQueue queue,
+		VkFence fence
+	);
+}  // namespace VulkanRenderer
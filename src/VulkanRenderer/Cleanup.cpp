@@ -12,3 +12,27 @@ void DeletionQueue::flush() {
 	}
 	m_DeletionProcedures.clear();
 }
+
+void DeferredDeletionQueue::pushFunction(
+	const uint64_t retireValue, std::function<void()>&& deletionProc
+) {
+	m_DeletionProcedures.emplace_back(
+		DeferredDeletion{ .retireValue = retireValue,
+						  .deletionProc = std::move(deletionProc) }
+	);
+}
+
+void DeferredDeletionQueue::collect(const uint64_t completedValue) {
+	while (!m_DeletionProcedures.empty() &&
+		   m_DeletionProcedures.front().retireValue <= completedValue) {
+		m_DeletionProcedures.front().deletionProc();
+		m_DeletionProcedures.pop_front();
+	}
+}
+
+void DeferredDeletionQueue::flush() {
+	for (auto& deletion : m_DeletionProcedures) {
+		deletion.deletionProc();
+	}
+	m_DeletionProcedures.clear();
+}
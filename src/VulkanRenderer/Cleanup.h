@@ -2,6 +2,7 @@
 
 #include <deque>
 #include <functional>
+#include <stdint.h>
 
 class DeletionQueue {
    public:
@@ -12,6 +13,26 @@ class DeletionQueue {
 	std::deque<std::function<void()>> m_DeletionProcedures;
 };
 
+// deletions waiting on a timeline value, usually the frame that last used
+// the object. values must be pushed in increasing order
+class DeferredDeletionQueue {
+   public:
+	void pushFunction(
+		const uint64_t retireValue, std::function<void()>&& deletionProc
+	);
+	// runs every deletion whose value the timeline has reached
+	void collect(const uint64_t completedValue);
+	void flush();
+
+   private:
+	struct DeferredDeletion {
+		uint64_t retireValue;
+		std::function<void()> deletionProc;
+	};
+
+	std::deque<DeferredDeletion> m_DeletionProcedures;
+};
+
 template<typename T>
 struct Deletable {
 	T obj;
@@ -3,6 +3,7 @@
 #include "Cleanup.h"
 #include "Device.h"
 #include "Instance.h"
+#include "MemoryBudget.h"
 #include "RendererPCH.h"
 #include "debug/Debug.h"
 
@@ -34,6 +35,7 @@ VulkanContext VulkanRenderer::createVulkanContext(
 
 	VulkanContext context{
 		.allocator = allocator,
+		.allocationTracker = createAllocationTracker(deletionQueue),
 
 		.instance = instance,
 		.debugMessenger = debugMessenger,
@@ -52,11 +54,20 @@ namespace {
 		const VkInstance& instance,
 		DeletionQueue& deletionQueue
 	) {
+		VmaAllocatorCreateFlags flags{
+			VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT
+		};
+		if (device.memoryBudget) {
+			flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+		}
+
 		VmaAllocatorCreateInfo allocatorCreateInfo{
-			.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT,
+			.flags = flags,
 			.physicalDevice = device.physical,
 			.device = device.logical,
 			.instance = instance,
+			// lets vma use the core 1.1 memory properties query for budgets
+			.vulkanApiVersion = VK_API_VERSION_1_3,
 		};
 
 		VmaAllocator allocator{};
@@ -78,6 +89,9 @@ namespace {
 		DeletionQueue& deletionQueue
 	) {
 		VkSurfaceKHR surface{};
+		if (!window) {
+			return surface;
+		}
 		SDL_Vulkan_CreateSurface(window, instance, &surface);
 
 		deletionQueue.pushFunction([=]() {
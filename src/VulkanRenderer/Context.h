@@ -9,17 +9,26 @@
 // forward declerations
 typedef struct SDL_Window SDL_Window;
 
+namespace VulkanRenderer {
+	struct AllocationTracker;
+}
+
 struct VulkanContext {
 	VmaAllocator allocator;
+	// categories of the allocations made through createBuffer and
+	// createImage
+	VulkanRenderer::AllocationTracker* allocationTracker;
 
 	VkInstance instance;
 	VkDebugUtilsMessengerEXT debugMessenger;
 
+	// VK_NULL_HANDLE when headless
 	VkSurfaceKHR surface;
 
 	Device device;
 };
 
 namespace VulkanRenderer {
+	// a null window creates a headless context without a surface
 	VulkanContext createVulkanContext(SDL_Window* window, DeletionQueue& deletionQueue);
 }
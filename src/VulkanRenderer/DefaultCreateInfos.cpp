@@ -5,7 +5,7 @@
 VkImageSubresourceRange
 	vkdefaults::subresourceRange(const VkImageAspectFlags aspectFlags) {
 	VkImageSubresourceRange subresourceRange{
-		.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+		.aspectMask = aspectFlags,
 		.baseMipLevel = 0,
 		.levelCount = 1,
 		.baseArrayLayer = 0,
@@ -26,12 +26,14 @@ VkCommandBufferBeginInfo
 }
 
 VkSemaphoreSubmitInfo vkdefaults::semSubmitInfo(
-	const VkSemaphore semaphore, const VkPipelineStageFlags2 stage
+	const VkSemaphore semaphore,
+	const VkPipelineStageFlags2 stage,
+	const uint64_t value
 ) {
 	VkSemaphoreSubmitInfo info{ .sType =
 									VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
 								.semaphore = semaphore,
-								.value = 1,
+								.value = value,
 								.stageMask = stage };
 
 	return info;
@@ -68,14 +70,15 @@ VkSubmitInfo2 vkdefaults::submitInfo(
 VkImageCreateInfo vkdefaults::imageCreateInfo(
 	const VkExtent3D& extent,
 	const VkFormat format,
-	const VkImageUsageFlags usage
+	const VkImageUsageFlags usage,
+	const uint32_t mipLevels
 ) {
 	VkImageCreateInfo info{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
 		.imageType = VK_IMAGE_TYPE_2D,
 		.format = format,
 		.extent = extent,
-		.mipLevels = 1,
+		.mipLevels = mipLevels,
 		.arrayLayers = 1,
 		.samples = VK_SAMPLE_COUNT_1_BIT,
 		.tiling = VK_IMAGE_TILING_OPTIMAL,
@@ -88,7 +91,10 @@ VkImageCreateInfo vkdefaults::imageCreateInfo(
 }
 
 VkImageViewCreateInfo vkdefaults::imageViewCreateInfo(
-	const VkImage image, const VkFormat format, const VkImageAspectFlags aspect
+	const VkImage image,
+	const VkFormat format,
+	const VkImageAspectFlags aspect,
+	const uint32_t mipLevels
 ) {
 	VkImageViewCreateInfo info{
 		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -97,6 +103,7 @@ VkImageViewCreateInfo vkdefaults::imageViewCreateInfo(
 		.format = format,
 		.subresourceRange = vkdefaults::subresourceRange(aspect),
 	};
+	info.subresourceRange.levelCount = mipLevels;
 
 	return info;
 }
@@ -10,8 +10,11 @@ namespace vkdefaults {
 	VkCommandBufferBeginInfo
 		commandBufferBeginInfo(const VkCommandBufferUsageFlags flags = 0);
 
+	// value is ignored for binary semaphores
 	VkSemaphoreSubmitInfo semSubmitInfo(
-		const VkSemaphore semaphore, const VkPipelineStageFlags2 stage
+		const VkSemaphore semaphore,
+		const VkPipelineStageFlags2 stage,
+		const uint64_t value = 1
 	);
 	VkCommandBufferSubmitInfo
 		cmdBufferSubmitInfo(const VkCommandBuffer cmdBuffer);
@@ -25,13 +28,15 @@ namespace vkdefaults {
 	VkImageCreateInfo imageCreateInfo(
 		const VkExtent3D& extent,
 		const VkFormat format,
-		const VkImageUsageFlags usage
+		const VkImageUsageFlags usage,
+		const uint32_t mipLevels = 1
 	);
 
 	VkImageViewCreateInfo imageViewCreateInfo(
 		const VkImage image,
 		const VkFormat format,
-		const VkImageAspectFlags aspect
+		const VkImageAspectFlags aspect,
+		const uint32_t mipLevels = 1
 	);
 
 	VkImageBlit2
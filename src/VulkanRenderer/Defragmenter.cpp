@@ -0,0 +1,664 @@
+#include "RendererPCH.h"
+
+#include "Defragmenter.h"
+
+#include "debug/Debug.h"
+
+#include "Context.h"
+#include "DefaultCreateInfos.h"
+#include "vkutils/Barriers.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <array>
+
+using namespace VulkanRenderer;
+
+namespace {
+	// vmaCalculateStatistics walks every block, so it isn't run every frame
+	constexpr uint64_t METRICS_INTERVAL_FRAMES{ 300 };
+	// a run starts past both
+	constexpr float MIN_FRAGMENTATION{ 0.3f };
+	constexpr VkDeviceSize MIN_UNUSED_BYTES{ 64 * 1024 * 1024 };
+	// vma keeps proposing moves of resources that aren't registered, a run
+	// is ended after this many passes regardless
+	constexpr uint32_t MAX_PASSES_PER_RUN{ 256 };
+
+	void beginPass(
+		const VulkanContext& ctx,
+		Defragmenter& defragmenter,
+		vkutils::TimelineQueue& graphicsQueue,
+		const VkSemaphore frameTimeline,
+		const uint64_t frameNumber
+	);
+	void endPass(const VulkanContext& ctx, Defragmenter& defragmenter);
+	void finishRun(const VulkanContext& ctx, Defragmenter& defragmenter);
+
+	// bound to dstAllocation, which vma hands to the moved allocation when
+	// the pass ends
+	MovableResource createMoved(
+		const VulkanContext& ctx,
+		const MovableResource& old,
+		const VmaAllocation dstAllocation
+	);
+	void cmdCopyMoves(
+		VkCommandBuffer cmdBuffer, const std::span<const PendingMove> moves
+	);
+	VkImageMemoryBarrier2 getImageBarrier(const Image& image);
+
+	// leaves the allocation alone
+	void destroyHandles(
+		const VulkanContext& ctx, const MovableResource& resource
+	);
+	void destroyResource(
+		const VulkanContext& ctx, const MovableResource& resource
+	);
+
+	FragmentationMetrics measureFragmentation(const VulkanContext& ctx);
+
+	VmaAllocation getAllocation(const MovableResource& resource);
+	bool isBeingMoved(
+		const Defragmenter& defragmenter, const VmaAllocation allocation
+	);
+	float toMiB(const VkDeviceSize bytes);
+}  // namespace
+
+Defragmenter VulkanRenderer::createDefragmenter(
+	const VulkanContext& ctx,
+	const uint32_t graphicsFamilyIndex,
+	const VkDeviceSize maxBytesPerFrame
+) {
+	Defragmenter defragmenter{ .maxBytesPerFrame = maxBytesPerFrame };
+
+	VkCommandPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+				 VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = graphicsFamilyIndex,
+	};
+	if (vkCreateCommandPool(
+			ctx.device.logical, &poolCreateInfo, nullptr, &defragmenter.cmdPool
+		) != VK_SUCCESS) {
+		logFatal("could not create defragmenter command pool");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = defragmenter.cmdPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+	CHECK_VK_FATAL(vkAllocateCommandBuffers(
+		ctx.device.logical, &allocInfo, &defragmenter.cmdBuffer
+	));
+
+	return defragmenter;
+}
+
+void VulkanRenderer::destroyDefragmenter(
+	const VulkanContext& ctx, Defragmenter& defragmenter
+) {
+	if (defragmenter.passOpen) {
+		endPass(ctx, defragmenter);
+	}
+	if (defragmenter.context != VK_NULL_HANDLE) {
+		finishRun(ctx, defragmenter);
+	}
+
+	defragmenter.movable.clear();
+	vkDestroyCommandPool(ctx.device.logical, defragmenter.cmdPool, nullptr);
+}
+
+void VulkanRenderer::registerMovable(
+	Defragmenter& defragmenter, MovableResource&& resource
+) {
+	const VkFlags copyUsage{ resource.type == MovableType::buffer
+								 ? (VkFlags)(VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+											 VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+								 : (VkFlags)(VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+											 VK_IMAGE_USAGE_TRANSFER_DST_BIT) };
+	if ((resource.usage & copyUsage) != copyUsage) {
+		logWarning("movable resources need transfer src and dst usage");
+		return;
+	}
+	if (resource.type == MovableType::buffer && resource.buffer.mapped) {
+		logWarning("mapped buffers can't be moved");
+		return;
+	}
+
+	VmaAllocation allocation{ getAllocation(resource) };
+	defragmenter.movable[allocation] = std::move(resource);
+}
+
+void VulkanRenderer::unregisterMovable(
+	Defragmenter& defragmenter, const VmaAllocation allocation
+) {
+	defragmenter.movable.erase(allocation);
+}
+
+void VulkanRenderer::destroyMovableBuffer(
+	const VulkanContext& ctx,
+	Defragmenter& defragmenter,
+	const Buffer& buffer
+) {
+	unregisterMovable(defragmenter, buffer.allocation);
+
+	if (isBeingMoved(defragmenter, buffer.allocation)) {
+		defragmenter.releasedDuringPass.emplace_back(
+			MovableResource{ .type = MovableType::buffer, .buffer = buffer }
+		);
+		return;
+	}
+
+	destroyBuffer(ctx, buffer);
+}
+
+void VulkanRenderer::destroyMovableImage(
+	const VulkanContext& ctx,
+	Defragmenter& defragmenter,
+	const Image& image
+) {
+	unregisterMovable(defragmenter, image.allocation);
+
+	if (isBeingMoved(defragmenter, image.allocation)) {
+		defragmenter.releasedDuringPass.emplace_back(
+			MovableResource{ .type = MovableType::image, .image = image }
+		);
+		return;
+	}
+
+	destroyImage(ctx, image);
+}
+
+void VulkanRenderer::updateDefragmenter(
+	const VulkanContext& ctx,
+	Defragmenter& defragmenter,
+	vkutils::TimelineQueue& graphicsQueue,
+	const VkSemaphore frameTimeline,
+	const uint64_t frameNumber
+) {
+	if (defragmenter.maxBytesPerFrame == 0) {
+		return;
+	}
+
+	if (defragmenter.passOpen) {
+		if (vkutils::getTimelineValue(ctx, graphicsQueue.timeline) <
+			defragmenter.passRetireValue) {
+			return;
+		}
+
+		endPass(ctx, defragmenter);
+	}
+
+	if (defragmenter.context == VK_NULL_HANDLE) {
+		if (frameNumber < defragmenter.metricsFrame + METRICS_INTERVAL_FRAMES) {
+			return;
+		}
+
+		defragmenter.metrics = measureFragmentation(ctx);
+		defragmenter.metricsFrame = frameNumber;
+		const FragmentationMetrics& metrics{ defragmenter.metrics };
+
+		VkDeviceSize unusedBytes{
+			metrics.blockBytes - metrics.allocationBytes
+		};
+		if (metrics.fragmentation < MIN_FRAGMENTATION ||
+			unusedBytes < MIN_UNUSED_BYTES || defragmenter.movable.empty()) {
+			return;
+		}
+
+		VmaDefragmentationInfo defragInfo{
+			.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT,
+			.maxBytesPerPass = defragmenter.maxBytesPerFrame,
+		};
+		if (vmaBeginDefragmentation(
+				ctx.allocator, &defragInfo, &defragmenter.context
+			) != VK_SUCCESS) {
+			logWarning("could not begin defragmentation");
+			return;
+		}
+	}
+
+	beginPass(ctx, defragmenter, graphicsQueue, frameTimeline, frameNumber);
+}
+
+void VulkanRenderer::drawDefragmenterWindow(const Defragmenter& defragmenter
+) {
+	const FragmentationMetrics& metrics{ defragmenter.metrics };
+	const DefragmentationTotals& totals{ defragmenter.totals };
+
+	// same name as the memory budget window, so it is appended to it
+	ImGui::Begin("gpu memory");
+	ImGui::Separator();
+
+	ImGui::Text(
+		"fragmentation %.0f%%, %.1f MiB unused in %u blocks",
+		metrics.fragmentation * 100.f,
+		toMiB(metrics.blockBytes - metrics.allocationBytes),
+		metrics.blockCount
+	);
+	ImGui::Text(
+		"%s, %zu movable resources",
+		defragmenter.context != VK_NULL_HANDLE ? "defragmenting" : "idle",
+		defragmenter.movable.size()
+	);
+	ImGui::Text(
+		"%u runs moved %.1f MiB in %u allocations, freed %u blocks",
+		totals.runs,
+		toMiB(totals.bytesMoved),
+		totals.allocationsMoved,
+		totals.blocksFreed
+	);
+
+	ImGui::End();
+}
+
+namespace {
+	void beginPass(
+		const VulkanContext& ctx,
+		Defragmenter& defragmenter,
+		vkutils::TimelineQueue& graphicsQueue,
+		const VkSemaphore frameTimeline,
+		const uint64_t frameNumber
+	) {
+		VkResult res{ vmaBeginDefragmentationPass(
+			ctx.allocator, defragmenter.context, &defragmenter.pass
+		) };
+		if (res == VK_SUCCESS) {
+			// nothing left to move
+			finishRun(ctx, defragmenter);
+			return;
+		} else if (res != VK_INCOMPLETE) {
+			logWarning("could not begin defragmentation pass: ", res);
+			finishRun(ctx, defragmenter);
+			return;
+		}
+		defragmenter.passCount++;
+
+		for (uint32_t i{}; i < defragmenter.pass.moveCount; i++) {
+			VmaDefragmentationMove& move{ defragmenter.pass.pMoves[i] };
+
+			auto it{ defragmenter.movable.find(move.srcAllocation) };
+			if (it == defragmenter.movable.end() ||
+				(it->second.canMove && !it->second.canMove())) {
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			defragmenter.moves.emplace_back(PendingMove{
+				.old = it->second,
+				.moved = createMoved(ctx, it->second, move.dstTmpAllocation),
+			});
+		}
+
+		// every move was ignored, the pass ends right away
+		if (defragmenter.moves.empty()) {
+			endPass(ctx, defragmenter);
+			return;
+		}
+
+		VkCommandBuffer cmdBuffer{ defragmenter.cmdBuffer };
+		VkCommandBufferBeginInfo beginInfo{ vkdefaults::commandBufferBeginInfo(
+			VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+		) };
+		CHECK_VK_FATAL(vkBeginCommandBuffer(cmdBuffer, &beginInfo));
+		cmdCopyMoves(cmdBuffer, defragmenter.moves);
+		CHECK_VK_FATAL(vkEndCommandBuffer(cmdBuffer));
+
+		// the last frame may still write the old resources on any queue,
+		// this frame's submissions only use the moved ones
+		std::vector<VkSemaphoreSubmitInfo> waitInfos;
+		if (frameNumber > 1) {
+			waitInfos.emplace_back(vkdefaults::semSubmitInfo(
+				frameTimeline,
+				VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				frameNumber - 1
+			));
+		}
+
+		const uint64_t signalValue{ graphicsQueue.value + 1 };
+		std::array cmdBufferInfos{ vkdefaults::cmdBufferSubmitInfo(cmdBuffer) };
+		std::array signalInfos{ vkdefaults::semSubmitInfo(
+			graphicsQueue.timeline,
+			VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			signalValue
+		) };
+		VkSubmitInfo2 submitInfo{
+			vkdefaults::submitInfo(cmdBufferInfos, waitInfos, signalInfos)
+		};
+		CHECK_VK_FATAL(vkQueueSubmit2(
+			graphicsQueue.queue, 1, &submitInfo, VK_NULL_HANDLE
+		));
+		graphicsQueue.value = signalValue;
+
+		defragmenter.passOpen = true;
+		defragmenter.passRetireValue = signalValue;
+
+		for (const auto& move : defragmenter.moves) {
+			MovableResource& resource{
+				defragmenter.movable.at(getAllocation(move.old))
+			};
+			resource.buffer = move.moved.buffer;
+			resource.image = move.moved.image;
+
+			// the callback may register and unregister resources
+			MovedCallback onMoved{ resource.onMoved };
+			onMoved(move.moved, signalValue);
+		}
+	}
+
+	void endPass(const VulkanContext& ctx, Defragmenter& defragmenter) {
+		for (const auto& move : defragmenter.moves) {
+			destroyHandles(ctx, move.old);
+		}
+
+		VkResult res{ vmaEndDefragmentationPass(
+			ctx.allocator, defragmenter.context, &defragmenter.pass
+		) };
+		defragmenter.passOpen = false;
+		defragmenter.moves.clear();
+
+		// their allocations are at the new place now
+		for (const auto& released : defragmenter.releasedDuringPass) {
+			destroyResource(ctx, released);
+		}
+		defragmenter.releasedDuringPass.clear();
+
+		if (res == VK_INCOMPLETE &&
+			defragmenter.passCount < MAX_PASSES_PER_RUN) {
+			return;
+		} else if (res != VK_SUCCESS && res != VK_INCOMPLETE) {
+			logWarning("could not end defragmentation pass: ", res);
+		}
+
+		finishRun(ctx, defragmenter);
+	}
+
+	void finishRun(const VulkanContext& ctx, Defragmenter& defragmenter) {
+		VmaDefragmentationStats stats{};
+		vmaEndDefragmentation(ctx.allocator, defragmenter.context, &stats);
+		defragmenter.context = VK_NULL_HANDLE;
+		defragmenter.passCount = 0;
+
+		DefragmentationTotals& totals{ defragmenter.totals };
+		totals.runs++;
+		totals.bytesMoved += stats.bytesMoved;
+		totals.bytesFreed += stats.bytesFreed;
+		totals.allocationsMoved += stats.allocationsMoved;
+		totals.blocksFreed += stats.deviceMemoryBlocksFreed;
+
+		// measured again on the next update
+		defragmenter.metricsFrame = 0;
+	}
+
+	MovableResource createMoved(
+		const VulkanContext& ctx,
+		const MovableResource& old,
+		const VmaAllocation dstAllocation
+	) {
+		MovableResource moved{ old };
+
+		if (old.type == MovableType::buffer) {
+			VkBufferCreateInfo bufferCreateInfo{
+				.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+				.size = old.buffer.size,
+				.usage = old.usage,
+				.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			};
+			CHECK_VK_FATAL(vkCreateBuffer(
+				ctx.device.logical,
+				&bufferCreateInfo,
+				nullptr,
+				&moved.buffer.handle
+			));
+			CHECK_VK_FATAL(vmaBindBufferMemory(
+				ctx.allocator, dstAllocation, moved.buffer.handle
+			));
+
+			if (old.usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+				VkBufferDeviceAddressInfo addressInfo{
+					.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+					.buffer = moved.buffer.handle,
+				};
+				moved.buffer.address =
+					vkGetBufferDeviceAddress(ctx.device.logical, &addressInfo);
+			}
+
+			return moved;
+		}
+
+		const Image& image{ old.image };
+		VkImageCreateInfo imageCreateInfo{ vkdefaults::imageCreateInfo(
+			image.extent, image.format, old.usage, image.mipLevels
+		) };
+		CHECK_VK_FATAL(vkCreateImage(
+			ctx.device.logical, &imageCreateInfo, nullptr, &moved.image.handle
+		));
+		CHECK_VK_FATAL(
+			vmaBindImageMemory(ctx.allocator, dstAllocation, moved.image.handle)
+		);
+
+		VkImageViewCreateInfo viewCreateInfo{ vkdefaults::imageViewCreateInfo(
+			moved.image.handle,
+			image.format,
+			vkutils::getImageAspect(image.format),
+			image.mipLevels
+		) };
+		CHECK_VK_FATAL(vkCreateImageView(
+			ctx.device.logical, &viewCreateInfo, nullptr, &moved.image.view
+		));
+
+		return moved;
+	}
+
+	void cmdCopyMoves(
+		VkCommandBuffer cmdBuffer, const std::span<const PendingMove> moves
+	) {
+		// buffers are covered by global barriers, their writers aren't
+		// tracked
+		VkMemoryBarrier2 memoryBarrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+		};
+		std::vector<VkImageMemoryBarrier2> imageBarriers;
+		for (const auto& move : moves) {
+			if (move.old.type != MovableType::image) {
+				continue;
+			}
+
+			// only the stages the layout is used with have to finish
+			const vkutils::LayoutAccess oldAccess{
+				vkutils::getLayoutAccess(move.old.layout)
+			};
+			VkImageMemoryBarrier2 src{ getImageBarrier(move.old.image) };
+			src.srcStageMask = oldAccess.stages;
+			src.srcAccessMask = vkutils::getWriteAccess(oldAccess.access);
+			src.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			src.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+			src.oldLayout = move.old.layout;
+			src.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			imageBarriers.emplace_back(src);
+
+			VkImageMemoryBarrier2 dst{ getImageBarrier(move.moved.image) };
+			dst.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			dst.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			dst.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			dst.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarriers.emplace_back(dst);
+		}
+
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &memoryBarrier,
+			.imageMemoryBarrierCount = (uint32_t)imageBarriers.size(),
+			.pImageMemoryBarriers = imageBarriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+
+		for (const auto& move : moves) {
+			if (move.old.type == MovableType::buffer) {
+				VkBufferCopy region{ .size = move.old.buffer.size };
+				vkCmdCopyBuffer(
+					cmdBuffer,
+					move.old.buffer.handle,
+					move.moved.buffer.handle,
+					1,
+					&region
+				);
+				continue;
+			}
+
+			const Image& image{ move.old.image };
+			const VkImageAspectFlags aspect{
+				vkutils::getImageAspect(image.format)
+			};
+
+			std::vector<VkImageCopy2> regions;
+			for (uint32_t level{}; level < image.mipLevels; level++) {
+				regions.emplace_back(VkImageCopy2{
+					.sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2,
+					.srcSubresource = { .aspectMask = aspect,
+										.mipLevel = level,
+										.layerCount = 1 },
+					.dstSubresource = { .aspectMask = aspect,
+										.mipLevel = level,
+										.layerCount = 1 },
+					.extent = { .width =
+									std::max(image.extent.width >> level, 1u),
+								.height =
+									std::max(image.extent.height >> level, 1u),
+								.depth = 1 },
+				});
+			}
+			VkCopyImageInfo2 copyInfo{
+				.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2,
+				.srcImage = image.handle,
+				.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				.dstImage = move.moved.image.handle,
+				.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				.regionCount = (uint32_t)regions.size(),
+				.pRegions = regions.data(),
+			};
+			vkCmdCopyImage2(cmdBuffer, &copyInfo);
+		}
+
+		memoryBarrier = {
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+			.dstAccessMask =
+				VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT,
+		};
+		imageBarriers.clear();
+		for (const auto& move : moves) {
+			if (move.old.type != MovableType::image) {
+				continue;
+			}
+
+			const vkutils::LayoutAccess oldAccess{
+				vkutils::getLayoutAccess(move.old.layout)
+			};
+			VkImageMemoryBarrier2 barrier{ getImageBarrier(move.moved.image) };
+			barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+			barrier.dstStageMask = oldAccess.stages;
+			barrier.dstAccessMask = oldAccess.access;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.newLayout = move.old.layout;
+			imageBarriers.emplace_back(barrier);
+		}
+
+		depInfo.imageMemoryBarrierCount = (uint32_t)imageBarriers.size();
+		depInfo.pImageMemoryBarriers = imageBarriers.data();
+		vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+	}
+
+	VkImageMemoryBarrier2 getImageBarrier(const Image& image) {
+		return VkImageMemoryBarrier2{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image.handle,
+			.subresourceRange = { .aspectMask =
+									  vkutils::getImageAspect(image.format),
+								  .levelCount = image.mipLevels,
+								  .layerCount = 1 },
+		};
+	}
+
+	void destroyHandles(
+		const VulkanContext& ctx, const MovableResource& resource
+	) {
+		if (resource.type == MovableType::buffer) {
+			vkDestroyBuffer(
+				ctx.device.logical, resource.buffer.handle, nullptr
+			);
+			return;
+		}
+
+		vkDestroyImageView(ctx.device.logical, resource.image.view, nullptr);
+		vkDestroyImage(ctx.device.logical, resource.image.handle, nullptr);
+	}
+
+	void destroyResource(
+		const VulkanContext& ctx, const MovableResource& resource
+	) {
+		if (resource.type == MovableType::buffer) {
+			destroyBuffer(ctx, resource.buffer);
+			return;
+		}
+
+		destroyImage(ctx, resource.image);
+	}
+
+	FragmentationMetrics measureFragmentation(const VulkanContext& ctx) {
+		VmaTotalStatistics stats{};
+		vmaCalculateStatistics(ctx.allocator, &stats);
+
+		const VmaDetailedStatistics& total{ stats.total };
+		FragmentationMetrics metrics{
+			.blockBytes = total.statistics.blockBytes,
+			.allocationBytes = total.statistics.allocationBytes,
+			.largestUnusedRange = total.unusedRangeSizeMax,
+			.blockCount = total.statistics.blockCount,
+		};
+
+		VkDeviceSize unusedBytes{
+			metrics.blockBytes - metrics.allocationBytes
+		};
+		if (unusedBytes > 0) {
+			metrics.fragmentation =
+				1.f - (float)metrics.largestUnusedRange / (float)unusedBytes;
+		}
+
+		return metrics;
+	}
+
+	VmaAllocation getAllocation(const MovableResource& resource) {
+		return resource.type == MovableType::buffer
+				   ? resource.buffer.allocation
+				   : resource.image.allocation;
+	}
+
+	bool isBeingMoved(
+		const Defragmenter& defragmenter, const VmaAllocation allocation
+	) {
+		return std::any_of(
+			defragmenter.moves.begin(),
+			defragmenter.moves.end(),
+			[=](const PendingMove& move) {
+				return getAllocation(move.old) == allocation;
+			}
+		);
+	}
+
+	float toMiB(const VkDeviceSize bytes) {
+		return (float)bytes / (1024.f * 1024.f);
+	}
+}  // namespace
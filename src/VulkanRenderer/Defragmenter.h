@@ -0,0 +1,152 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "Buffer.h"
+#include "Image.h"
+#include "vkutils/Synchronization.h"
+
+// forward declerations
+struct VulkanContext;
+
+namespace VulkanRenderer {
+	enum class MovableType : uint32_t {
+		buffer = 0,
+		image,
+	};
+
+	struct MovableResource;
+
+	// the moved resource is bound to the same VmaAllocation at its new place
+	// and its contents are copied once the graphics timeline reaches
+	// retireValue. the owner has to switch its handles and descriptors over
+	// right away and stop using the old ones by then, the defragmenter
+	// destroys them
+	using MovedCallback = std::function<
+		void(const MovableResource& moved, const uint64_t retireValue)>;
+	// asked right before a pass moves the resource, false leaves it where it
+	// is for that pass
+	using CanMoveCallback = std::function<bool()>;
+
+	// a resource whose owner can swap it for a copy. buffers have to be
+	// gpuOnly, mapped ones can't be moved
+	struct MovableResource {
+		MovableType type;
+		Buffer buffer;
+		Image image;
+
+		// recreated with the same usage
+		VkFlags usage;
+		// the image's layout whenever it isn't being moved
+		VkImageLayout layout;
+
+		MovedCallback onMoved;
+		// null always moves
+		CanMoveCallback canMove;
+	};
+
+	// fragmentation of every default pool, from vmaCalculateStatistics
+	struct FragmentationMetrics {
+		VkDeviceSize blockBytes;
+		VkDeviceSize allocationBytes;
+		VkDeviceSize largestUnusedRange;
+		uint32_t blockCount;
+		// 0 when the unused bytes are one range, close to 1 when they are
+		// scattered
+		float fragmentation;
+	};
+
+	struct DefragmentationTotals {
+		uint32_t runs;
+		VkDeviceSize bytesMoved;
+		VkDeviceSize bytesFreed;
+		uint32_t allocationsMoved;
+		uint32_t blocksFreed;
+	};
+
+	struct PendingMove {
+		MovableResource old;
+		MovableResource moved;
+	};
+
+	// moves registered resources out of sparsely used memory blocks, at
+	// most maxBytesPerFrame in one pass at a time. a pass is copied on the
+	// graphics queue after the previous frame finished and ends once the
+	// copies retired. not thread safe
+	struct Defragmenter {
+		VkDeviceSize maxBytesPerFrame;
+
+		VkCommandPool cmdPool;
+		// reused by every pass, only one is in flight
+		VkCommandBuffer cmdBuffer;
+
+		// keyed on the allocation, which survives moves
+		std::unordered_map<VmaAllocation, MovableResource> movable;
+
+		// null between runs
+		VmaDefragmentationContext context;
+		uint32_t passCount;
+		VmaDefragmentationPassMoveInfo pass;
+		bool passOpen;
+		uint64_t passRetireValue;
+		std::vector<PendingMove> moves;
+		// released by their owner while being moved
+		std::vector<MovableResource> releasedDuringPass;
+
+		FragmentationMetrics metrics;
+		uint64_t metricsFrame;
+		DefragmentationTotals totals;
+	};
+
+	// maxBytesPerFrame of 0 never defragments
+	Defragmenter createDefragmenter(
+		const VulkanContext& ctx,
+		const uint32_t graphicsFamilyIndex,
+		const VkDeviceSize maxBytesPerFrame
+	);
+	// the device has to be idle, an open pass is finished
+	void destroyDefragmenter(
+		const VulkanContext& ctx, Defragmenter& defragmenter
+	);
+
+	void registerMovable(
+		Defragmenter& defragmenter, MovableResource&& resource
+	);
+	// the resource is never moved again. one that is being moved already
+	// was handed to its owner through onMoved
+	void unregisterMovable(
+		Defragmenter& defragmenter, const VmaAllocation allocation
+	);
+	// unregisters and destroys, or leaves it to the end of the pass moving it
+	void destroyMovableBuffer(
+		const VulkanContext& ctx,
+		Defragmenter& defragmenter,
+		const Buffer& buffer
+	);
+	void destroyMovableImage(
+		const VulkanContext& ctx,
+		Defragmenter& defragmenter,
+		const Image& image
+	);
+
+	// ends the open pass once its copies retired, then measures
+	// fragmentation every few hundred frames and starts a run past a
+	// threshold. a run submits one pass per frame to graphicsQueue, which
+	// waits for frameNumber - 1 on frameTimeline. call once per frame
+	// before the frame's graph is compiled
+	void updateDefragmenter(
+		const VulkanContext& ctx,
+		Defragmenter& defragmenter,
+		vkutils::TimelineQueue& graphicsQueue,
+		const VkSemaphore frameTimeline,
+		const uint64_t frameNumber
+	);
+
+	// appends to the gpu memory window
+	void drawDefragmenterWindow(const Defragmenter& defragmenter);
+}  // namespace VulkanRenderer
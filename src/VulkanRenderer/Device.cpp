@@ -5,6 +5,7 @@
 #include "RendererPCH.h"
 #include "debug/Debug.h"
 
+#include <algorithm>
 #include <iostream>
 #include <optional>
 #include <sstream>
@@ -20,6 +21,7 @@ namespace {
 		uint32_t graphics;
 		uint32_t presentation;
 		uint32_t transfer;
+		uint32_t compute;
 	};
 
 	std::optional<uint32_t> bitscanForward(uint32_t val);
@@ -50,11 +52,14 @@ Device VulkanRenderer::createDevice(
 	DeletionQueue &deletionQueue
 ) {
 	std::vector<const char *> requiredDeviceExtensions{
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 		VK_KHR_MAINTENANCE1_EXTENSION_NAME,
 		VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
 		VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
 	};
+	// headless devices never present
+	if (surface != VK_NULL_HANDLE) {
+		requiredDeviceExtensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 	VkPhysicalDeviceVulkan13Features vulkan13Features{
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
 		.synchronization2 = VK_TRUE,
@@ -64,6 +69,18 @@ Device VulkanRenderer::createDevice(
 		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
 		.pNext = &vulkan13Features,
 		.descriptorIndexing = VK_TRUE,
+		// the bindless heap
+		.shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
+		.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE,
+		.shaderStorageImageArrayNonUniformIndexing = VK_TRUE,
+		.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingStorageImageUpdateAfterBind = VK_TRUE,
+		.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE,
+		.descriptorBindingUpdateUnusedWhilePending = VK_TRUE,
+		.descriptorBindingPartiallyBound = VK_TRUE,
+		.runtimeDescriptorArray = VK_TRUE,
+		.hostQueryReset = VK_TRUE,
+		.timelineSemaphore = VK_TRUE,
 		.bufferDeviceAddress = VK_TRUE,
 
 	};
@@ -73,6 +90,9 @@ Device VulkanRenderer::createDevice(
 	};
 	VkPhysicalDeviceFeatures defaultFeatures{
 		.samplerAnisotropy = VK_TRUE,
+		.shaderSampledImageArrayDynamicIndexing = VK_TRUE,
+		.shaderStorageBufferArrayDynamicIndexing = VK_TRUE,
+		.shaderStorageImageArrayDynamicIndexing = VK_TRUE,
 	};
 
 	VkPhysicalDeviceFeatures2 requiredFeatures{
@@ -85,6 +105,17 @@ Device VulkanRenderer::createDevice(
 
 	device.physical = findSuitablePhysicalDevice(instance, surface);
 
+	// optional, vma estimates the budget without it
+	std::vector<const char *> budgetExtension{ queryDeviceExtensions(
+		device.physical, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME }
+	) };
+	device.memoryBudget = !budgetExtension.empty();
+	if (device.memoryBudget) {
+		requiredDeviceExtensions.emplace_back(
+			VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
+		);
+	}
+
 	vkGetPhysicalDeviceProperties(device.physical, &device.properties);
 
 	QueueInfo queueInfo{
@@ -94,7 +125,8 @@ Device VulkanRenderer::createDevice(
 
 	QueueFamilyQueueCounts queueFamilyCounts{ .graphics = 1,
 											  .presentation = 1,
-											  .transfer = 1 };
+											  .transfer = 1,
+											  .compute = 1 };
 
 	device.logical = createLogicalDevice(
 		device.physical,
@@ -117,25 +149,49 @@ Queues getDeviceQueues(const Device &device) {
 	VkQueue graphicsQueue{};
 	VkQueue presentationQueue{};
 	VkQueue transferQueue{};
+	VkQueue computeQueue{};
 
 	for (auto index : device.queueFamilyIndices.uniqueIndices) {
+		uint32_t familyQueueCount{
+			device.queueFamilyIndices.familyQueueCounts.at(index.first)
+		};
+
 		for (uint32_t i{}; i < index.second.size(); i++) {
 			QueueFamily familySupported{ index.second[i] };
 			uint32_t queueFamilyIndex{ index.first };
+			uint32_t queueIndex{ std::min(i, familyQueueCount - 1) };
 
 			switch (familySupported) {
 				case QueueFamily::graphics:
 					vkGetDeviceQueue(
-						device.logical, queueFamilyIndex, i, &graphicsQueue
+						device.logical,
+						queueFamilyIndex,
+						queueIndex,
+						&graphicsQueue
 					);
+					break;
 				case QueueFamily::presentation:
 					vkGetDeviceQueue(
-						device.logical, queueFamilyIndex, i, &presentationQueue
+						device.logical,
+						queueFamilyIndex,
+						queueIndex,
+						&presentationQueue
 					);
 					break;
 				case QueueFamily::transfer:
 					vkGetDeviceQueue(
-						device.logical, queueFamilyIndex, i, &transferQueue
+						device.logical,
+						queueFamilyIndex,
+						queueIndex,
+						&transferQueue
+					);
+					break;
+				case QueueFamily::compute:
+					vkGetDeviceQueue(
+						device.logical,
+						queueFamilyIndex,
+						queueIndex,
+						&computeQueue
 					);
 					break;
 				default:
@@ -146,7 +202,8 @@ Queues getDeviceQueues(const Device &device) {
 
 	Queues queues{ .graphicsQueue = graphicsQueue,
 				   .presentationQueue = presentationQueue,
-				   .transferQueue = transferQueue };
+				   .transferQueue = transferQueue,
+				   .computeQueue = computeQueue };
 
 	return queues;
 }
@@ -160,6 +217,12 @@ namespace {
 		const uint32_t &presentationQueueIndices{
 			queueInfo.packedQueueFamilyIndices.at(QueueFamily::presentation)
 		};
+		const uint32_t &computeQueueIndices{
+			queueInfo.packedQueueFamilyIndices.at(QueueFamily::compute)
+		};
+		const uint32_t &transferQueueIndices{
+			queueInfo.packedQueueFamilyIndices.at(QueueFamily::transfer)
+		};
 
 		QueueFamilyIndices queueFamilyIndices{};
 
@@ -170,6 +233,7 @@ namespace {
 		uint32_t graphicsIndex{};
 		uint32_t presentationIndex{};
 		uint32_t transferIndex{};
+		uint32_t computeIndex{};
 
 		if (bestCaseGraphicsPresentationIndices) {
 			graphicsIndex =
@@ -180,11 +244,31 @@ namespace {
 			presentationIndex =
 				bitscanForward(presentationQueueIndices).value();
 		}
-		transferIndex = graphicsIndex;
+
+		// transfer only families are the dma engines, uploads on them run
+		// alongside rendering
+		uint32_t dedicatedTransferIndices{ transferQueueIndices &
+										   ~graphicsQueueIndices &
+										   ~computeQueueIndices };
+		if (dedicatedTransferIndices) {
+			transferIndex = bitscanForward(dedicatedTransferIndices).value();
+		} else {
+			transferIndex = graphicsIndex;
+		}
+
+		// compute families without graphics run asynchronously to it
+		uint32_t asyncComputeIndices{ computeQueueIndices &
+									  ~graphicsQueueIndices };
+		if (asyncComputeIndices) {
+			computeIndex = bitscanForward(asyncComputeIndices).value();
+		} else {
+			computeIndex = graphicsIndex;
+		}
 
 		queueFamilyIndices.graphicsIndex = graphicsIndex;
 		queueFamilyIndices.presentationIndex = presentationIndex;
 		queueFamilyIndices.transferIndex = transferIndex;
+		queueFamilyIndices.computeIndex = computeIndex;
 
 		queueFamilyIndices.uniqueIndices[graphicsIndex].emplace_back(
 			QueueFamily::graphics
@@ -195,11 +279,20 @@ namespace {
 		queueFamilyIndices.uniqueIndices[transferIndex].emplace_back(
 			QueueFamily::transfer
 		);
+		queueFamilyIndices.uniqueIndices[computeIndex].emplace_back(
+			QueueFamily::compute
+		);
+
+		for (const auto &index : queueFamilyIndices.uniqueIndices) {
+			queueFamilyIndices.familyQueueCounts[index.first] =
+				queueInfo.numQueuesAtIndex[index.first];
+		}
 
 		queueFamilyIndices.indices[QueueFamily::graphics] = graphicsIndex;
 		queueFamilyIndices.indices[QueueFamily::presentation] =
 			presentationIndex;
 		queueFamilyIndices.indices[QueueFamily::transfer] = transferIndex;
+		queueFamilyIndices.indices[QueueFamily::compute] = computeIndex;
 
 		return queueFamilyIndices;
 	}
@@ -236,13 +329,15 @@ namespace {
 				pDevice, &queueFamilyCount, queueFamilies.data()
 			);
 
-			VkBool32 thisDeviceSupportsSurface{};
+			VkBool32 thisDeviceSupportsSurface{ surface == VK_NULL_HANDLE };
 			VkBool32 thisDeviceSupportsGraphics{};
 			for (uint32_t i{}; i < queueFamilies.size(); i++) {
 				VkBool32 surfaceSupported{};
-				vkGetPhysicalDeviceSurfaceSupportKHR(
-					pDevice, i, surface, &surfaceSupported
-				);
+				if (surface != VK_NULL_HANDLE) {
+					vkGetPhysicalDeviceSurfaceSupportKHR(
+						pDevice, i, surface, &surfaceSupported
+					);
+				}
 
 				thisDeviceSupportsSurface |= surfaceSupported;
 
@@ -292,23 +387,25 @@ namespace {
 	) {
 		VkDevice device{};
 
-		const float queuePriority[3] = { 1.0f, 1.0f, 1.0f };
+		const float queuePriority[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
 		std::vector<VkDeviceQueueCreateInfo> queuesToCreate{};
 		size_t totalNumQueues{ queueFamilyCounts.graphics
 							   + queueFamilyCounts.presentation
-							   + queueFamilyCounts.transfer };
+							   + queueFamilyCounts.transfer
+							   + queueFamilyCounts.compute };
 		queuesToCreate.reserve(totalNumQueues);
 
 		bool graphicsQueuesFound{};
 		bool transferQueuesFound{};
 		bool presentationQueuesFound{};
+		bool computeQueuesFound{};
 
 		for (const auto &index : queueFamilyIndices.uniqueIndices) {
 			uint32_t nQueues{};
 
 			if (graphicsQueuesFound && presentationQueuesFound
-				&& transferQueuesFound) {
+				&& transferQueuesFound && computeQueuesFound) {
 				break;
 			}
 
@@ -332,11 +429,23 @@ namespace {
 							nQueues += queueFamilyCounts.transfer;
 						}
 						break;
+					case QueueFamily::compute:
+						if (!computeQueuesFound) {
+							computeQueuesFound = true;
+							nQueues += queueFamilyCounts.compute;
+						}
+						break;
 					default:
 						break;
 				}
 			}
 
+			// software drivers like lavapipe expose a single queue, roles
+			// that dont fit share the last queue of the family
+			nQueues = std::min(
+				nQueues, queueFamilyIndices.familyQueueCounts.at(index.first)
+			);
+
 			if (nQueues) {
 				VkDeviceQueueCreateInfo queueCreateInfo{
 					.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
@@ -388,24 +497,36 @@ namespace {
 		uint32_t graphicsQueueIndices{};
 		uint32_t presentationQueueIndices{};
 		uint32_t transferQueueIndices{};
+		uint32_t computeQueueIndices{};
 		for (uint32_t i{}; i < queueFamilyProps.size(); i++) {
 			queueInfo.numQueuesAtIndex[i] = queueFamilyProps[i].queueCount;
 
+			if (queueFamilyProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				graphicsQueueIndices |= 1 << i;
+			}
+
+			// without a surface nothing is presented, so presentation
+			// shares the graphics families
 			VkBool32 surfaceSupport{};
-			vkGetPhysicalDeviceSurfaceSupportKHR(
-				physicalDevice, i, surface, &surfaceSupport
-			);
+			if (surface != VK_NULL_HANDLE) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(
+					physicalDevice, i, surface, &surfaceSupport
+				);
+			} else {
+				surfaceSupport =
+					(queueFamilyProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+			}
 			if (surfaceSupport) {
 				presentationQueueIndices |= 1 << i;
 			}
 
-			if (queueFamilyProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-				graphicsQueueIndices |= 1 << i;
-			}
-
 			if (queueFamilyProps[i].queueFlags & VK_QUEUE_TRANSFER_BIT) {
 				transferQueueIndices |= 1 << i;
 			}
+
+			if (queueFamilyProps[i].queueFlags & VK_QUEUE_COMPUTE_BIT) {
+				computeQueueIndices |= 1 << i;
+			}
 		}
 
 		queueInfo.packedQueueFamilyIndices[QueueFamily::graphics] =
@@ -414,6 +535,8 @@ namespace {
 			presentationQueueIndices;
 		queueInfo.packedQueueFamilyIndices[QueueFamily::transfer] =
 			transferQueueIndices;
+		queueInfo.packedQueueFamilyIndices[QueueFamily::compute] =
+			computeQueueIndices;
 
 		return queueInfo;
 	}
@@ -16,22 +16,30 @@ enum class QueueFamily : uint32_t {
   graphics = 0,
   transfer,
   presentation,
+  compute,
 };
 
 struct Queues {
   VkQueue graphicsQueue;
   VkQueue presentationQueue;
   VkQueue transferQueue;
+  // a dedicated compute family when the device has one, otherwise a second
+  // queue of the graphics family if it exposes one
+  VkQueue computeQueue;
 };
 
 struct QueueFamilyIndices {
   uint32_t graphicsIndex{static_cast<uint32_t>(-1)};
   uint32_t transferIndex{static_cast<uint32_t>(-1)};
   uint32_t presentationIndex{static_cast<uint32_t>(-1)};
+  uint32_t computeIndex{static_cast<uint32_t>(-1)};
 
   std::unordered_map<QueueFamily, uint32_t> indices;
 
   std::unordered_map<uint32_t, std::vector<QueueFamily>> uniqueIndices;
+
+  // number of queues the driver exposes for each family in uniqueIndices
+  std::unordered_map<uint32_t, uint32_t> familyQueueCounts;
 };
 
 struct Device {
@@ -40,11 +48,15 @@ struct Device {
 
   VkPhysicalDeviceProperties properties;
   VkPhysicalDeviceMemoryProperties memProperties;
+  // VK_EXT_memory_budget is enabled, vma reports the driver's budget instead
+  // of estimating it
+  bool memoryBudget;
 
   QueueFamilyIndices queueFamilyIndices;
 };
 
 namespace VulkanRenderer {
+// surface may be VK_NULL_HANDLE for headless devices
 Device createDevice(const VkSurfaceKHR &surface, const VkInstance &instance,
                     DeletionQueue &deletionQueue);
 }
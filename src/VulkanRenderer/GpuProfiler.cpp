@@ -0,0 +1,361 @@
+#include "RendererPCH.h"
+
+#include "GpuProfiler.h"
+
+#include "Cleanup.h"
+#include "Context.h"
+#include "debug/Debug.h"
+#include "utils/ChromeTrace.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+	using namespace VulkanRenderer;
+
+	// a begin and an end query per zone
+	constexpr uint32_t MAX_GPU_ZONES_PER_FRAME{ 256 };
+	constexpr size_t MAX_GPU_HISTORY_ZONES{ 16384 };
+
+	constexpr const char* GPU_TRACE_PATH{ "gpu_trace.json" };
+
+	std::vector<GpuZoneTiming> resolveZones(
+		const VulkanContext& ctx,
+		GpuProfiler& profiler,
+		const GpuProfilerFrame& frame
+	);
+}  // namespace
+
+VulkanRenderer::GpuProfiler VulkanRenderer::createGpuProfiler(
+	const VulkanContext& ctx,
+	const uint32_t framesInFlight,
+	std::span<const GpuProfilerQueue> queues,
+	DeletionQueue& deletionQueue
+) {
+	GpuProfiler profiler{
+		.frames = std::vector<GpuProfilerFrame>(framesInFlight),
+		.maxQueriesPerFrame = MAX_GPU_ZONES_PER_FRAME * 2,
+		.queues = { queues.begin(), queues.end() },
+		.nsPerTick = ctx.device.properties.limits.timestampPeriod,
+	};
+
+	uint32_t familyCount{};
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		ctx.device.physical, &familyCount, nullptr
+	);
+	std::vector<VkQueueFamilyProperties> familyProperties(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(
+		ctx.device.physical, &familyCount, familyProperties.data()
+	);
+
+	for (const auto& queue : queues) {
+		const uint32_t validBits{
+			familyProperties[queue.familyIndex].timestampValidBits
+		};
+		if (validBits == 0) {
+			logWarning("queue ", queue.name, " can't write timestamps");
+		}
+
+		profiler.timestampMasks.emplace_back(
+			validBits >= 64 ? std::numeric_limits<uint64_t>::max()
+							: (uint64_t{ 1 } << validBits) - 1
+		);
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = profiler.maxQueriesPerFrame,
+	};
+
+	std::vector<VkQueryPool> queryPools;
+	for (auto& frame : profiler.frames) {
+		if (vkCreateQueryPool(
+				ctx.device.logical, &queryPoolInfo, nullptr, &frame.queryPool
+			) != VK_SUCCESS) {
+			logFatal("could not create timestamp query pool");
+		}
+		// queries have to be reset before their first use
+		vkResetQueryPool(
+			ctx.device.logical, frame.queryPool, 0, profiler.maxQueriesPerFrame
+		);
+
+		queryPools.emplace_back(frame.queryPool);
+	}
+
+	deletionQueue.pushFunction([=]() {
+		for (const auto& queryPool : queryPools) {
+			vkDestroyQueryPool(ctx.device.logical, queryPool, nullptr);
+		}
+	});
+
+	return profiler;
+}
+
+void VulkanRenderer::beginGpuProfilerFrame(
+	const VulkanContext& ctx,
+	GpuProfiler& profiler,
+	const uint32_t frameIndex,
+	const uint64_t frameNumber
+) {
+	GpuProfilerFrame& frame{ profiler.frames[frameIndex] };
+	profiler.currentFrame = frameIndex;
+
+	if (frame.usedQueries > 0) {
+		std::vector<GpuZoneTiming> zones{ resolveZones(ctx, profiler, frame) };
+
+		if (!zones.empty()) {
+			double frameStartMs{ std::numeric_limits<double>::max() };
+			double frameEndMs{};
+			for (const auto& zone : zones) {
+				frameStartMs = std::min(frameStartMs, zone.startMs);
+				frameEndMs =
+					std::max(frameEndMs, zone.startMs + zone.durationMs);
+			}
+
+			profiler.frameTimes[profiler.frameTimesOffset] =
+				(float)(frameEndMs - frameStartMs);
+			profiler.frameTimesOffset =
+				(profiler.frameTimesOffset + 1) % profiler.frameTimes.size();
+
+			profiler.history.insert(
+				profiler.history.end(), zones.begin(), zones.end()
+			);
+			while (profiler.history.size() > MAX_GPU_HISTORY_ZONES) {
+				profiler.history.pop_front();
+			}
+
+			profiler.frameZones = std::move(zones);
+		}
+
+		vkResetQueryPool(
+			ctx.device.logical, frame.queryPool, 0, frame.usedQueries
+		);
+	}
+
+	frame.usedQueries = 0;
+	frame.frameNumber = frameNumber;
+	frame.zones.clear();
+}
+
+uint32_t VulkanRenderer::reserveGpuZone(
+	GpuProfiler& profiler, const uint32_t queue, const std::string& name
+) {
+	GpuProfilerFrame& frame{ profiler.frames[profiler.currentFrame] };
+
+	if (profiler.timestampMasks[queue] == 0 ||
+		frame.usedQueries + 2 > profiler.maxQueriesPerFrame) {
+		return GPU_ZONE_NONE;
+	}
+
+	frame.zones.emplace_back(GpuZoneQueries{
+		.name = name,
+		.queue = queue,
+		.firstQuery = frame.usedQueries,
+	});
+	frame.usedQueries += 2;
+
+	return (uint32_t)frame.zones.size() - 1;
+}
+
+void VulkanRenderer::cmdWriteGpuZoneBegin(
+	const GpuProfiler& profiler,
+	const VkCommandBuffer cmdBuffer,
+	const uint32_t zone
+) {
+	if (zone == GPU_ZONE_NONE) {
+		return;
+	}
+
+	const GpuProfilerFrame& frame{ profiler.frames[profiler.currentFrame] };
+	vkCmdWriteTimestamp2(
+		cmdBuffer,
+		VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT,
+		frame.queryPool,
+		frame.zones[zone].firstQuery
+	);
+}
+
+uint32_t VulkanRenderer::cmdBeginGpuZone(
+	GpuProfiler& profiler,
+	const VkCommandBuffer cmdBuffer,
+	const uint32_t queue,
+	const std::string& name
+) {
+	const uint32_t zone{ reserveGpuZone(profiler, queue, name) };
+	cmdWriteGpuZoneBegin(profiler, cmdBuffer, zone);
+
+	return zone;
+}
+
+void VulkanRenderer::cmdEndGpuZone(
+	const GpuProfiler& profiler,
+	const VkCommandBuffer cmdBuffer,
+	const uint32_t zone
+) {
+	if (zone == GPU_ZONE_NONE) {
+		return;
+	}
+
+	const GpuProfilerFrame& frame{ profiler.frames[profiler.currentFrame] };
+	vkCmdWriteTimestamp2(
+		cmdBuffer,
+		VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT,
+		frame.queryPool,
+		frame.zones[zone].firstQuery + 1
+	);
+}
+
+VulkanRenderer::ScopedGpuZone::ScopedGpuZone(
+	GpuProfiler* profiler,
+	const VkCommandBuffer cmdBuffer,
+	const uint32_t queue,
+	const std::string& name
+)
+	: m_Profiler(profiler), m_CmdBuffer(cmdBuffer), m_Zone(GPU_ZONE_NONE) {
+	if (m_Profiler) {
+		m_Zone = cmdBeginGpuZone(*m_Profiler, m_CmdBuffer, queue, name);
+	}
+}
+
+VulkanRenderer::ScopedGpuZone::~ScopedGpuZone() {
+	if (m_Profiler) {
+		cmdEndGpuZone(*m_Profiler, m_CmdBuffer, m_Zone);
+	}
+}
+
+void VulkanRenderer::drawGpuProfilerWindow(const GpuProfiler& profiler) {
+	ImGui::Begin("gpu timings");
+
+	const uint32_t newestFrameTime{
+		(profiler.frameTimesOffset + (uint32_t)profiler.frameTimes.size() - 1) %
+		(uint32_t)profiler.frameTimes.size()
+	};
+	ImGui::Text("frame %.3f ms", profiler.frameTimes[newestFrameTime]);
+	ImGui::PlotLines(
+		"##frame times",
+		profiler.frameTimes.data(),
+		(int)profiler.frameTimes.size(),
+		(int)profiler.frameTimesOffset,
+		nullptr,
+		0.f,
+		std::numeric_limits<float>::max(),
+		ImVec2(0.f, 60.f)
+	);
+
+	if (ImGui::BeginTable("zones", 3)) {
+		ImGui::TableSetupColumn("pass");
+		ImGui::TableSetupColumn("queue");
+		ImGui::TableSetupColumn("ms");
+		ImGui::TableHeadersRow();
+
+		for (const auto& zone : profiler.frameZones) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(zone.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(profiler.queues[zone.queue].name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", zone.durationMs);
+		}
+
+		ImGui::EndTable();
+	}
+
+	if (ImGui::Button("export trace")) {
+		writeGpuTrace(profiler, GPU_TRACE_PATH);
+	}
+
+	ImGui::End();
+}
+
+bool VulkanRenderer::writeGpuTrace(
+	const GpuProfiler& profiler, const std::filesystem::path& path
+) {
+	// the gpu gets its own process row so cpu traces can be merged in
+	constexpr uint32_t gpuTracePid{ 1 };
+
+	std::vector<TraceTrack> tracks;
+	for (uint32_t i{}; i < profiler.queues.size(); i++) {
+		tracks.emplace_back(TraceTrack{
+			.name = "gpu " + profiler.queues[i].name,
+			.pid = gpuTracePid,
+			.tid = i,
+		});
+	}
+
+	std::vector<TraceEvent> events;
+	events.reserve(profiler.history.size());
+	for (const auto& zone : profiler.history) {
+		events.emplace_back(TraceEvent{
+			.name = zone.name,
+			.pid = gpuTracePid,
+			.tid = zone.queue,
+			.startUs = zone.startMs * 1000.0,
+			.durationUs = zone.durationMs * 1000.0,
+		});
+	}
+
+	return writeChromeTrace(path, events, tracks);
+}
+
+namespace {
+	std::vector<GpuZoneTiming> resolveZones(
+		const VulkanContext& ctx,
+		GpuProfiler& profiler,
+		const GpuProfilerFrame& frame
+	) {
+		// a value and an availability word per query. the frame retired, so
+		// every query written is available and nothing waits
+		std::vector<uint64_t> results(frame.usedQueries * 2);
+		VkResult res{ vkGetQueryPoolResults(
+			ctx.device.logical,
+			frame.queryPool,
+			0,
+			frame.usedQueries,
+			results.size() * sizeof(uint64_t),
+			results.data(),
+			2 * sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT
+		) };
+		if (res != VK_SUCCESS && res != VK_NOT_READY) {
+			logWarning("could not read timestamp queries");
+			return {};
+		}
+
+		std::vector<GpuZoneTiming> zones;
+		for (const auto& zone : frame.zones) {
+			const uint32_t begin{ zone.firstQuery * 2 };
+			const uint32_t end{ begin + 2 };
+			if (results[begin + 1] == 0 || results[end + 1] == 0) {
+				continue;
+			}
+
+			const uint64_t mask{ profiler.timestampMasks[zone.queue] };
+			const uint64_t beginTicks{ results[begin] & mask };
+			const uint64_t endTicks{ results[end] & mask };
+			if (endTicks < beginTicks) {
+				continue;
+			}
+
+			if (profiler.firstTimestamp == 0) {
+				profiler.firstTimestamp = beginTicks;
+			}
+
+			const double msPerTick{ profiler.nsPerTick / 1e6 };
+			zones.emplace_back(GpuZoneTiming{
+				.name = zone.name,
+				.queue = zone.queue,
+				.frameNumber = frame.frameNumber,
+				.startMs =
+					((double)beginTicks - (double)profiler.firstTimestamp) *
+					msPerTick,
+				.durationMs = (double)(endTicks - beginTicks) * msPerTick,
+			});
+		}
+
+		return zones;
+	}
+}  // namespace
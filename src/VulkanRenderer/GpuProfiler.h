@@ -0,0 +1,138 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <deque>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+// forward declerations
+struct VulkanContext;
+class DeletionQueue;
+
+namespace VulkanRenderer {
+	constexpr uint32_t GPU_ZONE_NONE{ UINT32_MAX };
+
+	struct GpuProfilerQueue {
+		std::string name;
+		uint32_t familyIndex;
+	};
+
+	struct GpuZoneQueries {
+		std::string name;
+		uint32_t queue;
+		uint32_t firstQuery;
+	};
+
+	struct GpuProfilerFrame {
+		VkQueryPool queryPool;
+		uint32_t usedQueries;
+		uint64_t frameNumber;
+		std::vector<GpuZoneQueries> zones;
+	};
+
+	struct GpuZoneTiming {
+		std::string name;
+		uint32_t queue;
+		uint64_t frameNumber;
+
+		// relative to the first timestamp the profiler read
+		double startMs;
+		double durationMs;
+	};
+
+	// a begin and end timestamp around each zone, one query pool per frame in
+	// flight. results are only read once the frame that wrote them retired so
+	// reading them never waits on the gpu
+	struct GpuProfiler {
+		std::vector<GpuProfilerFrame> frames;
+		uint32_t currentFrame;
+		uint32_t maxQueriesPerFrame;
+
+		// indexed by the queue passed to cmdBeginGpuZone. the mask is 0 when
+		// the queue's family can't write timestamps
+		std::vector<GpuProfilerQueue> queues;
+		std::vector<uint64_t> timestampMasks;
+		double nsPerTick;
+		uint64_t firstTimestamp;
+
+		// newest resolved frame
+		std::vector<GpuZoneTiming> frameZones;
+		std::array<float, 128> frameTimes;
+		uint32_t frameTimesOffset;
+
+		// the last few thousand zones, for trace export
+		std::deque<GpuZoneTiming> history;
+	};
+
+	GpuProfiler createGpuProfiler(
+		const VulkanContext& ctx,
+		const uint32_t framesInFlight,
+		std::span<const GpuProfilerQueue> queues,
+		DeletionQueue& deletionQueue
+	);
+
+	// resolves the zones the frame slot recorded last time and resets it.
+	// that frame has to have retired
+	void beginGpuProfilerFrame(
+		const VulkanContext& ctx,
+		GpuProfiler& profiler,
+		const uint32_t frameIndex,
+		const uint64_t frameNumber
+	);
+
+	// returns GPU_ZONE_NONE when the queue can't write timestamps or the
+	// frame ran out of queries, ending it is then a no-op
+	uint32_t cmdBeginGpuZone(
+		GpuProfiler& profiler,
+		const VkCommandBuffer cmdBuffer,
+		const uint32_t queue,
+		const std::string& name
+	);
+	void cmdEndGpuZone(
+		const GpuProfiler& profiler,
+		const VkCommandBuffer cmdBuffer,
+		const uint32_t zone
+	);
+
+	// for recording on several threads. zones are reserved on one thread,
+	// after that their timestamps can be written from any thread
+	uint32_t reserveGpuZone(
+		GpuProfiler& profiler, const uint32_t queue, const std::string& name
+	);
+	void cmdWriteGpuZoneBegin(
+		const GpuProfiler& profiler,
+		const VkCommandBuffer cmdBuffer,
+		const uint32_t zone
+	);
+
+	// a null profiler records nothing
+	class ScopedGpuZone {
+	   public:
+		ScopedGpuZone(
+			GpuProfiler* profiler,
+			const VkCommandBuffer cmdBuffer,
+			const uint32_t queue,
+			const std::string& name
+		);
+		~ScopedGpuZone();
+
+		ScopedGpuZone(const ScopedGpuZone&) = delete;
+		ScopedGpuZone& operator=(const ScopedGpuZone&) = delete;
+
+	   private:
+		GpuProfiler* m_Profiler;
+		VkCommandBuffer m_CmdBuffer;
+		uint32_t m_Zone;
+	};
+
+	void drawGpuProfilerWindow(const GpuProfiler& profiler);
+
+	// one track per queue
+	bool writeGpuTrace(
+		const GpuProfiler& profiler, const std::filesystem::path& path
+	);
+}  // namespace VulkanRenderer
@@ -13,6 +13,7 @@
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_vulkan.h>
 
+#include <algorithm>
 #include <array>
 
 void VulkanRenderer::initImGui(
@@ -63,8 +64,10 @@ void VulkanRenderer::initImGui(
 		.QueueFamily = ctx.device.queueFamilyIndices.graphicsIndex,
 		.Queue = state.graphicsQueue,
 		.DescriptorPool = imguiPool,
-		.MinImageCount = 3,
-		.ImageCount = 3,
+		// imgui keeps a vertex buffer per image, enough for every frame in
+		// flight since the swapchain has one more image than those
+		.MinImageCount = 2,
+		.ImageCount = std::max((uint32_t)state.swapchain.images.size(), 2u),
 		.MSAASamples = VK_SAMPLE_COUNT_1_BIT,
 		.UseDynamicRendering = VK_TRUE,
 		.ColorAttachmentFormat = state.swapchain.format,
@@ -76,7 +79,7 @@ void VulkanRenderer::initImGui(
 	vkutils::immediateSubmit(
 		ctx,
 		state.immediateCommandBuffer,
-		state.transferQueue,
+		state.graphicsQueue,
 		state.immediateFence,
 		[]() {
 			ImGui_ImplVulkan_CreateFontsTexture();
@@ -84,17 +87,20 @@ void VulkanRenderer::initImGui(
 	);
 
 	ImGui_ImplVulkan_DestroyFontsTexture();
-	deletionQueue.pushFunction([&]() {
+	deletionQueue.pushFunction([=]() {
 		vkDestroyDescriptorPool(ctx.device.logical, imguiPool, nullptr);
 		ImGui_ImplVulkan_Shutdown();
 	});
 }
 
-void VulkanRenderer::updateImGui() {
+void VulkanRenderer::updateImGui(const VulkanState& state) {
 	ImGui_ImplVulkan_NewFrame();
 	ImGui::NewFrame();
 
 	ImGui::ShowDemoWindow();
+	drawGpuProfilerWindow(state.gpuProfiler);
+	drawMemoryBudgetWindow(state.memoryBudget);
+	drawDefragmenterWindow(state.defragmenter);
 
 	// doesnt actually render, only readys data
 	ImGui::Render();
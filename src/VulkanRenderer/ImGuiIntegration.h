@@ -18,7 +18,8 @@ namespace VulkanRenderer {
 			DeletionQueue& deletionQueue
 		);
 
-	void updateImGui();
+	// builds the frame's ui, including the profiler windows
+	void updateImGui(const VulkanState& state);
 
 	void cmdRenderImGui(
 			const VulkanContext& ctx, 
@@ -10,7 +10,11 @@ std::tuple<VkInstance, VkDebugUtilsMessengerEXT> VulkanRenderer::createInstance(
 		SDL_Window* window,
 		DeletionQueue& deletionQueue
 	) {
-	std::vector<const char*> requiredSurfaceExtensions{getSurfaceExtensions(window)};
+	// headless contexts have no window and need no surface extensions
+	std::vector<const char*> requiredSurfaceExtensions{};
+	if (window) {
+		requiredSurfaceExtensions = getSurfaceExtensions(window);
+	}
 
 	std::vector<const char*> additionalRequiredExtensions{
 		VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
@@ -0,0 +1,216 @@
+#include "RendererPCH.h"
+
+#include "MemoryBudget.h"
+
+#include "Cleanup.h"
+#include "Context.h"
+#include "debug/Debug.h"
+
+#include <imgui.h>
+
+using namespace VulkanRenderer;
+
+namespace {
+	constexpr std::array<const char*, MEMORY_CATEGORY_COUNT>
+		MEMORY_CATEGORY_NAMES{
+			"other", "render targets", "simulation", "textures", "staging"
+		};
+
+	VkDeviceSize
+		getAllocationSize(const VulkanContext& ctx, VmaAllocation allocation);
+	float toMiB(const VkDeviceSize bytes);
+}  // namespace
+
+MemoryBudget VulkanRenderer::createMemoryBudget(
+	const VulkanContext& ctx, const float pressureThreshold
+) {
+	const VkPhysicalDeviceMemoryProperties& memProperties{
+		ctx.device.memProperties
+	};
+
+	MemoryBudget memoryBudget{ .pressureThreshold = pressureThreshold };
+	for (uint32_t i{}; i < memProperties.memoryHeapCount; i++) {
+		const VkMemoryHeap& heap{ memProperties.memoryHeaps[i] };
+		memoryBudget.heaps.emplace_back(MemoryHeapBudget{
+			.size = heap.size,
+			.deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+		});
+	}
+
+	return memoryBudget;
+}
+
+void VulkanRenderer::addMemoryPressureCallback(
+	MemoryBudget& memoryBudget, MemoryPressureCallback&& callback
+) {
+	memoryBudget.callbacks.emplace_back(std::move(callback));
+}
+
+void VulkanRenderer::updateMemoryBudget(
+	const VulkanContext& ctx,
+	MemoryBudget& memoryBudget,
+	const uint64_t frameNumber
+) {
+	// vma only refetches the driver's budget when the frame index changes
+	vmaSetCurrentFrameIndex(ctx.allocator, (uint32_t)frameNumber);
+
+	std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+	vmaGetHeapBudgets(ctx.allocator, budgets.data());
+
+	MemoryPressure pressure{};
+	bool overBudget{};
+	for (size_t i{}; i < memoryBudget.heaps.size(); i++) {
+		MemoryHeapBudget& heap{ memoryBudget.heaps[i] };
+		heap.usage = budgets[i].usage;
+		heap.budget = budgets[i].budget;
+
+		if (!heap.deviceLocal) {
+			continue;
+		}
+
+		pressure.usage += heap.usage;
+		pressure.budget += heap.budget;
+
+		VkDeviceSize threshold{
+			(VkDeviceSize)(heap.budget * memoryBudget.pressureThreshold)
+		};
+		if (heap.usage > threshold) {
+			pressure.excess += heap.usage - threshold;
+		}
+		overBudget |= heap.usage > heap.budget;
+	}
+
+	// allocations past the budget may fail or get paged out by the os
+	const bool underPressure{ pressure.excess > 0 };
+	if (underPressure && !memoryBudget.underPressure) {
+		logWarning(
+			"device memory under pressure: ",
+			toMiB(pressure.usage),
+			" of ",
+			toMiB(pressure.budget),
+			" MiB used"
+		);
+	}
+	if (overBudget && !memoryBudget.overBudget) {
+		logWarning("device memory over budget, allocations may fail");
+	}
+	memoryBudget.underPressure = underPressure;
+	memoryBudget.overBudget = overBudget;
+
+	for (size_t i{}; i < MEMORY_CATEGORY_COUNT; i++) {
+		memoryBudget.categoryUsage[i] =
+			getCategoryUsage(ctx, (MemoryCategory)i);
+	}
+
+	if (!underPressure) {
+		return;
+	}
+
+	for (const auto& callback : memoryBudget.callbacks) {
+		callback(pressure);
+	}
+}
+
+AllocationTracker* VulkanRenderer::createAllocationTracker(
+	DeletionQueue& deletionQueue
+) {
+	AllocationTracker* tracker{ new AllocationTracker{} };
+	deletionQueue.pushFunction([=]() { delete tracker; });
+
+	return tracker;
+}
+
+void VulkanRenderer::trackAllocation(
+	const VulkanContext& ctx,
+	const VmaAllocation allocation,
+	const MemoryCategory category
+) {
+	const VkDeviceSize size{ getAllocationSize(ctx, allocation) };
+
+	AllocationTracker& tracker{ *ctx.allocationTracker };
+	std::lock_guard lock{ tracker.mutex };
+	tracker.categories[allocation] = category;
+	tracker.categoryUsage[(size_t)category] += size;
+}
+
+void VulkanRenderer::untrackAllocation(
+	const VulkanContext& ctx, const VmaAllocation allocation
+) {
+	const VkDeviceSize size{ getAllocationSize(ctx, allocation) };
+
+	AllocationTracker& tracker{ *ctx.allocationTracker };
+	std::lock_guard lock{ tracker.mutex };
+	auto it{ tracker.categories.find(allocation) };
+	if (it == tracker.categories.end()) {
+		return;
+	}
+
+	tracker.categoryUsage[(size_t)it->second] -= size;
+	tracker.categories.erase(it);
+}
+
+VkDeviceSize VulkanRenderer::getCategoryUsage(
+	const VulkanContext& ctx, const MemoryCategory category
+) {
+	AllocationTracker& tracker{ *ctx.allocationTracker };
+	std::lock_guard lock{ tracker.mutex };
+
+	return tracker.categoryUsage[(size_t)category];
+}
+
+void VulkanRenderer::drawMemoryBudgetWindow(const MemoryBudget& memoryBudget
+) {
+	ImGui::Begin("gpu memory");
+
+	for (size_t i{}; i < memoryBudget.heaps.size(); i++) {
+		const MemoryHeapBudget& heap{ memoryBudget.heaps[i] };
+
+		ImGui::Text(
+			"heap %zu%s, %.0f MiB",
+			i,
+			heap.deviceLocal ? " (device local)" : "",
+			toMiB(heap.size)
+		);
+		ImGui::ProgressBar(
+			heap.budget > 0 ? (float)heap.usage / (float)heap.budget : 0.f
+		);
+		ImGui::Text(
+			"%.1f of %.1f MiB budget", toMiB(heap.usage), toMiB(heap.budget)
+		);
+	}
+	if (memoryBudget.underPressure) {
+		ImGui::TextColored(ImVec4(1.f, 0.4f, 0.2f, 1.f), "under pressure");
+	}
+
+	if (ImGui::BeginTable("categories", 2)) {
+		ImGui::TableSetupColumn("category");
+		ImGui::TableSetupColumn("MiB");
+		ImGui::TableHeadersRow();
+
+		for (size_t i{}; i < MEMORY_CATEGORY_COUNT; i++) {
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(MEMORY_CATEGORY_NAMES[i]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.1f", toMiB(memoryBudget.categoryUsage[i]));
+		}
+
+		ImGui::EndTable();
+	}
+
+	ImGui::End();
+}
+
+namespace {
+	VkDeviceSize
+		getAllocationSize(const VulkanContext& ctx, VmaAllocation allocation) {
+		VmaAllocationInfo allocInfo{};
+		vmaGetAllocationInfo(ctx.allocator, allocation, &allocInfo);
+
+		return allocInfo.size;
+	}
+
+	float toMiB(const VkDeviceSize bytes) {
+		return (float)bytes / (1024.f * 1024.f);
+	}
+}  // namespace
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vma/vk_mem_alloc.h>
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// forward declerations
+struct VulkanContext;
+class DeletionQueue;
+
+namespace VulkanRenderer {
+	// what an allocation is for, every buffer and image is created with one
+	enum class MemoryCategory : uint32_t {
+		other = 0,
+		// the draw image and render graph transients
+		renderTargets,
+		simulation,
+		textures,
+		// upload rings and staging buffers
+		staging,
+
+		count,
+	};
+	constexpr size_t MEMORY_CATEGORY_COUNT{ (size_t)MemoryCategory::count };
+
+	// fraction of a device local heap's budget past which it is under
+	// pressure
+	constexpr float MEMORY_PRESSURE_THRESHOLD{ 0.9f };
+
+	struct MemoryHeapBudget {
+		// by this process, the driver's numbers when VK_EXT_memory_budget is
+		// enabled and vma's estimate otherwise
+		VkDeviceSize usage;
+		VkDeviceSize budget;
+		VkDeviceSize size;
+		bool deviceLocal;
+	};
+
+	struct MemoryPressure {
+		// of every device local heap
+		VkDeviceSize usage;
+		VkDeviceSize budget;
+		// bytes to free to get every heap back under the threshold
+		VkDeviceSize excess;
+	};
+
+	// should free memory, by deferring deletions if it is still in use
+	using MemoryPressureCallback =
+		std::function<void(const MemoryPressure& pressure)>;
+
+	// category of every live buffer and image, owned by the context.
+	// allocations are made from several threads
+	struct AllocationTracker {
+		std::mutex mutex;
+		std::unordered_map<VmaAllocation, MemoryCategory> categories;
+		std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryUsage;
+	};
+
+	struct MemoryBudget {
+		std::vector<MemoryHeapBudget> heaps;
+		float pressureThreshold;
+		// as of the last update, warnings are logged when they turn on
+		bool underPressure;
+		bool overBudget;
+		// copied from the context's tracker
+		std::array<VkDeviceSize, MEMORY_CATEGORY_COUNT> categoryUsage;
+
+		std::vector<MemoryPressureCallback> callbacks;
+	};
+
+	MemoryBudget createMemoryBudget(
+		const VulkanContext& ctx,
+		const float pressureThreshold = MEMORY_PRESSURE_THRESHOLD
+	);
+
+	// callbacks run on the render thread during updateMemoryBudget and must
+	// outlive the budget's updates
+	void addMemoryPressureCallback(
+		MemoryBudget& memoryBudget, MemoryPressureCallback&& callback
+	);
+
+	// refreshes the heap budgets and category totals and runs the callbacks
+	// every frame a heap is under pressure. call once per frame
+	void updateMemoryBudget(
+		const VulkanContext& ctx,
+		MemoryBudget& memoryBudget,
+		const uint64_t frameNumber
+	);
+
+	// freed by deletionQueue, after every allocation it tracks
+	AllocationTracker* createAllocationTracker(DeletionQueue& deletionQueue);
+
+	// account the allocation to category until it is untracked, done by
+	// createBuffer and createImage. thread safe
+	void trackAllocation(
+		const VulkanContext& ctx,
+		const VmaAllocation allocation,
+		const MemoryCategory category
+	);
+	void untrackAllocation(
+		const VulkanContext& ctx, const VmaAllocation allocation
+	);
+	VkDeviceSize getCategoryUsage(
+		const VulkanContext& ctx, const MemoryCategory category
+	);
+
+	void drawMemoryBudgetWindow(const MemoryBudget& memoryBudget);
+}  // namespace VulkanRenderer
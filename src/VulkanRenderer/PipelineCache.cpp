@@ -0,0 +1,220 @@
+#include "RendererPCH.h"
+
+#include "PipelineCache.h"
+
+#include "Cleanup.h"
+#include "Context.h"
+#include "debug/Debug.h"
+#include "utils/FileIO.h"
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace {
+	constexpr uint32_t PIPELINE_CACHE_MAGIC{ 0x43504143 };  // "CAPC"
+	constexpr uint32_t PIPELINE_CACHE_FILE_VERSION{ 1 };
+
+	// written in front of the driver's data. drivers reject foreign data
+	// themselves, but not always gracefully, so nothing from another device
+	// or driver version reaches them
+	struct PipelineCacheFileHeader {
+		uint32_t magic;
+		uint32_t fileVersion;
+
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		// keeps the header free of padding so it can be compared bytewise
+		uint32_t reserved;
+
+		uint64_t dataSize;
+	};
+
+	PipelineCacheFileHeader
+		getPipelineCacheFileHeader(const VulkanContext& ctx);
+
+	// returns the driver data, empty when the file is missing or stale
+	std::vector<char> readPipelineCacheFile(
+		const VulkanContext& ctx, const std::filesystem::path& path
+	);
+
+	void writePipelineCacheFile(
+		const VulkanContext& ctx,
+		const std::filesystem::path& path,
+		const std::vector<char>& data
+	);
+
+	std::vector<char> getPipelineCacheData(
+		const VulkanContext& ctx, const VkPipelineCache cache
+	);
+}  // namespace
+
+VulkanRenderer::PipelineCache VulkanRenderer::createPipelineCache(
+	const VulkanContext& ctx,
+	const std::filesystem::path& path,
+	DeletionQueue& deletionQueue
+) {
+	std::vector<char> initialData;
+	if (!path.empty()) {
+		initialData = readPipelineCacheFile(ctx, path);
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo{
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+		.initialDataSize = initialData.size(),
+		.pInitialData = initialData.data(),
+	};
+
+	PipelineCache cache{
+		.path = path,
+		.warm = !initialData.empty(),
+		.savedSize = initialData.size(),
+	};
+	if (vkCreatePipelineCache(
+			ctx.device.logical, &cacheInfo, nullptr, &cache.handle
+		) != VK_SUCCESS) {
+		logWarning("could not create pipeline cache");
+	}
+
+	deletionQueue.pushFunction([=]() {
+		vkDestroyPipelineCache(ctx.device.logical, cache.handle, nullptr);
+	});
+
+	return cache;
+}
+
+void VulkanRenderer::savePipelineCache(
+	const VulkanContext& ctx, PipelineCache& cache
+) {
+	if (cache.path.empty() || cache.handle == VK_NULL_HANDLE) {
+		return;
+	}
+
+	// the cache only grows, an unchanged size means nothing new was compiled
+	size_t dataSize{};
+	if (vkGetPipelineCacheData(
+			ctx.device.logical, cache.handle, &dataSize, nullptr
+		) != VK_SUCCESS ||
+		dataSize <= cache.savedSize) {
+		return;
+	}
+
+	std::vector<char> data{ getPipelineCacheData(ctx, cache.handle) };
+	if (data.empty()) {
+		return;
+	}
+
+	writePipelineCacheFile(ctx, cache.path, data);
+	cache.savedSize = data.size();
+}
+
+namespace {
+	PipelineCacheFileHeader
+		getPipelineCacheFileHeader(const VulkanContext& ctx) {
+		const VkPhysicalDeviceProperties& properties{ ctx.device.properties };
+
+		PipelineCacheFileHeader header{
+			.magic = PIPELINE_CACHE_MAGIC,
+			.fileVersion = PIPELINE_CACHE_FILE_VERSION,
+			.vendorID = properties.vendorID,
+			.deviceID = properties.deviceID,
+			.driverVersion = properties.driverVersion,
+		};
+		std::memcpy(
+			header.pipelineCacheUUID,
+			properties.pipelineCacheUUID,
+			VK_UUID_SIZE
+		);
+
+		return header;
+	}
+
+	std::vector<char> readPipelineCacheFile(
+		const VulkanContext& ctx, const std::filesystem::path& path
+	) {
+		if (!std::filesystem::exists(path)) {
+			return {};
+		}
+
+		std::vector<char> file{ readFile(path.string()) };
+		if (file.size() < sizeof(PipelineCacheFileHeader)) {
+			logWarning("pipeline cache ", path, " is truncated, ignoring it");
+			return {};
+		}
+
+		PipelineCacheFileHeader header{};
+		std::memcpy(&header, file.data(), sizeof(header));
+
+		PipelineCacheFileHeader expected{ getPipelineCacheFileHeader(ctx) };
+		expected.dataSize = header.dataSize;
+
+		if (std::memcmp(&header, &expected, sizeof(header)) != 0) {
+			logInfo(
+				"pipeline cache ", path, " is from another device or driver"
+			);
+			return {};
+		}
+		if (header.dataSize != file.size() - sizeof(header)) {
+			logWarning("pipeline cache ", path, " is truncated, ignoring it");
+			return {};
+		}
+
+		return { file.begin() + sizeof(header), file.end() };
+	}
+
+	void writePipelineCacheFile(
+		const VulkanContext& ctx,
+		const std::filesystem::path& path,
+		const std::vector<char>& data
+	) {
+		PipelineCacheFileHeader header{ getPipelineCacheFileHeader(ctx) };
+		header.dataSize = data.size();
+
+		// a crash mid write leaves the old file intact
+		std::filesystem::path tempPath{ path };
+		tempPath += ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+			if (!file) {
+				logWarning("could not write pipeline cache ", tempPath);
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(data.data(), data.size());
+			if (!file) {
+				logWarning("could not write pipeline cache ", tempPath);
+				return;
+			}
+		}
+
+		std::error_code error{};
+		std::filesystem::rename(tempPath, path, error);
+		if (error) {
+			logWarning("could not replace pipeline cache ", path);
+		}
+	}
+
+	std::vector<char> getPipelineCacheData(
+		const VulkanContext& ctx, const VkPipelineCache cache
+	) {
+		size_t dataSize{};
+		if (vkGetPipelineCacheData(
+				ctx.device.logical, cache, &dataSize, nullptr
+			) != VK_SUCCESS) {
+			return {};
+		}
+
+		std::vector<char> data(dataSize);
+		if (vkGetPipelineCacheData(
+				ctx.device.logical, cache, &dataSize, data.data()
+			) != VK_SUCCESS) {
+			return {};
+		}
+		data.resize(dataSize);
+
+		return data;
+	}
+}  // namespace
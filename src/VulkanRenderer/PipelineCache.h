@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+
+// forward declerations
+struct VulkanContext;
+class DeletionQueue;
+
+namespace VulkanRenderer {
+	struct PipelineCache {
+		VkPipelineCache handle;
+		std::filesystem::path path;
+
+		// the file matched this device and driver and was loaded
+		bool warm;
+		size_t savedSize;
+	};
+
+	// loads path when it was written by the same device and driver version,
+	// otherwise starts empty. an empty path keeps the cache in memory only
+	PipelineCache createPipelineCache(
+		const VulkanContext& ctx,
+		const std::filesystem::path& path,
+		DeletionQueue& deletionQueue
+	);
+
+	// writes the cache when it grew since it was last saved
+	void savePipelineCache(const VulkanContext& ctx, PipelineCache& cache);
+}  // namespace VulkanRenderer
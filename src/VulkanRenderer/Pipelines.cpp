@@ -6,35 +6,302 @@
 #include "debug/Debug.h"
 #include "Context.h"
 #include "Shader.h"
+#include "vkcore/ObjectRegistry.h"
 
 using namespace vkcore;
 
+namespace {
+	// everything a VkGraphicsPipelineCreateInfo points to, kept alive until
+	// the batch is created
+	struct GraphicsPipelineState {
+		VkVertexInputBindingDescription vertexBinding;
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+		VkPipelineVertexInputStateCreateInfo vertexInput;
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly;
+		VkPipelineViewportStateCreateInfo viewport;
+		VkPipelineRasterizationStateCreateInfo rasterization;
+		VkPipelineMultisampleStateCreateInfo multisample;
+		VkPipelineDepthStencilStateCreateInfo depthStencil;
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+		VkPipelineColorBlendStateCreateInfo colorBlend;
+		VkPipelineDynamicStateCreateInfo dynamicState;
+		VkPipelineRenderingCreateInfo rendering;
+	};
+
+	constexpr std::array<VkDynamicState, 2> GRAPHICS_DYNAMIC_STATES{
+		VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	std::string getGraphicsPipelineKey(
+		ObjectRegistry& registry, const GraphicsPipelineDesc& desc
+	);
+
+	// state has to stay where it is until the pipeline is created
+	VkGraphicsPipelineCreateInfo createGraphicsPipelineInfo(
+		const GraphicsPipelineDesc& desc, GraphicsPipelineState& state
+	);
+}  // namespace
+
 VkPipelineLayout createPipelineLayout(
 	const VulkanContext& ctx,
+	ObjectRegistry& registry,
 	const ShaderLayout& shaderLayout,
 	DeletionQueue& deletionQueue
 ) {
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
-		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-		.setLayoutCount = (uint32_t)shaderLayout.shaderDescriptorLayout.size(),
-		.pSetLayouts = shaderLayout.shaderDescriptorLayout.data(),
-		.pushConstantRangeCount = (uint32_t)shaderLayout.pushConstants.size(),
-		.pPushConstantRanges = shaderLayout.pushConstants.data()
+	VkPipelineLayout pipelineLayout{
+		acquirePipelineLayout(ctx, registry, shaderLayout)
 	};
-
-	VkPipelineLayout pipelineLayout;
-	if (vkCreatePipelineLayout(
-			ctx.device.logical, &pipelineLayoutInfo, nullptr, &pipelineLayout
-		) != VK_SUCCESS) {
-		logWarning("could not create pipeline layout");
+	if (pipelineLayout == VK_NULL_HANDLE) {
 		return {};
 	}
 
-	auto deleter{ [=]() {
-		vkDestroyPipelineLayout(ctx.device.logical, pipelineLayout, nullptr);
+	auto deleter{ [=, &registry]() {
+		releasePipelineLayout(ctx, registry, pipelineLayout);
 	} };
 
 	deletionQueue.pushFunction(deleter);
 
 	return pipelineLayout;
 }
+
+std::vector<VkPipeline> createGraphicsPipelines(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const std::span<const GraphicsPipelineDesc>& descs,
+	const VkPipelineCache pipelineCache,
+	DeletionQueue& deletionQueue
+) {
+	std::vector<std::string> keys;
+	keys.reserve(descs.size());
+	for (const auto& desc : descs) {
+		keys.emplace_back(getGraphicsPipelineKey(registry, desc));
+	}
+
+	auto create{ [&](std::span<const uint32_t> missingDescs) {
+		std::vector<GraphicsPipelineState> states(missingDescs.size());
+		std::vector<VkGraphicsPipelineCreateInfo> pipeInfos;
+		pipeInfos.reserve(missingDescs.size());
+
+		for (uint32_t i{}; i < missingDescs.size(); i++) {
+			pipeInfos.emplace_back(
+				createGraphicsPipelineInfo(descs[missingDescs[i]], states[i])
+			);
+		}
+
+		std::vector<VkPipeline> pipelines(missingDescs.size());
+		VkResult res{ vkCreateGraphicsPipelines(
+			ctx.device.logical,
+			pipelineCache,
+			(uint32_t)pipeInfos.size(),
+			pipeInfos.data(),
+			nullptr,
+			pipelines.data()
+		) };
+		// failed pipelines are null, the rest of the batch is still valid
+		if (res != VK_SUCCESS) {
+			logWarning("could not create graphics pipelines");
+		}
+
+		return pipelines;
+	} };
+
+	std::vector<VkPipeline> pipelines{
+		acquirePipelines(ctx, registry, keys, create)
+	};
+
+	auto deleter{ [=, &registry]() {
+		for (const auto& pipeline : pipelines) {
+			releasePipeline(ctx, registry, pipeline);
+		}
+	} };
+
+	deletionQueue.pushFunction(deleter);
+
+	return pipelines;
+}
+
+namespace {
+	std::string getGraphicsPipelineKey(
+		ObjectRegistry& registry, const GraphicsPipelineDesc& desc
+	) {
+		std::string key;
+
+		for (const auto& stage : desc.stages) {
+			std::string moduleKey{ getShaderModuleKey(registry, stage.module) };
+			appendKey(key, moduleKey.size());
+			key.append(moduleKey);
+
+			appendKey(key, stage.flags);
+			appendKey(key, stage.stage);
+			key.append(stage.pName);
+			key.push_back('\0');
+
+			// stages that differ only in their constants are different
+			// pipelines
+			const VkSpecializationInfo* specialization{
+				stage.pSpecializationInfo
+			};
+			if (specialization == nullptr) {
+				appendKey(key, uint32_t{});
+				continue;
+			}
+
+			appendKey(key, specialization->mapEntryCount);
+			for (uint32_t i{}; i < specialization->mapEntryCount; i++) {
+				appendKey(key, specialization->pMapEntries[i]);
+			}
+			appendKey(key, specialization->dataSize);
+			key.append(
+				(const char*)specialization->pData, specialization->dataSize
+			);
+		}
+
+		std::string layoutKey{ getPipelineLayoutKey(registry, desc.layout) };
+		appendKey(key, layoutKey.size());
+		key.append(layoutKey);
+
+		appendKey(key, desc.vertexInputs.size());
+		for (const auto& input : desc.vertexInputs) {
+			appendKey(key, input);
+		}
+
+		appendKey(key, desc.topology);
+		appendKey(key, desc.polygonMode);
+		appendKey(key, desc.cullMode);
+		appendKey(key, desc.frontFace);
+		appendKey(key, desc.depthTest);
+		appendKey(key, desc.depthWrite);
+		appendKey(key, desc.depthCompareOp);
+		appendKey(key, desc.alphaBlend);
+
+		appendKey(key, desc.colorFormats.size());
+		for (const auto& format : desc.colorFormats) {
+			appendKey(key, format);
+		}
+		appendKey(key, desc.depthFormat);
+
+		return key;
+	}
+
+	VkGraphicsPipelineCreateInfo createGraphicsPipelineInfo(
+		const GraphicsPipelineDesc& desc, GraphicsPipelineState& state
+	) {
+		uint32_t vertexStride{};
+		for (const auto& input : desc.vertexInputs) {
+			state.vertexAttributes.emplace_back(
+				VkVertexInputAttributeDescription{
+					.location = input.location,
+					.binding = 0,
+					.format = input.format,
+					.offset = vertexStride,
+				}
+			);
+			vertexStride += input.size;
+		}
+
+		state.vertexBinding = {
+			.binding = 0,
+			.stride = vertexStride,
+			.inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+		};
+
+		state.vertexInput = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+			.vertexBindingDescriptionCount =
+				state.vertexAttributes.empty() ? 0u : 1u,
+			.pVertexBindingDescriptions = &state.vertexBinding,
+			.vertexAttributeDescriptionCount =
+				(uint32_t)state.vertexAttributes.size(),
+			.pVertexAttributeDescriptions = state.vertexAttributes.data(),
+		};
+
+		state.inputAssembly = {
+			.sType =
+				VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+			.topology = desc.topology,
+		};
+
+		state.viewport = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+			.viewportCount = 1,
+			.scissorCount = 1,
+		};
+
+		state.rasterization = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+			.polygonMode = desc.polygonMode,
+			.cullMode = desc.cullMode,
+			.frontFace = desc.frontFace,
+			.lineWidth = 1.f,
+		};
+
+		state.multisample = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+			.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+			.minSampleShading = 1.f,
+		};
+
+		state.depthStencil = {
+			.sType =
+				VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+			.depthTestEnable = desc.depthTest,
+			.depthWriteEnable = desc.depthWrite,
+			.depthCompareOp = desc.depthCompareOp,
+			.minDepthBounds = 0.f,
+			.maxDepthBounds = 1.f,
+		};
+
+		VkPipelineColorBlendAttachmentState blendAttachment{
+			.blendEnable = desc.alphaBlend,
+			.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+			.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+			.colorBlendOp = VK_BLEND_OP_ADD,
+			.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+			.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+			.alphaBlendOp = VK_BLEND_OP_ADD,
+			.colorWriteMask =
+				VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+				VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+		};
+		state.blendAttachments.assign(
+			desc.colorFormats.size(), blendAttachment
+		);
+
+		state.colorBlend = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+			.attachmentCount = (uint32_t)state.blendAttachments.size(),
+			.pAttachments = state.blendAttachments.data(),
+		};
+
+		state.dynamicState = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+			.dynamicStateCount = (uint32_t)GRAPHICS_DYNAMIC_STATES.size(),
+			.pDynamicStates = GRAPHICS_DYNAMIC_STATES.data(),
+		};
+
+		state.rendering = {
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
+			.colorAttachmentCount = (uint32_t)desc.colorFormats.size(),
+			.pColorAttachmentFormats = desc.colorFormats.data(),
+			.depthAttachmentFormat = desc.depthFormat,
+		};
+
+		VkGraphicsPipelineCreateInfo pipeInfo{
+			.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+			.pNext = &state.rendering,
+			.stageCount = (uint32_t)desc.stages.size(),
+			.pStages = desc.stages.data(),
+			.pVertexInputState = &state.vertexInput,
+			.pInputAssemblyState = &state.inputAssembly,
+			.pViewportState = &state.viewport,
+			.pRasterizationState = &state.rasterization,
+			.pMultisampleState = &state.multisample,
+			.pDepthStencilState = &state.depthStencil,
+			.pColorBlendState = &state.colorBlend,
+			.pDynamicState = &state.dynamicState,
+			.layout = desc.layout,
+		};
+
+		return pipeInfo;
+	}
+}  // namespace
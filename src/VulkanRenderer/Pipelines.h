@@ -7,17 +7,58 @@
 #include <vulkan/vulkan.h>
 
 #include "Cleanup.h"
+#include "Shader.h"
 
 // forward declerations
 namespace vkcore {
 	struct ShaderLayout;
+	struct ObjectRegistry;
 }
 
 struct VulkanContext;
 class DeletionQueue;
 
+// shared through registry, deletionQueue releases it
 VkPipelineLayout createPipelineLayout(
 	const VulkanContext& ctx,
+	vkcore::ObjectRegistry& registry,
 	const vkcore::ShaderLayout& shaderLayout,
 	DeletionQueue& deletionQueue
 );
+
+// everything past the layout defaults to opaque, unculled triangles drawn
+// with dynamic rendering. viewport and scissor are dynamic state
+struct GraphicsPipelineDesc {
+	std::vector<VkPipelineShaderStageCreateInfo> stages;
+	VkPipelineLayout layout;
+
+	// from the vertex shader's reflection, interleaved in location order in
+	// the vertex buffer at binding 0
+	std::vector<vkcore::VertexInputInfo> vertexInputs;
+
+	VkPrimitiveTopology topology{ VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST };
+	VkPolygonMode polygonMode{ VK_POLYGON_MODE_FILL };
+	VkCullModeFlags cullMode{ VK_CULL_MODE_NONE };
+	VkFrontFace frontFace{ VK_FRONT_FACE_COUNTER_CLOCKWISE };
+
+	bool depthTest{};
+	bool depthWrite{};
+	VkCompareOp depthCompareOp{ VK_COMPARE_OP_LESS_OR_EQUAL };
+
+	// source alpha over the destination on every color attachment
+	bool alphaBlend{};
+
+	std::vector<VkFormat> colorFormats;
+	VkFormat depthFormat{ VK_FORMAT_UNDEFINED };
+};
+
+// pipelines the registry doesn't have yet are created by a single
+// vkCreateGraphicsPipelines call, so the driver can compile them in
+// parallel. the result is in the order of descs, deletionQueue releases them
+std::vector<VkPipeline> createGraphicsPipelines(
+	const VulkanContext& ctx,
+	vkcore::ObjectRegistry& registry,
+	const std::span<const GraphicsPipelineDesc>& descs,
+	const VkPipelineCache pipelineCache,
+	DeletionQueue& deletionQueue
+);
@@ -0,0 +1,1065 @@
+#include "RendererPCH.h"
+#include "RenderGraph.h"
+
+#include "Context.h"
+#include "DefaultCreateInfos.h"
+#include "GpuProfiler.h"
+#include "debug/Debug.h"
+#include "utils/CpuProfiler.h"
+#include "utils/ThreadPool.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace VulkanRenderer;
+
+namespace {
+	constexpr uint32_t NO_TRANSIENT_IMAGE{ UINT32_MAX };
+
+	// frames a physical transient image may sit unused before it is freed,
+	// kept well above the number of frames in flight
+	constexpr uint32_t TRANSIENT_IMAGE_MAX_UNUSED_FRAMES{ 16 };
+
+	struct AccessInfo {
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		VkImageLayout layout;
+		VkImageUsageFlags usage;
+
+		bool reads;
+		bool writes;
+	};
+
+	// the queue that last used a physical image. submission indexes this
+	// frame's submissions, -1 means an earlier frame signaled value
+	struct ImageOwner {
+		RenderGraphQueue queue;
+		int submission;
+		uint64_t value;
+	};
+
+	struct CompileState {
+		RenderGraph& graph;
+		const RenderGraphQueues& queues;
+
+		vkutils::ImageStateTracker tracker;
+		std::unordered_map<VkImage, ImageOwner> owners;
+
+		// submissions waited on per queue, resolved to timeline values once
+		// every submission is known
+		std::vector<std::array<int, RENDER_GRAPH_QUEUE_COUNT>> waitSubmissions;
+	};
+
+	AccessInfo getAccessInfo(const ImageAccess access);
+
+	std::vector<bool> findLivePasses(const RenderGraph& graph);
+
+	void assignTransientImages(
+		const VulkanContext& ctx,
+		RenderGraph& graph,
+		RenderGraphTransientPool& transientPool
+	);
+
+	void beginSubmission(CompileState& state, const RenderGraphQueue queue);
+
+	// waits on the image's previous queue and moves queue family ownership
+	// when the contents are kept. returns true when the acquire barrier
+	// already performed the access
+	bool moveImageToQueue(
+		CompileState& state,
+		const Image& image,
+		const RenderGraphQueue queue,
+		const AccessInfo& accessInfo,
+		const bool discardContents,
+		std::vector<VkImageMemoryBarrier2>& acquireBarriers
+	);
+
+	// makes the last submission wait on the last submission of every other
+	// queue
+	void waitForQueueTails(CompileState& state);
+
+	void resolveSubmissions(CompileState& state);
+
+	// the first submission only exists to release imported images, it is
+	// skipped when nothing was released
+	bool isSubmissionEmpty(const RenderGraph& graph, const size_t submission);
+
+	// consecutive passes of one submission recorded into one primary
+	struct RecordChunk {
+		uint32_t submission;
+		uint32_t firstPass;
+		uint32_t passCount;
+		// the submission's release barriers, and the graph's final barriers
+		// for the last submission, go at the end of this chunk
+		bool recordsTail;
+
+		VkCommandBuffer cmdBuffer;
+	};
+
+	// splits every submission into at most threadCount chunks
+	std::vector<RecordChunk>
+		splitIntoChunks(const RenderGraph& graph, const uint32_t threadCount);
+}  // namespace
+
+RenderGraphImage VulkanRenderer::importImage(
+	RenderGraph& graph,
+	const std::string& name,
+	const Image& image,
+	const ImageState& initialState
+) {
+	RenderGraphResource resource{
+		.name = name,
+		.imported = true,
+		.finalAccess = ImageAccess::undefined,
+		.image = image,
+		.initialState = initialState,
+		.desc = { .extent = image.extent, .format = image.format },
+		.transientIndex = NO_TRANSIENT_IMAGE,
+		.firstPass = -1,
+		.lastPass = -1,
+	};
+
+	graph.images.emplace_back(std::move(resource));
+
+	return (RenderGraphImage)(graph.images.size() - 1);
+}
+
+RenderGraphImage VulkanRenderer::createTransientImage(
+	RenderGraph& graph,
+	const std::string& name,
+	const RenderGraphImageDesc& desc
+) {
+	RenderGraphResource resource{
+		.name = name,
+		.imported = false,
+		.finalAccess = ImageAccess::undefined,
+		.desc = desc,
+		.transientIndex = NO_TRANSIENT_IMAGE,
+		.firstPass = -1,
+		.lastPass = -1,
+	};
+
+	graph.images.emplace_back(std::move(resource));
+
+	return (RenderGraphImage)(graph.images.size() - 1);
+}
+
+void VulkanRenderer::exportImage(
+	RenderGraph& graph,
+	const RenderGraphImage image,
+	const ImageAccess finalAccess
+) {
+	assertFatal(image < graph.images.size(), "invalid render graph image");
+
+	RenderGraphResource& resource{ graph.images[image] };
+	assertWarning(
+		resource.imported || finalAccess == ImageAccess::undefined,
+		"transient image ",
+		resource.name,
+		" is exported with a final access, it is reused next frame"
+	);
+
+	resource.exported = true;
+	resource.finalAccess = finalAccess;
+}
+
+void VulkanRenderer::addPass(RenderGraph& graph, RenderGraphPass&& pass) {
+	for (size_t i{}; i < pass.images.size(); i++) {
+		assertFatal(
+			pass.images[i].image < graph.images.size(),
+			"pass ",
+			pass.name,
+			" uses an invalid render graph image"
+		);
+
+		// barriers inside a pass are not ordered against each other
+		for (size_t j{ i + 1 }; j < pass.images.size(); j++) {
+			assertWarning(
+				pass.images[i].image != pass.images[j].image,
+				"pass ",
+				pass.name,
+				" uses ",
+				graph.images[pass.images[i].image].name,
+				" more than once"
+			);
+		}
+	}
+
+	graph.passes.emplace_back(std::move(pass));
+}
+
+void VulkanRenderer::compileRenderGraph(
+	const VulkanContext& ctx,
+	RenderGraph& graph,
+	RenderGraphTransientPool& transientPool,
+	const RenderGraphQueues& queues
+) {
+	assertFatal(!graph.compiled, "render graph compiled twice");
+
+	std::vector<bool> livePasses{ findLivePasses(graph) };
+
+	for (uint32_t i{}; i < graph.passes.size(); i++) {
+		if (livePasses[i]) {
+			graph.compiledPasses.emplace_back(
+				RenderGraphCompiledPass{ .passIndex = i }
+			);
+		}
+	}
+
+	// lifetimes and usage are measured in compiled pass order
+	for (int i{}; i < graph.compiledPasses.size(); i++) {
+		const RenderGraphPass& pass{
+			graph.passes[graph.compiledPasses[i].passIndex]
+		};
+
+		for (const auto& use : pass.images) {
+			RenderGraphResource& resource{ graph.images[use.image] };
+			AccessInfo accessInfo{ getAccessInfo(use.access) };
+
+			if (resource.firstPass < 0) {
+				resource.firstPass = i;
+				resource.firstUseStages = accessInfo.stages;
+			}
+			resource.lastPass = i;
+			resource.usage |= accessInfo.usage;
+		}
+	}
+
+	assignTransientImages(ctx, graph, transientPool);
+
+	CompileState state{ .graph = graph, .queues = queues };
+
+	for (const auto& transientImage : transientPool.images) {
+		vkutils::trackImage(
+			state.tracker,
+			transientImage.image.handle,
+			vkutils::getImageAspect(transientImage.image.format),
+			transientImage.sync
+		);
+
+		state.owners[transientImage.image.handle] = ImageOwner{
+			.queue = transientImage.lastQueue,
+			.submission = -1,
+			.value = transientImage.lastValue,
+		};
+	}
+
+	// imported images are released to other queues from here
+	beginSubmission(state, RenderGraphQueue::graphics);
+
+	for (auto& resource : graph.images) {
+		if (!resource.imported) {
+			continue;
+		}
+
+		if (resource.firstPass < 0) {
+			resource.firstUseStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		}
+
+		vkutils::ImageSyncState sync{
+			.writeStages = resource.initialState.stages,
+			.writeAccess = resource.initialState.access,
+			.layout = resource.initialState.layout,
+		};
+
+		// semaphore handoff, chain the first barrier to the semaphore wait
+		if (sync.writeStages == VK_PIPELINE_STAGE_2_NONE) {
+			sync.writeStages = resource.firstUseStages;
+		}
+
+		vkutils::trackImage(
+			state.tracker,
+			resource.image.handle,
+			vkutils::getImageAspect(resource.image.format),
+			sync
+		);
+
+		state.owners[resource.image.handle] = ImageOwner{
+			.queue = RenderGraphQueue::graphics,
+			.submission = 0,
+		};
+	}
+
+	// without a separate compute queue everything runs on graphics
+	const bool asyncCompute{
+		queues[(size_t)RenderGraphQueue::compute].queue !=
+		queues[(size_t)RenderGraphQueue::graphics].queue
+	};
+
+	for (uint32_t i{}; i < graph.compiledPasses.size(); i++) {
+		RenderGraphCompiledPass& compiledPass{ graph.compiledPasses[i] };
+		const RenderGraphPass& pass{ graph.passes[compiledPass.passIndex] };
+
+		RenderGraphQueue queue{ asyncCompute ? pass.queue
+											 : RenderGraphQueue::graphics };
+		if (graph.submissions.back().queue != queue) {
+			beginSubmission(state, queue);
+		}
+		graph.submissions.back().compiledPasses.emplace_back(i);
+
+		std::vector<VkImageMemoryBarrier2> acquireBarriers;
+		for (const auto& use : pass.images) {
+			const RenderGraphResource& resource{ graph.images[use.image] };
+			AccessInfo accessInfo{ getAccessInfo(use.access) };
+
+			// transient contents never survive into a new lifetime
+			bool discardContents{ !resource.imported &&
+								  resource.firstPass == (int)i };
+
+			if (moveImageToQueue(
+					state,
+					resource.image,
+					queue,
+					accessInfo,
+					discardContents,
+					acquireBarriers
+				)) {
+				continue;
+			}
+
+			vkutils::requestImageAccess(
+				state.tracker,
+				resource.image.handle,
+				accessInfo.stages,
+				accessInfo.access,
+				accessInfo.layout,
+				discardContents
+			);
+		}
+
+		compiledPass.barriers = vkutils::takePendingBarriers(state.tracker);
+		compiledPass.barriers.insert(
+			compiledPass.barriers.end(),
+			acquireBarriers.begin(),
+			acquireBarriers.end()
+		);
+	}
+
+	// imported images go back to graphics, where the final barriers and the
+	// frame's semaphores live
+	if (graph.submissions.back().queue != RenderGraphQueue::graphics) {
+		beginSubmission(state, RenderGraphQueue::graphics);
+	}
+
+	std::vector<VkImageMemoryBarrier2> acquireBarriers;
+	for (const auto& resource : graph.images) {
+		bool hasFinalAccess{ resource.exported &&
+							 resource.finalAccess != ImageAccess::undefined };
+		if (!resource.imported &&
+			(!hasFinalAccess || resource.firstPass < 0)) {
+			continue;
+		}
+
+		AccessInfo accessInfo{};
+		if (hasFinalAccess) {
+			accessInfo = getAccessInfo(resource.finalAccess);
+		} else {
+			accessInfo.layout =
+				vkutils::getImageState(state.tracker, resource.image.handle)
+					.layout;
+		}
+
+		if (resource.imported &&
+			moveImageToQueue(
+				state,
+				resource.image,
+				RenderGraphQueue::graphics,
+				accessInfo,
+				false,
+				acquireBarriers
+			)) {
+			continue;
+		}
+
+		if (hasFinalAccess) {
+			vkutils::requestImageAccess(
+				state.tracker,
+				resource.image.handle,
+				accessInfo.stages,
+				accessInfo.access,
+				accessInfo.layout
+			);
+		}
+	}
+	graph.finalBarriers = vkutils::takePendingBarriers(state.tracker);
+	graph.finalBarriers.insert(
+		graph.finalBarriers.end(), acquireBarriers.begin(), acquireBarriers.end()
+	);
+
+	waitForQueueTails(state);
+	resolveSubmissions(state);
+
+	// physical transient images carry their state into the next frame
+	for (auto& transientImage : transientPool.images) {
+		VkImage handle{ transientImage.image.handle };
+		transientImage.sync = vkutils::getImageState(state.tracker, handle);
+
+		const ImageOwner& owner{ state.owners.at(handle) };
+		if (owner.submission >= 0) {
+			transientImage.lastQueue = owner.queue;
+			transientImage.lastValue =
+				graph.submissions[owner.submission].signalValue;
+		}
+	}
+
+	graph.compiled = true;
+}
+
+void VulkanRenderer::submitRenderGraph(
+	const VulkanContext& ctx,
+	const RenderGraph& graph,
+	RenderGraphQueues& queues,
+	RenderGraphCommandPools& cmdPools,
+	const RenderGraphSubmitInfo& submitInfo
+) {
+	assertFatal(graph.compiled, "render graph submitted before compiling");
+
+	const uint32_t threadCount{
+		submitInfo.threadPool ? submitInfo.threadPool->getThreadCount() : 1
+	};
+	assertFatal(
+		cmdPools.size() >= threadCount, "every thread needs its own pools"
+	);
+
+	std::vector<RecordChunk> chunks{ splitIntoChunks(graph, threadCount) };
+
+	// zones are reserved here, the recording threads only write timestamps
+	std::vector<uint32_t> passZones(graph.compiledPasses.size(), GPU_ZONE_NONE);
+	if (submitInfo.profiler) {
+		for (const auto& chunk : chunks) {
+			const RenderGraphSubmission& submission{
+				graph.submissions[chunk.submission]
+			};
+
+			for (uint32_t i{}; i < chunk.passCount; i++) {
+				const uint32_t compiledPassIndex{
+					submission.compiledPasses[chunk.firstPass + i]
+				};
+				const uint32_t passIndex{
+					graph.compiledPasses[compiledPassIndex].passIndex
+				};
+				const RenderGraphPass& pass{ graph.passes[passIndex] };
+
+				passZones[compiledPassIndex] = reserveGpuZone(
+					*submitInfo.profiler, (uint32_t)submission.queue, pass.name
+				);
+			}
+		}
+	}
+
+	auto recordChunk{ [&](uint32_t chunkIndex, uint32_t threadIndex) {
+		CPU_ZONE("record render graph chunk");
+
+		RecordChunk& chunk{ chunks[chunkIndex] };
+		const RenderGraphSubmission& submission{
+			graph.submissions[chunk.submission]
+		};
+
+		const VkCommandBuffer cmdBuffer{ vkutils::getCommandBuffer(
+			ctx, cmdPools[threadIndex][(size_t)submission.queue]
+		) };
+		chunk.cmdBuffer = cmdBuffer;
+
+		VkCommandBufferBeginInfo cmdBeginInfo{
+			vkdefaults::commandBufferBeginInfo(
+				VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+			)
+		};
+		vkBeginCommandBuffer(cmdBuffer, &cmdBeginInfo);
+
+		for (uint32_t i{}; i < chunk.passCount; i++) {
+			const uint32_t compiledPassIndex{
+				submission.compiledPasses[chunk.firstPass + i]
+			};
+			const RenderGraphCompiledPass& compiledPass{
+				graph.compiledPasses[compiledPassIndex]
+			};
+			const RenderGraphPass& pass{ graph.passes[compiledPass.passIndex] };
+
+			// barriers count towards the pass that needed them
+			const uint32_t zone{ passZones[compiledPassIndex] };
+			if (submitInfo.profiler) {
+				cmdWriteGpuZoneBegin(*submitInfo.profiler, cmdBuffer, zone);
+			}
+
+			vkutils::cmdPipelineBarriers(cmdBuffer, compiledPass.barriers);
+			if (pass.record) {
+				pass.record(cmdBuffer, graph);
+			}
+
+			if (submitInfo.profiler) {
+				cmdEndGpuZone(*submitInfo.profiler, cmdBuffer, zone);
+			}
+		}
+
+		if (chunk.recordsTail) {
+			if (chunk.submission == graph.submissions.size() - 1) {
+				vkutils::cmdPipelineBarriers(cmdBuffer, graph.finalBarriers);
+			}
+			vkutils::cmdPipelineBarriers(cmdBuffer, submission.releaseBarriers);
+		}
+
+		vkEndCommandBuffer(cmdBuffer);
+	} };
+
+	if (submitInfo.threadPool) {
+		submitInfo.threadPool->parallelFor(
+			(uint32_t)chunks.size(), recordChunk
+		);
+	} else {
+		for (uint32_t i{}; i < chunks.size(); i++) {
+			recordChunk(i, 0);
+		}
+	}
+
+	// chunks are ordered by submission, a submission's chunks run in order
+	// as several command buffers of one submit
+	bool binaryWaitsSubmitted{};
+	size_t chunkIndex{};
+	for (size_t i{}; i < graph.submissions.size(); i++) {
+		const RenderGraphSubmission& submission{ graph.submissions[i] };
+		const size_t queueIndex{ (size_t)submission.queue };
+		const bool lastSubmission{ i == graph.submissions.size() - 1 };
+
+		std::vector<VkCommandBufferSubmitInfo> cmdBufferInfos;
+		while (chunkIndex < chunks.size() &&
+			   chunks[chunkIndex].submission == i) {
+			cmdBufferInfos.emplace_back(
+				vkdefaults::cmdBufferSubmitInfo(chunks[chunkIndex].cmdBuffer)
+			);
+			chunkIndex++;
+		}
+
+		if (cmdBufferInfos.empty()) {
+			continue;
+		}
+
+		vkutils::TimelineQueue& queue{ queues[queueIndex] };
+
+		std::vector<VkSemaphoreSubmitInfo> semWaitInfos;
+		for (size_t j{}; j < RENDER_GRAPH_QUEUE_COUNT; j++) {
+			if (submission.waitValues[j] == 0) {
+				continue;
+			}
+
+			semWaitInfos.emplace_back(vkdefaults::semSubmitInfo(
+				queues[j].timeline,
+				submission.waitStages[j],
+				submission.waitValues[j]
+			));
+		}
+
+		if (submission.queue == RenderGraphQueue::graphics &&
+			!binaryWaitsSubmitted) {
+			semWaitInfos.insert(
+				semWaitInfos.end(),
+				submitInfo.waitSemaphores.begin(),
+				submitInfo.waitSemaphores.end()
+			);
+			binaryWaitsSubmitted = true;
+		}
+
+		std::vector<VkSemaphoreSubmitInfo> semSignalInfos{
+			vkdefaults::semSubmitInfo(
+				queue.timeline,
+				VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+				submission.signalValue
+			)
+		};
+		if (lastSubmission) {
+			semSignalInfos.insert(
+				semSignalInfos.end(),
+				submitInfo.signalSemaphores.begin(),
+				submitInfo.signalSemaphores.end()
+			);
+		}
+
+		VkSubmitInfo2 vkSubmitInfo{ vkdefaults::submitInfo(
+			cmdBufferInfos, semWaitInfos, semSignalInfos
+		) };
+
+		if (vkQueueSubmit2(queue.queue, 1, &vkSubmitInfo, VK_NULL_HANDLE) !=
+			VK_SUCCESS) {
+			logWarning("render graph queue submit failed");
+		}
+
+		queue.value = submission.signalValue;
+	}
+}
+
+const Image& VulkanRenderer::getImage(
+	const RenderGraph& graph, const RenderGraphImage image
+) {
+	return graph.images[image].image;
+}
+
+VkPipelineStageFlags2 VulkanRenderer::getFirstUseStages(
+	const RenderGraph& graph, const RenderGraphImage image
+) {
+	assertFatal(graph.compiled, "first use is only known after compiling");
+
+	return graph.images[image].firstUseStages;
+}
+
+void VulkanRenderer::destroyTransientPool(
+	const VulkanContext& ctx, RenderGraphTransientPool& transientPool
+) {
+	for (const auto& transientImage : transientPool.images) {
+		destroyImage(ctx, transientImage.image);
+	}
+	transientPool.images.clear();
+}
+
+namespace {
+	AccessInfo getAccessInfo(const ImageAccess access) {
+		switch (access) {
+			case ImageAccess::computeStorageRead:
+				return { .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						 .access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+						 .layout = VK_IMAGE_LAYOUT_GENERAL,
+						 .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+						 .reads = true };
+			case ImageAccess::computeStorageWrite:
+				return { .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						 .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+						 .layout = VK_IMAGE_LAYOUT_GENERAL,
+						 .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+						 .writes = true };
+			case ImageAccess::computeStorageReadWrite:
+				return { .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						 .access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+							 VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+						 .layout = VK_IMAGE_LAYOUT_GENERAL,
+						 .usage = VK_IMAGE_USAGE_STORAGE_BIT,
+						 .reads = true,
+						 .writes = true };
+			case ImageAccess::computeSampled:
+				return { .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						 .access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+						 .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						 .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+						 .reads = true };
+			case ImageAccess::fragmentSampled:
+				return { .stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+						 .access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+						 .layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+						 .usage = VK_IMAGE_USAGE_SAMPLED_BIT,
+						 .reads = true };
+			case ImageAccess::transferSrc:
+				return { .stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+						 .access = VK_ACCESS_2_TRANSFER_READ_BIT,
+						 .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+						 .usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+						 .reads = true };
+			case ImageAccess::transferDst:
+				return { .stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+						 .access = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+						 .layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+						 .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+						 .writes = true };
+			case ImageAccess::colorAttachmentWrite:
+				return {
+					.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+					.access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+					.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+					.writes = true
+				};
+			case ImageAccess::colorAttachmentReadWrite:
+				return {
+					.stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+					.access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+						VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+					.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+					.reads = true,
+					.writes = true
+				};
+			case ImageAccess::depthAttachmentWrite:
+				return {
+					.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+						VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+					.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+					.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+					.writes = true
+				};
+			case ImageAccess::depthAttachmentReadWrite:
+				return {
+					.stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+						VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+					.access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+						VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+					.layout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL,
+					.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+					.reads = true,
+					.writes = true
+				};
+			case ImageAccess::present:
+				// the present semaphore signal covers the transition
+				return { .stages = VK_PIPELINE_STAGE_2_NONE,
+						 .access = VK_ACCESS_2_NONE,
+						 .layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR };
+			case ImageAccess::undefined:
+			default:
+				return { .stages = VK_PIPELINE_STAGE_2_NONE,
+						 .access = VK_ACCESS_2_NONE,
+						 .layout = VK_IMAGE_LAYOUT_UNDEFINED };
+		}
+	}
+
+	std::vector<bool> findLivePasses(const RenderGraph& graph) {
+		std::vector<bool> livePasses(graph.passes.size());
+
+		// walked backwards from the exported images. writes are not assumed
+		// to cover the whole image, so every earlier writer of a needed
+		// image stays alive
+		std::vector<bool> neededImages(graph.images.size());
+		for (size_t i{}; i < graph.images.size(); i++) {
+			neededImages[i] = graph.images[i].exported;
+		}
+
+		for (size_t i{ graph.passes.size() }; i-- > 0;) {
+			const RenderGraphPass& pass{ graph.passes[i] };
+
+			bool live{ pass.sideEffects };
+			for (const auto& use : pass.images) {
+				if (getAccessInfo(use.access).writes &&
+					neededImages[use.image]) {
+					live = true;
+				}
+			}
+
+			if (!live) {
+				continue;
+			}
+			livePasses[i] = true;
+
+			for (const auto& use : pass.images) {
+				if (getAccessInfo(use.access).reads) {
+					neededImages[use.image] = true;
+				}
+			}
+		}
+
+		return livePasses;
+	}
+
+	void assignTransientImages(
+		const VulkanContext& ctx,
+		RenderGraph& graph,
+		RenderGraphTransientPool& transientPool
+	) {
+		std::vector<RenderGraphTransientImage>& pool{ transientPool.images };
+
+		// no frame in flight can still be using images this stale
+		for (size_t i{ pool.size() }; i-- > 0;) {
+			if (pool[i].unusedFrames >= TRANSIENT_IMAGE_MAX_UNUSED_FRAMES) {
+				VulkanRenderer::destroyImage(ctx, pool[i].image);
+				pool.erase(pool.begin() + i);
+			}
+		}
+
+		std::vector<RenderGraphImage> transientImages;
+		for (uint32_t i{}; i < graph.images.size(); i++) {
+			const RenderGraphResource& resource{ graph.images[i] };
+			if (!resource.imported && resource.firstPass >= 0) {
+				transientImages.emplace_back(i);
+			}
+		}
+
+		std::sort(
+			transientImages.begin(),
+			transientImages.end(),
+			[&](RenderGraphImage a, RenderGraphImage b) {
+				return graph.images[a].firstPass < graph.images[b].firstPass;
+			}
+		);
+
+		// last compiled pass that uses each physical image this frame
+		std::vector<int> busyUntil(pool.size(), -1);
+
+		for (auto imageIndex : transientImages) {
+			RenderGraphResource& resource{ graph.images[imageIndex] };
+
+			uint32_t slot{ NO_TRANSIENT_IMAGE };
+			for (uint32_t i{}; i < pool.size(); i++) {
+				const RenderGraphTransientImage& candidate{ pool[i] };
+
+				bool compatible{
+					candidate.desc.format == resource.desc.format &&
+					candidate.desc.extent.width == resource.desc.extent.width &&
+					candidate.desc.extent.height ==
+						resource.desc.extent.height &&
+					candidate.desc.extent.depth == resource.desc.extent.depth &&
+					(candidate.usage & resource.usage) == resource.usage
+				};
+
+				if (compatible && busyUntil[i] < resource.firstPass) {
+					slot = i;
+					break;
+				}
+			}
+
+			if (slot == NO_TRANSIENT_IMAGE) {
+				RenderGraphTransientImage transientImage{
+					.desc = resource.desc,
+					.usage = resource.usage,
+					.image = VulkanRenderer::createImage(
+						ctx,
+						resource.desc.extent,
+						resource.desc.format,
+						resource.usage,
+						VulkanRenderer::MemoryCategory::renderTargets
+					),
+				};
+
+				pool.emplace_back(transientImage);
+				busyUntil.emplace_back(-1);
+				slot = (uint32_t)(pool.size() - 1);
+			}
+
+			busyUntil[slot] = resource.lastPass;
+			resource.transientIndex = slot;
+			resource.image = pool[slot].image;
+		}
+
+		for (size_t i{}; i < pool.size(); i++) {
+			pool[i].unusedFrames = busyUntil[i] < 0 ? pool[i].unusedFrames + 1
+													: 0;
+		}
+	}
+
+	void beginSubmission(CompileState& state, const RenderGraphQueue queue) {
+		state.graph.submissions.emplace_back(
+			RenderGraphSubmission{ .queue = queue }
+		);
+
+		std::array<int, RENDER_GRAPH_QUEUE_COUNT> waitSubmissions;
+		waitSubmissions.fill(-1);
+		state.waitSubmissions.emplace_back(waitSubmissions);
+	}
+
+	bool moveImageToQueue(
+		CompileState& state,
+		const Image& image,
+		const RenderGraphQueue queue,
+		const AccessInfo& accessInfo,
+		const bool discardContents,
+		std::vector<VkImageMemoryBarrier2>& acquireBarriers
+	) {
+		RenderGraph& graph{ state.graph };
+		const int currentSubmission{ (int)graph.submissions.size() - 1 };
+
+		ImageOwner& owner{ state.owners.at(image.handle) };
+		const ImageOwner previousOwner{ owner };
+		owner = ImageOwner{ .queue = queue, .submission = currentSubmission };
+
+		if (previousOwner.queue == queue) {
+			return false;
+		}
+
+		// the semaphore wait orders every earlier access on the other queue
+		RenderGraphSubmission& submission{ graph.submissions[currentSubmission] };
+		const size_t ownerQueue{ (size_t)previousOwner.queue };
+
+		VkPipelineStageFlags2 stages{ accessInfo.stages
+										  ? accessInfo.stages
+										  : VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT };
+		submission.waitStages[ownerQueue] |= stages;
+
+		if (previousOwner.submission >= 0) {
+			int& waitSubmission{
+				state.waitSubmissions[currentSubmission][ownerQueue]
+			};
+			waitSubmission = std::max(waitSubmission, previousOwner.submission);
+		} else {
+			submission.waitValues[ownerQueue] = std::max(
+				submission.waitValues[ownerQueue], previousOwner.value
+			);
+		}
+
+		const vkutils::ImageSyncState sync{
+			vkutils::getImageState(state.tracker, image.handle)
+		};
+		const VkImageAspectFlags aspect{ vkutils::getImageAspect(image.format
+		) };
+
+		const uint32_t srcFamily{ state.queues[ownerQueue].familyIndex };
+		const uint32_t dstFamily{ state.queues[(size_t)queue].familyIndex };
+
+		bool keepContents{ !discardContents &&
+						   sync.layout != VK_IMAGE_LAYOUT_UNDEFINED };
+		if (!keepContents || srcFamily == dstFamily) {
+			vkutils::trackImage(
+				state.tracker,
+				image.handle,
+				aspect,
+				{ .writeStages = stages, .layout = sync.layout }
+			);
+			return false;
+		}
+
+		assertFatal(
+			previousOwner.submission >= 0,
+			"image ownership can only be released inside the graph"
+		);
+
+		// release and acquire must describe the same layout transition
+		VkImageMemoryBarrier2 releaseBarrier{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcStageMask = sync.writeStages | sync.readStages,
+			.srcAccessMask = sync.writeAccess,
+			.dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+			.dstAccessMask = VK_ACCESS_2_NONE,
+			.oldLayout = sync.layout,
+			.newLayout = accessInfo.layout,
+			.srcQueueFamilyIndex = srcFamily,
+			.dstQueueFamilyIndex = dstFamily,
+			.image = image.handle,
+			.subresourceRange = vkdefaults::subresourceRange(aspect),
+		};
+		graph.submissions[previousOwner.submission].releaseBarriers.emplace_back(
+			releaseBarrier
+		);
+
+		VkImageMemoryBarrier2 acquireBarrier{ releaseBarrier };
+		acquireBarrier.srcStageMask = stages;
+		acquireBarrier.srcAccessMask = VK_ACCESS_2_NONE;
+		acquireBarrier.dstStageMask = stages;
+		acquireBarrier.dstAccessMask = accessInfo.access;
+		acquireBarriers.emplace_back(acquireBarrier);
+
+		VkAccessFlags2 writeAccess{ vkutils::getWriteAccess(accessInfo.access) };
+		vkutils::trackImage(
+			state.tracker,
+			image.handle,
+			aspect,
+			{ .writeStages = stages,
+			  .writeAccess = writeAccess,
+			  .readStages = writeAccess ? VK_PIPELINE_STAGE_2_NONE : stages,
+			  .readAccess = writeAccess ? VK_ACCESS_2_NONE : accessInfo.access,
+			  .layout = accessInfo.layout }
+		);
+
+		return true;
+	}
+
+	void waitForQueueTails(CompileState& state) {
+		RenderGraph& graph{ state.graph };
+
+		std::array<int, RENDER_GRAPH_QUEUE_COUNT> queueTails;
+		queueTails.fill(-1);
+		for (int i{}; i < graph.submissions.size(); i++) {
+			if (!isSubmissionEmpty(graph, i)) {
+				queueTails[(size_t)graph.submissions[i].queue] = i;
+			}
+		}
+
+		const int lastSubmission{ (int)graph.submissions.size() - 1 };
+		const size_t lastQueue{ (size_t)graph.submissions.back().queue };
+
+		bool waitsOnTails{ true };
+		for (size_t i{}; i < RENDER_GRAPH_QUEUE_COUNT; i++) {
+			if (i != lastQueue &&
+				state.waitSubmissions[lastSubmission][i] < queueTails[i]) {
+				waitsOnTails = false;
+			}
+		}
+		if (waitsOnTails) {
+			return;
+		}
+
+		// work trailing on another queue gets its own submission so the
+		// graphics passes don't stall on it
+		if (!graph.submissions.back().compiledPasses.empty()) {
+			beginSubmission(state, graph.submissions.back().queue);
+		}
+
+		RenderGraphSubmission& submission{ graph.submissions.back() };
+		for (size_t i{}; i < RENDER_GRAPH_QUEUE_COUNT; i++) {
+			if (i == lastQueue || queueTails[i] < 0) {
+				continue;
+			}
+
+			state.waitSubmissions.back()[i] = queueTails[i];
+			submission.waitStages[i] |= VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+		}
+	}
+
+	void resolveSubmissions(CompileState& state) {
+		RenderGraph& graph{ state.graph };
+
+		std::array<uint64_t, RENDER_GRAPH_QUEUE_COUNT> values;
+		for (size_t i{}; i < RENDER_GRAPH_QUEUE_COUNT; i++) {
+			values[i] = state.queues[i].value;
+		}
+
+		for (size_t i{}; i < graph.submissions.size(); i++) {
+			RenderGraphSubmission& submission{ graph.submissions[i] };
+			uint64_t& queueValue{ values[(size_t)submission.queue] };
+
+			// skipped submissions count as done once earlier work is
+			submission.signalValue =
+				isSubmissionEmpty(graph, i) ? queueValue : ++queueValue;
+
+			for (size_t j{}; j < RENDER_GRAPH_QUEUE_COUNT; j++) {
+				int waitSubmission{ state.waitSubmissions[i][j] };
+				if (waitSubmission < 0) {
+					continue;
+				}
+
+				submission.waitValues[j] = std::max(
+					submission.waitValues[j],
+					graph.submissions[waitSubmission].signalValue
+				);
+			}
+		}
+	}
+
+	bool isSubmissionEmpty(const RenderGraph& graph, const size_t submission) {
+		const RenderGraphSubmission& graphSubmission{
+			graph.submissions[submission]
+		};
+
+		return submission == 0 && graph.submissions.size() > 1 &&
+			graphSubmission.compiledPasses.empty() &&
+			graphSubmission.releaseBarriers.empty();
+	}
+
+	std::vector<RecordChunk>
+		splitIntoChunks(const RenderGraph& graph, const uint32_t threadCount) {
+		std::vector<RecordChunk> chunks;
+		for (size_t i{}; i < graph.submissions.size(); i++) {
+			if (isSubmissionEmpty(graph, i)) {
+				continue;
+			}
+
+			const uint32_t passCount{
+				(uint32_t)graph.submissions[i].compiledPasses.size()
+			};
+			// a submission without passes still records its barriers
+			const uint32_t chunkCount{
+				std::max(std::min(passCount, threadCount), 1u)
+			};
+
+			uint32_t firstPass{};
+			for (uint32_t j{}; j < chunkCount; j++) {
+				// the first passCount % chunkCount chunks take one extra pass
+				const uint32_t chunkPassCount{
+					passCount / chunkCount + (j < passCount % chunkCount)
+				};
+
+				chunks.emplace_back(RecordChunk{
+					.submission = (uint32_t)i,
+					.firstPass = firstPass,
+					.passCount = chunkPassCount,
+					.recordsTail = j == chunkCount - 1,
+				});
+				firstPass += chunkPassCount;
+			}
+		}
+
+		return chunks;
+	}
+}  // namespace
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+#include "vkutils/Barriers.h"
+#include "vkutils/Commands.h"
+#include "vkutils/Synchronization.h"
+
+// forward declerations
+struct VulkanContext;
+class ThreadPool;
+
+namespace VulkanRenderer {
+	struct GpuProfiler;
+}
+
+namespace VulkanRenderer {
+	// index into RenderGraph::images, only valid for the graph it came from
+	using RenderGraphImage = uint32_t;
+
+	// how a pass touches an image. stages, access masks and layouts are
+	// derived from this, passes never write barriers themselves
+	enum class ImageAccess : uint32_t {
+		undefined = 0,
+
+		computeStorageRead,
+		computeStorageWrite,
+		computeStorageReadWrite,
+		computeSampled,
+		fragmentSampled,
+
+		transferSrc,
+		transferDst,
+
+		colorAttachmentWrite,
+		colorAttachmentReadWrite,
+		depthAttachmentWrite,
+		depthAttachmentReadWrite,
+
+		present,
+	};
+
+	// the last use of an image before the graph runs. the first barrier on
+	// the image waits on these stages. images handed over by a semaphore
+	// (swapchain images) are imported with no stages and the semaphore is
+	// waited on at getFirstUseStages()
+	struct ImageState {
+		VkPipelineStageFlags2 stages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2 access{ VK_ACCESS_2_NONE };
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	};
+
+	// compute passes only run asynchronously when the device has a compute
+	// queue separate from the graphics queue
+	enum class RenderGraphQueue : uint32_t {
+		graphics = 0,
+		compute,
+
+		count,
+	};
+	constexpr size_t RENDER_GRAPH_QUEUE_COUNT{
+		(size_t)RenderGraphQueue::count
+	};
+
+	using RenderGraphQueues =
+		std::array<vkutils::TimelineQueue, RENDER_GRAPH_QUEUE_COUNT>;
+	// indexed by recording thread, then by queue. threads never share a pool
+	using RenderGraphCommandPools = std::vector<
+		std::array<vkutils::CommandBufferPool, RENDER_GRAPH_QUEUE_COUNT>>;
+
+	struct RenderGraphImageUse {
+		RenderGraphImage image;
+		ImageAccess access;
+	};
+
+	struct RenderGraph;
+
+	struct RenderGraphPass {
+		std::string name;
+		std::vector<RenderGraphImageUse> images;
+
+		// passes without side effects are culled when nothing reads what
+		// they write
+		bool sideEffects{};
+
+		RenderGraphQueue queue{ RenderGraphQueue::graphics };
+
+		std::function<void(VkCommandBuffer cmdBuffer, const RenderGraph& graph)>
+			record;
+	};
+
+	struct RenderGraphImageDesc {
+		VkExtent3D extent;
+		VkFormat format;
+	};
+
+	// transient images outlive a single graph so their memory is reused
+	// frame to frame. images with disjoint lifetimes inside a frame alias
+	// the same physical image
+	struct RenderGraphTransientImage {
+		RenderGraphImageDesc desc;
+		VkImageUsageFlags usage;
+		Image image;
+		vkutils::ImageSyncState sync;
+
+		// last submission that used the image, the next frame's first use
+		// waits on it when it runs on another queue
+		RenderGraphQueue lastQueue;
+		uint64_t lastValue;
+
+		uint32_t unusedFrames;
+	};
+
+	struct RenderGraphTransientPool {
+		std::vector<RenderGraphTransientImage> images;
+	};
+
+	struct RenderGraphResource {
+		std::string name;
+
+		bool imported;
+		bool exported;
+		ImageAccess finalAccess;
+
+		Image image;
+		ImageState initialState;
+
+		RenderGraphImageDesc desc;
+		VkImageUsageFlags usage;
+
+		// filled in by compileRenderGraph
+		uint32_t transientIndex;
+		int firstPass;
+		int lastPass;
+		VkPipelineStageFlags2 firstUseStages;
+	};
+
+	struct RenderGraphCompiledPass {
+		uint32_t passIndex;
+		std::vector<VkImageMemoryBarrier2> barriers;
+	};
+
+	// consecutive passes on one queue. submissions wait on the timelines of
+	// the other queues only for the images they share
+	struct RenderGraphSubmission {
+		RenderGraphQueue queue;
+		std::vector<uint32_t> compiledPasses;
+
+		// queue family ownership releases, recorded after the passes
+		std::vector<VkImageMemoryBarrier2> releaseBarriers;
+
+		std::array<uint64_t, RENDER_GRAPH_QUEUE_COUNT> waitValues;
+		std::array<VkPipelineStageFlags2, RENDER_GRAPH_QUEUE_COUNT> waitStages;
+		uint64_t signalValue;
+	};
+
+	struct RenderGraph {
+		std::vector<RenderGraphResource> images;
+		std::vector<RenderGraphPass> passes;
+
+		std::vector<RenderGraphCompiledPass> compiledPasses;
+		std::vector<RenderGraphSubmission> submissions;
+		// recorded at the end of the last submission, always on graphics
+		std::vector<VkImageMemoryBarrier2> finalBarriers;
+		bool compiled;
+	};
+
+	// waits are attached to the first graphics submission, signals to the
+	// last one. the last submission finishes after every other submission of
+	// the graph, so a signal there retires the whole frame
+	struct RenderGraphSubmitInfo {
+		std::span<const VkSemaphoreSubmitInfo> waitSemaphores;
+		std::span<const VkSemaphoreSubmitInfo> signalSemaphores;
+
+		// every pass is timed in a zone named after it, queues are indexed by
+		// RenderGraphQueue
+		GpuProfiler* profiler;
+
+		// passes are recorded in parallel on the pool when set. pass record
+		// callbacks then run on worker threads
+		ThreadPool* threadPool;
+	};
+
+	RenderGraphImage importImage(
+		RenderGraph& graph,
+		const std::string& name,
+		const Image& image,
+		const ImageState& initialState
+	);
+
+	RenderGraphImage createTransientImage(
+		RenderGraph& graph,
+		const std::string& name,
+		const RenderGraphImageDesc& desc
+	);
+
+	// exported images are kept alive and, unless finalAccess is undefined,
+	// transitioned to finalAccess after the last pass
+	void exportImage(
+		RenderGraph& graph,
+		const RenderGraphImage image,
+		const ImageAccess finalAccess = ImageAccess::undefined
+	);
+
+	void addPass(RenderGraph& graph, RenderGraphPass&& pass);
+
+	// culls dead passes, assigns transient images, splits the passes into
+	// per queue submissions and derives barriers and ownership transfers.
+	// transient images left unused for a while are freed here. imported
+	// images are owned by the graphics queue before and after the graph
+	void compileRenderGraph(
+		const VulkanContext& ctx,
+		RenderGraph& graph,
+		RenderGraphTransientPool& transientPool,
+		const RenderGraphQueues& queues
+	);
+
+	// records every submission into buffers from cmdPools and submits them.
+	// each submission is split into up to one chunk per thread, recorded
+	// into its own primary. nothing else may be submitted to queues between
+	// compiling and this
+	void submitRenderGraph(
+		const VulkanContext& ctx,
+		const RenderGraph& graph,
+		RenderGraphQueues& queues,
+		RenderGraphCommandPools& cmdPools,
+		const RenderGraphSubmitInfo& submitInfo
+	);
+
+	const Image& getImage(const RenderGraph& graph, const RenderGraphImage image);
+
+	VkPipelineStageFlags2
+		getFirstUseStages(const RenderGraph& graph, const RenderGraphImage image);
+
+	void destroyTransientPool(
+		const VulkanContext& ctx, RenderGraphTransientPool& transientPool
+	);
+}  // namespace VulkanRenderer
@@ -24,16 +24,21 @@
 #include "DefaultCreateInfos.h"
 #include "Device.h"
 #include "Extensions.h"
+#include "GpuProfiler.h"
 #include "ImGuiIntegration.h"
 #include "Image.h"
 #include "Instance.h"
+#include "RenderGraph.h"
+#include "ShaderReloader.h"
 #include "State.h"
 #include "Swapchain.h"
 #include "vkutils/Synchronization.h"
+#include "utils/CpuProfiler.h"
 
 #include <imgui_impl_vulkan.h>
 #include <vma/vk_mem_alloc.h>
 #include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 #include <memory>
 
 namespace {
@@ -43,111 +48,490 @@ namespace {
 		DeletionQueue rendererDeletionQueue;
 		VulkanContext context;
 		VulkanState state;
+		RendererSettings settings;
 		int currentFrameIndex;
 	};
 	VulkanRendererState *s_RendererInfo{};
+
+	// frames between checks for newly compiled pipelines to save
+	constexpr uint64_t PIPELINE_CACHE_SAVE_INTERVAL{ 1000 };
+	constexpr uint32_t TEXTURE_DECODE_THREADS{ 2 };
+	// radians the mesh turns every frame
+	constexpr float MESH_SPIN_PER_FRAME{ 0.01f };
+
+	void startShaderReloader(const VulkanContext &ctx, VulkanState &state);
+	void startTextureStreamer(
+		const VulkanContext &ctx,
+		VulkanState &state,
+		const RendererSettings &settings
+	);
+
+	void cmdDrawGradient(const VulkanState &state, VkCommandBuffer cmdBuffer);
+
+	// only while building the graph, the set and its uniforms live until
+	// the frame retires. null when the frame's upload region is full
+	VkDescriptorSet writeMeshSet(
+		const VulkanContext &ctx,
+		VulkanState &state,
+		PerFrameVulkanState &frame,
+		const uint64_t frameNumber
+	);
+	void cmdDrawMesh(
+		const VulkanState &state,
+		VkCommandBuffer cmdBuffer,
+		const VkDescriptorSet set,
+		const VkImageView target
+	);
+
+	// blits srcExtent from the top left of srcImage onto all of dstImage
+	void cmdBlitImage(
+		VkCommandBuffer cmdBuffer,
+		const Image &srcImage,
+		const VkExtent2D srcExtent,
+		const Image &dstImage
+	);
 }  // namespace
 
-void VulkanRenderer::init(SDL_Window *window) {
+void VulkanRenderer::init(
+	SDL_Window *window, const RendererSettings &settings
+) {
 	assertFatal(s_RendererInfo == nullptr);
+	CPU_ZONE("VulkanRenderer::init");
+
+	assertFatal(
+		window != nullptr || settings.headless,
+		"a window is required unless rendering headless"
+	);
+
+	SDL_Window *surfaceWindow{ settings.headless ? nullptr : window };
 
 	DeletionQueue rendererDeletionQueue;
-	VulkanContext context{ createVulkanContext(window, rendererDeletionQueue) };
-	VulkanState state{
-		createVulkanState(context, window, rendererDeletionQueue)
+	VulkanContext context{
+		createVulkanContext(surfaceWindow, rendererDeletionQueue)
 	};
+	VulkanState state{ createVulkanState(
+		context, surfaceWindow, settings, rendererDeletionQueue
+	) };
 
-	initImGui(context, state, window, rendererDeletionQueue);
+	if (!settings.headless) {
+		initImGui(context, state, window, rendererDeletionQueue);
+	}
 
 	s_RendererInfo =
 		new VulkanRendererState{ .rendererDeletionQueue =
 									 std::move(rendererDeletionQueue),
 								 .context = std::move(context),
-								 .state = std::move(state) };
+								 .state = std::move(state),
+								 .settings = settings };
+
+	// the reloader and streamer hold on to the context and state, both have
+	// their final address now
+	if (settings.shaderHotReload) {
+		startShaderReloader(s_RendererInfo->context, s_RendererInfo->state);
+	}
+	startTextureStreamer(
+		s_RendererInfo->context, s_RendererInfo->state, settings
+	);
 }
 
 void VulkanRenderer::renderFrame(SDL_Window *window) {
 	assertFatal(s_RendererInfo != nullptr);
+	CPU_ZONE("renderFrame");
 
-	updateImGui();
+	const bool headless{ s_RendererInfo->settings.headless };
 
 	const VulkanContext &ctx{ s_RendererInfo->context };
-	const VulkanState &state{ s_RendererInfo->state };
+	VulkanState &state{ s_RendererInfo->state };
 
-	const PerFrameVulkanState &frame{
+	PerFrameVulkanState &frame{
 		state.frames[s_RendererInfo->currentFrameIndex]
 	};
 
-	vkWaitForFences(
-		ctx.device.logical, 1, &frame.fenceRenderFinished, VK_TRUE, UINT64_MAX
+	// this frame's resources were last used framesInFlight frames ago
+	const uint64_t framesInFlight{ state.frames.size() };
+	const uint64_t frameNumber{ state.frameNumber + 1 };
+	if (frameNumber > framesInFlight) {
+		CPU_ZONE("wait for frame");
+
+		const uint64_t retiredFrame{ frameNumber - framesInFlight };
+		vkutils::waitForTimeline(ctx, state.frameTimeline, retiredFrame);
+	}
+	state.frameDeletionQueue.collect(
+		vkutils::getTimelineValue(ctx, state.frameTimeline)
 	);
-	vkResetFences(ctx.device.logical, 1, &frame.fenceRenderFinished);
+
+	// pipelines replaced here were last used by the last submitted frame
+	if (state.shaderReloader) {
+		state.shaderReloader->applyReloads(
+			state.frameDeletionQueue, state.frameNumber
+		);
+	}
+	beginGpuProfilerFrame(
+		ctx,
+		state.gpuProfiler,
+		s_RendererInfo->currentFrameIndex,
+		frameNumber
+	);
+
+	// every buffer and set of the retired frame goes back in one reset per
+	// pool
+	for (auto &threadPools : frame.commandPools) {
+		for (auto &cmdPool : threadPools) {
+			vkutils::resetCommandBufferPool(ctx, cmdPool);
+		}
+	}
+	vkcore::resetDescriptorAllocator(ctx, frame.descriptorAllocator);
+	updateMemoryBudget(ctx, state.memoryBudget, frameNumber);
+	beginUploadRingFrame(state.uploadRing, s_RendererInfo->currentFrameIndex);
+
+	// uploads are acquired ahead of the frame's graphics submissions
+	{
+		CPU_ZONE("update uploads");
+		updateUploads(ctx, state.uploader);
+	}
+	// has to submit before the graph is compiled against the graphics
+	// timeline
+	{
+		CPU_ZONE("update textures");
+		state.textureStreamer->update(frameNumber);
+	}
+	{
+		CPU_ZONE("defragment");
+		updateDefragmenter(
+			ctx,
+			state.defragmenter,
+			state.renderQueues[(size_t)RenderGraphQueue::graphics],
+			state.frameTimeline,
+			frameNumber
+		);
+	}
 
 	uint32_t swapchainImageIndex{};
+	if (!headless) {
+		if (state.swapchainOutdated &&
+			!recreateSwapchain(ctx, state, window)) {
+			return;
+		}
+
+		VkResult res{};
+		{
+			CPU_ZONE("acquire");
+
+			res = vkAcquireNextImageKHR(
+				ctx.device.logical,
+				state.swapchain.handle,
+				UINT64_MAX,
+				frame.semFrameAvaliable,
+				VK_NULL_HANDLE,
+				&swapchainImageIndex
+			);
+		}
+
+		// a suboptimal image still signals the semaphore and can be presented
+		if (res == VK_ERROR_OUT_OF_DATE_KHR) {
+			state.swapchainOutdated = true;
+			return;
+		} else if (res == VK_SUBOPTIMAL_KHR) {
+			state.swapchainOutdated = true;
+		} else if (res != VK_SUCCESS) {
+			logWarning("could not acquire swapchain image: ", res);
+			return;
+		}
+
+		updateImGui(state);
+	}
+
+	RenderGraph graph{};
+	RenderGraphImage swapchainImage{};
 	{
-		VkResult res{ vkAcquireNextImageKHR(
-			ctx.device.logical,
-			state.swapchain.handle,
-			UINT64_MAX,
-			frame.semFrameAvaliable,
-			VK_NULL_HANDLE,
-			&swapchainImageIndex
+		// the gradient overwrites the draw image, only the previous frame's
+		// accesses have to finish first
+		RenderGraphImage drawImage{ importImage(
+			graph,
+			"draw image",
+			state.drawImage,
+			{ .stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+				  VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT |
+				  VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+			  .access = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+				  VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+			  .layout = VK_IMAGE_LAYOUT_UNDEFINED }
 		) };
 
-		if (res != VK_SUCCESS) {
-			std::cout << "uh oh" << std::endl;
+		addPass(
+			graph,
+			{ .name = "gradient",
+			  .images = { { drawImage, ImageAccess::computeStorageWrite } },
+			  .queue = RenderGraphQueue::compute,
+			  .record = [&state](VkCommandBuffer cmdBuffer, const RenderGraph &) {
+				  cmdDrawGradient(state, cmdBuffer);
+			  } }
+		);
+
+		VkDescriptorSet meshSet{
+			writeMeshSet(ctx, state, frame, frameNumber)
+		};
+		if (meshSet != VK_NULL_HANDLE) {
+			addPass(
+				graph,
+				{ .name = "mesh",
+				  .images = { { drawImage,
+								ImageAccess::colorAttachmentReadWrite } },
+				  .record = [&state, meshSet, drawImage](
+								VkCommandBuffer cmdBuffer,
+								const RenderGraph &renderGraph
+							) {
+					  cmdDrawMesh(
+						  state,
+						  cmdBuffer,
+						  meshSet,
+						  getImage(renderGraph, drawImage).view
+					  );
+				  } }
+			);
 		}
+
+		if (headless) {
+			exportImage(graph, drawImage);
+		} else {
+			Image swapchainTarget{
+				.handle = state.swapchain.images[swapchainImageIndex],
+				.view = state.swapchain.imageViews[swapchainImageIndex],
+				.extent = { .width = state.swapchain.extent.width,
+							.height = state.swapchain.extent.height,
+							.depth = 1 },
+				.format = state.swapchain.format,
+			};
+			swapchainImage =
+				importImage(graph, "swapchain image", swapchainTarget, {});
+
+			addPass(
+				graph,
+				{ .name = "blit to swapchain",
+				  .images = { { drawImage, ImageAccess::transferSrc },
+							  { swapchainImage, ImageAccess::transferDst } },
+				  .record = [=, &state](
+								VkCommandBuffer cmdBuffer,
+								const RenderGraph &renderGraph
+							) {
+					  cmdBlitImage(
+						  cmdBuffer,
+						  getImage(renderGraph, drawImage),
+						  state.renderExtent,
+						  getImage(renderGraph, swapchainImage)
+					  );
+				  } }
+			);
+
+			addPass(
+				graph,
+				{ .name = "imgui",
+				  .images = { { swapchainImage,
+								ImageAccess::colorAttachmentReadWrite } },
+				  .record = [&ctx, swapchainImage](
+								VkCommandBuffer cmdBuffer,
+								const RenderGraph &renderGraph
+							) {
+					  const Image &target{
+						  getImage(renderGraph, swapchainImage)
+					  };
+					  cmdRenderImGui(
+						  ctx,
+						  { target.extent.width, target.extent.height },
+						  cmdBuffer,
+						  target.view
+					  );
+				  } }
+			);
+
+			exportImage(graph, swapchainImage, ImageAccess::present);
+		}
+	}
+	{
+		CPU_ZONE("compile render graph");
+		compileRenderGraph(
+			ctx, graph, state.transientImages, state.renderQueues
+		);
 	}
-	vkResetCommandBuffer(frame.commandBuffer, 0);
 
-	VkCommandBufferBeginInfo cmdBeginInfo{ vkdefaults::commandBufferBeginInfo(
+	flushUploadRing(ctx, state.uploadRing);
+
+	std::vector<VkSemaphoreSubmitInfo> semWaitInfo;
+	std::vector<VkSemaphoreSubmitInfo> semSignalInfo{ vkdefaults::semSubmitInfo(
+		state.frameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frameNumber
 	) };
-	vkBeginCommandBuffer(frame.commandBuffer, &cmdBeginInfo);
+	if (!headless) {
+		semWaitInfo.emplace_back(vkdefaults::semSubmitInfo(
+			frame.semFrameAvaliable, getFirstUseStages(graph, swapchainImage)
+		));
+		semSignalInfo.emplace_back(vkdefaults::semSubmitInfo(
+			frame.semRenderFinished, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT
+		));
+	}
 
 	{
-		VkImage swapchainImage{ state.swapchain.images[swapchainImageIndex] };
+		CPU_ZONE("submit render graph");
+		submitRenderGraph(
+			ctx,
+			graph,
+			state.renderQueues,
+			frame.commandPools,
+			{ .waitSemaphores = semWaitInfo,
+			  .signalSemaphores = semSignalInfo,
+			  .profiler = &state.gpuProfiler,
+			  .threadPool = state.recordThreadPool.get() }
+		);
+	}
+	state.frameNumber = frameNumber;
+
+	if (frameNumber % PIPELINE_CACHE_SAVE_INTERVAL == 0) {
+		CPU_ZONE("save pipeline cache");
+		savePipelineCache(ctx, state.pipelineCache);
+	}
+
+	if (!headless) {
+		CPU_ZONE("present");
+
+		VkPresentInfoKHR presentInfo{
+			.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+			.waitSemaphoreCount = 1,
+			.pWaitSemaphores = &frame.semRenderFinished,
+			.swapchainCount = 1,
+			.pSwapchains = &state.swapchain.handle,
+			.pImageIndices = &swapchainImageIndex,
+		};
+
+		VkResult res{
+			vkQueuePresentKHR(state.presentationQueue, &presentInfo)
+		};
+		if (res == VK_ERROR_OUT_OF_DATE_KHR || res == VK_SUBOPTIMAL_KHR) {
+			state.swapchainOutdated = true;
+		} else if (res != VK_SUCCESS) {
+			logWarning("could not present: ", res);
+		}
+	}
+
+	s_RendererInfo->currentFrameIndex =
+		(s_RendererInfo->currentFrameIndex + 1) % framesInFlight;
+}
+
+void VulkanRenderer::onWindowResized() {
+	assertFatal(s_RendererInfo != nullptr);
+
+	s_RendererInfo->state.swapchainOutdated = true;
+}
+
+bool VulkanRenderer::exportGpuTrace(const std::filesystem::path &path) {
+	assertFatal(s_RendererInfo != nullptr);
+
+	return writeGpuTrace(s_RendererInfo->state.gpuProfiler, path);
+}
+
+void VulkanRenderer::cleanup() {
+	assertFatal(s_RendererInfo != nullptr);
+
+	VulkanState &state{ s_RendererInfo->state };
+
+	vkDeviceWaitIdle(s_RendererInfo->context.device.logical);
+	state.shaderReloader.reset();
+	savePipelineCache(s_RendererInfo->context, state.pipelineCache);
+	state.frameDeletionQueue.flush();
+	vkcore::releasePipeline(
+		s_RendererInfo->context, *state.objectRegistry, state.gradientPipeline
+	);
+	destroyTransientPool(s_RendererInfo->context, state.transientImages);
+	// still unregisters its images from the defragmenter
+	state.textureStreamer.reset();
+	// finishes the open pass, which may hold images the streamer released
+	destroyDefragmenter(s_RendererInfo->context, state.defragmenter);
+	destroyAsyncUploader(s_RendererInfo->context, state.uploader);
+	for (auto &frame : state.frames) {
+		vkcore::destroyDescriptorAllocator(
+			s_RendererInfo->context, frame.descriptorAllocator
+		);
+	}
+	state.drawImageDeletionQueue.flush();
+	state.swapchainDeletionQueue.flush();
+	s_RendererInfo->rendererDeletionQueue.flush();
+
+	delete (s_RendererInfo);
+}
 
-		vkutils::cmdTransitionImage(
+namespace {
+	void startShaderReloader(const VulkanContext &ctx, VulkanState &state) {
+#if defined(SHADER_SOURCE_DIR) && defined(GLSLC_PATH) && defined(GLSLC_FLAGS)
+		auto gradientConstants{
+			getWorkgroupSizeConstants(state.gradientWorkgroupSize)
+		};
+
+		std::vector<ReloadableComputePipeline> pipelines{
+			{ .source = "second.comp",
+			  .spv = "shaders/second.comp.spv",
+			  .layout = state.gradientPipeLayout,
+			  .specializationConstants = { gradientConstants.begin(),
+										   gradientConstants.end() },
+			  .pipeline = &state.gradientPipeline },
+		};
+
+		state.shaderReloader = std::make_unique<ShaderReloader>(
+			ctx,
+			*state.objectRegistry,
+			state.pipelineCache.handle,
+			SHADER_SOURCE_DIR,
+			GLSLC_PATH,
+			GLSLC_FLAGS,
+			std::move(pipelines)
+		);
+#else
+		logWarning(
+			"shader hot reload needs SHADER_SOURCE_DIR, GLSLC_PATH and "
+			"GLSLC_FLAGS"
+		);
+#endif
+	}
+
+	void startTextureStreamer(
+		const VulkanContext &ctx,
+		VulkanState &state,
+		const RendererSettings &settings
+	) {
+		state.textureStreamer = std::make_unique<TextureStreamer>(
 			ctx,
-			frame.commandBuffer,
-			state.drawImage.handle,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_GENERAL,
-			ctx.device.queueFamilyIndices.graphicsIndex,
-			ctx.device.queueFamilyIndices.graphicsIndex
+			state.uploader,
+			state.bindlessHeap,
+			state.defragmenter,
+			state.renderQueues[(size_t)RenderGraphQueue::graphics],
+			TextureStreamerSettings{ .budget = settings.textureBudget,
+									 .decodeThreads = TEXTURE_DECODE_THREADS }
 		);
 
-		vkCmdBindDescriptorSets(
-			frame.commandBuffer,
+		addMemoryPressureCallback(
+			state.memoryBudget,
+			[streamer = state.textureStreamer.get()](
+				const MemoryPressure &pressure
+			) { streamer->shedMemory(pressure.excess); }
+		);
+	}
+
+	void cmdDrawGradient(const VulkanState &state, VkCommandBuffer cmdBuffer) {
+		vkcore::cmdBindBindlessHeap(
+			cmdBuffer,
+			state.bindlessHeap,
 			VK_PIPELINE_BIND_POINT_COMPUTE,
-			state.gradientPipeLayout,
-			0,
-			1,
-			&state.imageDescriptorSet,
-			0,
-			nullptr
+			state.gradientPipeLayout
 		);
 		vkCmdBindPipeline(
-			frame.commandBuffer,
-			VK_PIPELINE_BIND_POINT_COMPUTE,
-			state.gradientPipeline
+			cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, state.gradientPipeline
 		);
 
-		struct PushConstants {
-			glm::vec4 d1;
-			glm::vec4 d2;
-			glm::vec4 d3;
-			glm::vec4 d4;
-		};
-
-		PushConstants constants{
+		GradientPushConstants constants{
 			.d1 = { 1.0, 1.0, 1.0, 1.0 },
 			.d2 = { 0.0, 0.0, 1.0, 1.0 },
+			.screen = state.drawImageIndex,
 		};
 
 		vkCmdPushConstants(
-			frame.commandBuffer,
+			cmdBuffer,
 			state.gradientPipeLayout,
 			VK_SHADER_STAGE_COMPUTE_BIT,
 			0,
@@ -156,136 +540,163 @@ void VulkanRenderer::renderFrame(SDL_Window *window) {
 		);
 
 		vkCmdDispatch(
-			frame.commandBuffer,
-			state.swapchain.extent.width / 16 + 1,
-			state.swapchain.extent.height / 16 + 1,
+			cmdBuffer,
+			getGroupCount(
+				state.renderExtent.width, state.gradientWorkgroupSize.x
+			),
+			getGroupCount(
+				state.renderExtent.height, state.gradientWorkgroupSize.y
+			),
 			1
 		);
+	}
 
-		vkutils::cmdTransitionImage(
-			ctx,
-			frame.commandBuffer,
-			state.drawImage.handle,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			ctx.device.queueFamilyIndices.graphicsIndex,
-			ctx.device.queueFamilyIndices.graphicsIndex
-		);
+	VkDescriptorSet writeMeshSet(
+		const VulkanContext &ctx,
+		VulkanState &state,
+		PerFrameVulkanState &frame,
+		const uint64_t frameNumber
+	) {
+		// keeps the quad square whatever the render extent
+		const float aspect{ (float)state.renderExtent.height /
+							(float)state.renderExtent.width };
+		MeshUniforms uniforms{
+			.model = glm::rotate(
+				glm::mat4{ 1.f },
+				(float)frameNumber * MESH_SPIN_PER_FRAME,
+				glm::vec3{ 0.f, 0.f, 1.f }
+			),
+			.view = glm::mat4{ 1.f },
+			.proj = glm::scale(glm::mat4{ 1.f }, glm::vec3{ aspect, 1.f, 1.f }),
+		};
+		UploadAllocation uniformAllocation{
+			pushUpload(state.uploadRing, uniforms)
+		};
+		if (!uniformAllocation.mapped) {
+			logWarning("upload ring full, skipping the mesh this frame");
+			return VK_NULL_HANDLE;
+		}
 
-		vkutils::cmdTransitionImage(
+		VkDescriptorSet set{ vkcore::allocateDescriptorSet(
 			ctx,
-			frame.commandBuffer,
-			swapchainImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			ctx.device.queueFamilyIndices.graphicsIndex,
-			ctx.device.queueFamilyIndices.graphicsIndex
-		);
+			frame.descriptorAllocator,
+			state.meshSetLayout,
+			state.meshSetLayoutInfo
+		) };
 
-		VkExtent3D swapchainExtent{ .width = state.swapchain.extent.width,
-									.height = state.swapchain.extent.height,
-									.depth = 1 };
-		VkImageBlit2 blitRegion{
-			vkdefaults::blitRegion(state.drawImage.extent, swapchainExtent)
+		VkDescriptorBufferInfo uniformInfo{
+			.buffer = uniformAllocation.buffer,
+			.offset = uniformAllocation.offset,
+			.range = uniformAllocation.size,
 		};
-
-		VkBlitImageInfo2 blitInfo{
-			.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
-			.srcImage = state.drawImage.handle,
-			.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-			.dstImage = swapchainImage,
-			.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			.regionCount = 1,
-			.pRegions = &blitRegion,
-			.filter = VK_FILTER_LINEAR,
+		VkDescriptorImageInfo textureInfo{
+			.sampler = state.meshSampler,
+			.imageView = state.meshTexture.view,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 		};
 
-		vkCmdBlitImage2(frame.commandBuffer, &blitInfo);
-
-		vkutils::cmdTransitionImage(
-			ctx,
-			frame.commandBuffer,
-			swapchainImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			ctx.device.queueFamilyIndices.graphicsIndex,
-			ctx.device.queueFamilyIndices.presentationIndex
-		);
-
-		cmdRenderImGui(
-			ctx,
-			state.swapchain.extent,
-			frame.commandBuffer,
-			state.swapchain.imageViews[swapchainImageIndex]
+		// bindings of first.vert and first.frag
+		std::array<VkWriteDescriptorSet, 2> writes{ {
+			{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			  .dstSet = set,
+			  .dstBinding = 0,
+			  .descriptorCount = 1,
+			  .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+			  .pBufferInfo = &uniformInfo },
+			{ .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			  .dstSet = set,
+			  .dstBinding = 1,
+			  .descriptorCount = 1,
+			  .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			  .pImageInfo = &textureInfo },
+		} };
+		vkUpdateDescriptorSets(
+			ctx.device.logical,
+			(uint32_t)writes.size(),
+			writes.data(),
+			0,
+			nullptr
 		);
 
-		vkutils::cmdTransitionImage(
-			ctx,
-			frame.commandBuffer,
-			swapchainImage,
-			VK_IMAGE_ASPECT_COLOR_BIT,
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
-			ctx.device.queueFamilyIndices.graphicsIndex,
-			ctx.device.queueFamilyIndices.presentationIndex
-		);
+		return set;
 	}
 
-	vkEndCommandBuffer(frame.commandBuffer);
+	void cmdDrawMesh(
+		const VulkanState &state,
+		VkCommandBuffer cmdBuffer,
+		const VkDescriptorSet set,
+		const VkImageView target
+	) {
+		VkRenderingAttachmentInfo colorAttachmentInfo{
+			.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
+			.imageView = target,
+			.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+			.storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+		};
+		VkRenderingInfo renderInfo{
+			.sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
+			.renderArea = { .extent = state.renderExtent },
+			.layerCount = 1,
+			.colorAttachmentCount = 1,
+			.pColorAttachments = &colorAttachmentInfo,
+		};
+		vkCmdBeginRendering(cmdBuffer, &renderInfo);
 
-	std::array<VkCommandBufferSubmitInfo, 1> cmdBufferInfo{
-		vkdefaults::cmdBufferSubmitInfo(frame.commandBuffer)
-	};
-	std::array<VkSemaphoreSubmitInfo, 1> semWaitInfo{ vkdefaults::semSubmitInfo(
-		frame.semFrameAvaliable, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
-	) };
-	std::array<VkSemaphoreSubmitInfo, 1> semSignalInfo{
-		vkdefaults::semSubmitInfo(
-			frame.semRenderFinished,
-			VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
-		)
-	};
+		VkViewport viewport{
+			.width = (float)state.renderExtent.width,
+			.height = (float)state.renderExtent.height,
+			.maxDepth = 1.f,
+		};
+		VkRect2D scissor{ .extent = state.renderExtent };
+		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-	VkSubmitInfo2 submitInfo{
-		vkdefaults::submitInfo(cmdBufferInfo, semWaitInfo, semSignalInfo)
-	};
-	if (vkQueueSubmit2(
-			state.graphicsQueue, 1, &submitInfo, frame.fenceRenderFinished
-		) != VK_SUCCESS) {
-		logWarning("main render queue submit failed");
-	}
+		vkCmdBindPipeline(
+			cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, state.meshPipeline
+		);
+		vkCmdBindDescriptorSets(
+			cmdBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			state.meshPipeLayout,
+			0,
+			1,
+			&set,
+			0,
+			nullptr
+		);
 
-	VkPresentInfoKHR presentInfo{
-		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-		.waitSemaphoreCount = 1,
-		.pWaitSemaphores = &frame.semRenderFinished,
-		.swapchainCount = 1,
-		.pSwapchains = &state.swapchain.handle,
-		.pImageIndices = &swapchainImageIndex,
-	};
+		VkDeviceSize vertexOffset{};
+		vkCmdBindVertexBuffers(
+			cmdBuffer, 0, 1, &state.meshVertices.handle, &vertexOffset
+		);
+		vkCmdDraw(cmdBuffer, state.meshVertexCount, 1, 0, 0);
 
-	{
-		VkResult res{
-			vkQueuePresentKHR(state.presentationQueue, &presentInfo)
-		};
-		if (res != VK_SUCCESS) {
-			logWarning("present uh oh");
-		}
+		vkCmdEndRendering(cmdBuffer);
 	}
 
-	s_RendererInfo->currentFrameIndex =
-		(s_RendererInfo->currentFrameIndex + 1) %
-		VulkanState::MAX_FRAMES_IN_FLIGHT;
-}
-
-void VulkanRenderer::cleanup() {
-	assertFatal(s_RendererInfo != nullptr);
+	void cmdBlitImage(
+		VkCommandBuffer cmdBuffer,
+		const Image &srcImage,
+		const VkExtent2D srcExtent,
+		const Image &dstImage
+	) {
+		VkImageBlit2 blitRegion{ vkdefaults::blitRegion(
+			{ .width = srcExtent.width, .height = srcExtent.height, .depth = 1 },
+			dstImage.extent
+		) };
 
-	vkDeviceWaitIdle(s_RendererInfo->context.device.logical);
-	s_RendererInfo->rendererDeletionQueue.flush();
+		VkBlitImageInfo2 blitInfo{
+			.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+			.srcImage = srcImage.handle,
+			.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.dstImage = dstImage.handle,
+			.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.regionCount = 1,
+			.pRegions = &blitRegion,
+			.filter = VK_FILTER_LINEAR,
+		};
 
-	delete (s_RendererInfo);
-}
+		vkCmdBlitImage2(cmdBuffer, &blitInfo);
+	}
+}  // namespace
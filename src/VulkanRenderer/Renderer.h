@@ -1,9 +1,65 @@
 #pragma once
 
+#include <stdint.h>
+
+#include <filesystem>
+
 typedef struct SDL_Window SDL_Window;
 
 namespace VulkanRenderer {
-	void init(SDL_Window* window);
+	// falls back to fifo when the surface doesn't support the mode
+	enum class PresentMode : uint32_t {
+		mailbox = 0,
+		fifo,
+		fifoRelaxed,
+		immediate,
+	};
+
+	struct RendererSettings {
+		// no window, surface or swapchain. frames are rendered into the draw
+		// image at renderWidth x renderHeight
+		bool headless{};
+		uint32_t renderWidth{};
+		uint32_t renderHeight{};
+
+		// 1 for the lowest latency, more for throughput. the swapchain gets
+		// one image more than this
+		uint32_t framesInFlight{ 2 };
+		PresentMode presentMode{ PresentMode::mailbox };
+
+		// threads recording passes, including the one calling renderFrame.
+		// 0 picks from the core count
+		uint32_t recordThreads{};
+
+		// reused across runs on the same device and driver, empty disables
+		// saving it
+		std::filesystem::path pipelineCachePath{ "pipeline_cache.bin" };
+
+		// recompiles shaders when their source changes and swaps the
+		// pipelines in between frames
+		bool shaderHotReload{};
+
+		// fastest workgroup sizes per device and driver, empty benchmarks
+		// them on every start
+		std::filesystem::path workgroupCachePath{ "workgroup_sizes.txt" };
+		bool retuneWorkgroups{};
+
+		// device memory streamed textures may take before their least
+		// recently used mips are evicted
+		uint64_t textureBudget{ 512ull * 1024 * 1024 };
+		// device memory moved per frame to compact fragmented blocks, 0
+		// disables defragmentation
+		uint64_t defragmentBytesPerFrame{ 8ull * 1024 * 1024 };
+	};
+
+	// window may be null when settings.headless is set
+	void init(SDL_Window* window, const RendererSettings& settings);
+	// skips the frame while the window has no area
 	void renderFrame(SDL_Window* window);
+	// the swapchain is recreated at the start of the next frame
+	void onWindowResized();
+
+	// chrome trace of the gpu zones of the last few hundred frames
+	bool exportGpuTrace(const std::filesystem::path& path);
 	void cleanup();
 };	// namespace VulkanRenderer
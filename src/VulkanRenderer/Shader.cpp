@@ -1,116 +1,169 @@
 #include "RendererPCH.h"
 #include "Shader.h"
-#include "utils/FileIO.h"
 #include "Context.h"
 #include "Cleanup.h"
 #include "Pipelines.h"
+#include "ShaderArchive.h"
+#include "ShaderReflection.h"
+#include "vkcore/ObjectRegistry.h"
 
 #include "debug/Debug.h"
+#include "utils/CpuProfiler.h"
+#include "utils/ThreadPool.h"
 
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
 #include <string>
 
-#include <spirv_reflect.h>
-
 using namespace vkcore;
 
 namespace {
-	const std::unordered_map<std::string, VkShaderStageFlags>
-		extensionToShaderStageMap{ { ".comp", VK_SHADER_STAGE_COMPUTE_BIT } };
-
 	ShaderSourceInfo readShader(const std::filesystem::path& shaderPath);
-	ShaderLayoutInfo parseShaderLayoutInfo(const ShaderSourceInfo& shaderSrcInfo
+
+	void mergeDescriptorSetLayoutInfo(
+		DescriptorSetLayoutInfo& merged, const DescriptorSetLayoutInfo& setInfo
+	);
+
+	// runs job for every index, on threadPool when set
+	void forEachShader(
+		ThreadPool* threadPool,
+		const uint32_t count,
+		const std::function<void(uint32_t index)>& job
 	);
 }  // namespace
 
-SharedShaderObjects vkcore::createSharedShaderObjects(
-	const VulkanContext& ctx,
-	const ShaderInputInfo& inputInfo,
-	const VkShaderStageFlags stage,
-	DeletionQueue& deletionQueue
+// have it use default shaders if a shader isnt found
+std::vector<ShaderInfo> vkcore::parseShaders(
+	const std::span<const std::filesystem::path>& shaderPaths,
+	ThreadPool* threadPool,
+	const ShaderArchive* archive
 ) {
-	VkDescriptorPool pool{ createDescriptorPool(
-		ctx,
-		inputInfo.layoutInfo.descriptorSetLayoutInfos,
-		inputInfo.layoutInfo.descriptorSetLayoutInfos.size(),
-		deletionQueue
-	) };
+	CPU_ZONE("parseShaders");
 
-	ShaderLayout layout{
-		createShaderLayout(ctx, inputInfo, stage, deletionQueue)
-	};
+	std::vector<ShaderInfo> shaderInfos(shaderPaths.size());
 
-	SharedShaderObjects shaderObjects{ .descriptorPool = pool,
-									   .layout = layout };
-
-	return shaderObjects;
-}
+	forEachShader(threadPool, shaderPaths.size(), [&](uint32_t index) {
+		CPU_ZONE("parseShader");
 
-UniqueShaderObjects vkcore::createUniqueShaderObjects(
-	const VulkanContext& ctx,
-	const ShaderSourceInfo& sourceInfo,
-	const SharedShaderObjects sharedShaderObjects
-) {
-	std::vector<VkDescriptorSet> descriptorSets{ allocateDescriptorSets(
-		ctx,
-		sharedShaderObjects.layout.shaderDescriptorLayout,
-		sharedShaderObjects.descriptorPool
-	) };
-
-	UniqueShaderObjects uniqueShaderObjects{
-		.descriptorSets = descriptorSets,
-		.sourceInfo = sourceInfo,
-	};
-
-	return uniqueShaderObjects;
-}
-
-// have it use default shaders if a shader isnt found
-std::vector<ShaderInfo> vkcore::parseShaders(
-	const std::span<const std::filesystem::path>& shaderPaths
-) {
-	std::vector<ShaderInfo> shaderInfos;
+		if (archive) {
+			ShaderInfo shaderInfo{ loadArchivedShader(
+				*archive, shaderPaths[index].filename().string()
+			) };
+			if (shaderInfo.sourceInfo.spv.data()) {
+				shaderInfos[index] = std::move(shaderInfo);
+				return;
+			}
+		}
 
-	for (auto& path : shaderPaths) {
-		ShaderSourceInfo sourceInfo{ readShader(path) };
+		ShaderSourceInfo sourceInfo{ readShader(shaderPaths[index]) };
 
 		// TODO: change to default shader
 		ShaderInfo shaderInfo{};
 
 		if (sourceInfo.spv.data()) {
-			ShaderInputInfo inputInfo{ .layoutInfo =
-										   parseShaderLayoutInfo(sourceInfo) };
+			shaderInfo = { .sourceInfo = sourceInfo,
+						   .inputInfo = reflectShader(sourceInfo) };
+		}
 
-			shaderInfo = { .sourceInfo = sourceInfo, .inputInfo = inputInfo };
+		shaderInfos[index] = std::move(shaderInfo);
+	});
+
+	return shaderInfos;
+}
+
+ShaderInputInfo
+	vkcore::mergeShaderInputInfos(const std::span<const ShaderInfo>& shaders) {
+	ShaderInputInfo merged{};
+	ShaderLayoutInfo& mergedLayout{ merged.layoutInfo };
+
+	uint32_t pushConstantBegin{ UINT32_MAX };
+	uint32_t pushConstantEnd{};
+	VkShaderStageFlags pushConstantStages{};
+
+	for (const auto& shader : shaders) {
+		const ShaderLayoutInfo& layoutInfo{ shader.inputInfo.layoutInfo };
+
+		if (mergedLayout.descriptorSetLayoutInfos.size() <
+			layoutInfo.descriptorSetLayoutInfos.size()) {
+			mergedLayout.descriptorSetLayoutInfos.resize(
+				layoutInfo.descriptorSetLayoutInfos.size()
+			);
+		}
+		for (size_t set{}; set < layoutInfo.descriptorSetLayoutInfos.size();
+			 set++) {
+			mergeDescriptorSetLayoutInfo(
+				mergedLayout.descriptorSetLayoutInfos[set],
+				layoutInfo.descriptorSetLayoutInfos[set]
+			);
 		}
 
-		shaderInfos.emplace_back(shaderInfo);
+		// a stage can only be in one range, so every stage gets all of it
+		for (const auto& range : layoutInfo.pushConstantRanges) {
+			pushConstantBegin = std::min(pushConstantBegin, range.offset);
+			pushConstantEnd =
+				std::max(pushConstantEnd, range.offset + range.size);
+			pushConstantStages |= range.stageFlags;
+		}
+
+		for (const auto& constant : layoutInfo.specializationConstants) {
+			auto constantItt{ std::find_if(
+				mergedLayout.specializationConstants.begin(),
+				mergedLayout.specializationConstants.end(),
+				[&](const SpecializationConstantInfo& mergedConstant) {
+					return mergedConstant.id == constant.id;
+				}
+			) };
+			if (constantItt == mergedLayout.specializationConstants.end()) {
+				mergedLayout.specializationConstants.emplace_back(constant);
+			}
+		}
+
+		if (!shader.inputInfo.vertexInputs.empty()) {
+			merged.vertexInputs = shader.inputInfo.vertexInputs;
+		}
 	}
 
-	return shaderInfos;
+	if (pushConstantStages) {
+		mergedLayout.pushConstantRanges.emplace_back(VkPushConstantRange{
+			.stageFlags = pushConstantStages,
+			.offset = pushConstantBegin,
+			.size = pushConstantEnd - pushConstantBegin,
+		});
+	}
+
+	return merged;
+}
+
+VkShaderStageFlags
+	vkcore::getShaderStages(const std::span<const ShaderInfo>& shaders) {
+	VkShaderStageFlags stages{};
+	for (const auto& shader : shaders) {
+		stages |= shader.sourceInfo.stage;
+	}
+
+	return stages;
 }
 
 std::vector<VkPipelineShaderStageCreateInfo> vkcore::createShaderStages(
 	const VulkanContext& ctx,
+	ObjectRegistry& registry,
 	const std::span<const ShaderSourceInfo>& shaderSourceInfos,
+	ThreadPool* threadPool,
 	DeletionQueue& deletionQueue
 ) {
-	std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfos;
-	shaderStageCreateInfos.reserve(shaderSourceInfos.size());
-
-	for (auto& info : shaderSourceInfos) {
-		VkShaderModuleCreateInfo moduleInfo{
-			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-			.codeSize = (uint32_t)info.spv.size(),
-			.pCode = (uint32_t*)info.spv.data(),
-		};
+	CPU_ZONE("createShaderStages");
 
-		VkShaderModule shaderModule{};
-		if (vkCreateShaderModule(
-				ctx.device.logical, &moduleInfo, nullptr, &shaderModule
-			) != VK_SUCCESS) {
-			logWarning("could not compile shader");
-		}
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStageCreateInfos(
+		shaderSourceInfos.size()
+	);
+
+	forEachShader(threadPool, shaderSourceInfos.size(), [&](uint32_t index) {
+		const ShaderSourceInfo& info{ shaderSourceInfos[index] };
+
+		VkShaderModule shaderModule{
+			acquireShaderModule(ctx, registry, info.spv)
+		};
 
 		VkPipelineShaderStageCreateInfo shaderStageInfo{
 			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -119,12 +172,12 @@ std::vector<VkPipelineShaderStageCreateInfo> vkcore::createShaderStages(
 			.pName = "main",
 		};
 
-		shaderStageCreateInfos.emplace_back(shaderStageInfo);
-	}
+		shaderStageCreateInfos[index] = shaderStageInfo;
+	});
 
-	auto deleter{ ([=]() {
+	auto deleter{ ([=, &registry]() {
 		for (auto& stage : shaderStageCreateInfos) {
-			vkDestroyShaderModule(ctx.device.logical, stage.module, nullptr);
+			releaseShaderModule(ctx, registry, stage.module);
 		}
 	}) };
 
@@ -134,76 +187,38 @@ std::vector<VkPipelineShaderStageCreateInfo> vkcore::createShaderStages(
 }
 
 namespace {
-	ShaderLayoutInfo parseShaderLayoutInfo(const ShaderSourceInfo& shaderSrcInfo
+	void mergeDescriptorSetLayoutInfo(
+		DescriptorSetLayoutInfo& merged, const DescriptorSetLayoutInfo& setInfo
 	) {
-		SpvReflectResult res{};
-
-		SpvReflectShaderModule reflectModule{};
-		res = spvReflectCreateShaderModule(
-			shaderSrcInfo.spv.size(), shaderSrcInfo.spv.data(), &reflectModule
-		);
-		assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
-
-		uint32_t inSetsCount{};
-		res = spvReflectEnumerateDescriptorSets(
-			&reflectModule, &inSetsCount, nullptr
-		);
-		assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
-
-		std::vector<SpvReflectDescriptorSet*> sets(inSetsCount);
-		res = spvReflectEnumerateDescriptorSets(
-			&reflectModule, &inSetsCount, sets.data()
-		);
-		assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
-
-		uint32_t pushConstantCount{};
-		res = spvReflectEnumeratePushConstantBlocks(
-			&reflectModule, &pushConstantCount, nullptr
-		);
-		assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
-
-		std::vector<SpvReflectBlockVariable*> pushConstants(pushConstantCount);
-		res = spvReflectEnumeratePushConstantBlocks(
-			&reflectModule, &pushConstantCount, pushConstants.data()
-		);
-		assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
-
-		int nSets{ (int)sets.size() };
-
-		ShaderLayoutInfo layoutInfo;
-		layoutInfo.descriptorSetLayoutInfos.reserve(nSets);
-
-		for (size_t setIndex{}; setIndex < nSets; setIndex++) {
-			DescriptorSetLayoutInfo setLayout(sets[setIndex]->binding_count);
-
-			for (size_t bindingIndex{};
-				 bindingIndex < sets[setIndex]->binding_count;
-				 bindingIndex++) {
-				auto& binding{ sets[setIndex]->bindings[bindingIndex] };
-
-				setLayout[bindingIndex] = { .binding = binding->binding,
-											.type = (VkDescriptorType
-											)binding->descriptor_type,
-											.count = binding->count };
+		for (const auto& binding : setInfo) {
+			auto bindingItt{ std::find_if(
+				merged.begin(),
+				merged.end(),
+				[&](const DescriptorBindingInfo& mergedBinding) {
+					return mergedBinding.binding == binding.binding;
+				}
+			) };
+
+			if (bindingItt == merged.end()) {
+				merged.emplace_back(binding);
+				continue;
 			}
 
-			layoutInfo.descriptorSetLayoutInfos.emplace_back(setLayout);
-		}
-
-		layoutInfo.pushConstantRanges.reserve(pushConstantCount);
-		for (const auto& pushConstant : pushConstants) {
-			VkPushConstantRange range{
-				.stageFlags = shaderSrcInfo.stage,
-				.offset = pushConstant->offset,
-				.size = pushConstant->size,
-			};
-
-			layoutInfo.pushConstantRanges.emplace_back(range);
+			if (bindingItt->type != binding.type ||
+				bindingItt->count != binding.count) {
+				logWarning(
+					"stages disagree on descriptor binding ", binding.binding
+				);
+			}
 		}
 
-		spvReflectDestroyShaderModule(&reflectModule);
-
-		return layoutInfo;
+		std::sort(
+			merged.begin(),
+			merged.end(),
+			[](const DescriptorBindingInfo& a, const DescriptorBindingInfo& b) {
+				return a.binding < b.binding;
+			}
+		);
 	}
 
 	ShaderSourceInfo readShader(const std::filesystem::path& shaderPath) {
@@ -215,19 +230,39 @@ namespace {
 			return {};
 		}
 
-		// stemed to remove .spv
-		std::string extension{ shaderPath.stem().extension().string() };
-
-		auto shaderStageItt{ extensionToShaderStageMap.find(extension) };
-		if (shaderStageItt == extensionToShaderStageMap.end()) {
+		VkShaderStageFlags stage{ getShaderStage(shaderPath) };
+		if (!stage) {
 			logWarning("invalid shader extension");
 			return {};
 		}
 
+		auto file{ MappedFile::open(shaderPath) };
+		if (!file) {
+			return {};
+		}
+
 		ShaderSourceInfo info{
-			.spv = readFile(shaderPath.string()),
-			.stage = shaderStageItt->second,
+			.file = file,
+			.spv = file->getData(),
+			.stage = stage,
 		};
 		return info;
 	}
+
+	void forEachShader(
+		ThreadPool* threadPool,
+		const uint32_t count,
+		const std::function<void(uint32_t index)>& job
+	) {
+		if (threadPool && count > 1) {
+			threadPool->parallelFor(count, [&](uint32_t index, uint32_t) {
+				job(index);
+			});
+			return;
+		}
+
+		for (uint32_t i{}; i < count; i++) {
+			job(i);
+		}
+	}
 }  // namespace
@@ -3,22 +3,41 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 #include <filesystem>
+#include <memory>
 #include <span>
 #include <unordered_map>
 
 #include "vkcore/ShaderLayout.h"
+#include "utils/MappedFile.h"
 
 // forward declerations
 class DeletionQueue;
+class ThreadPool;
 struct VulkanContext;
 
 namespace vkcore {
+	struct ShaderArchive;
+}
+
+namespace vkcore {
+	// a vertex shader input, size is the bytes the attribute takes in a
+	// vertex buffer
+	struct VertexInputInfo {
+		uint32_t location;
+		VkFormat format;
+		uint32_t size;
+	};
+
 	struct ShaderInputInfo {
 		vkcore::ShaderLayoutInfo layoutInfo;
+		// only vertex shaders have any, sorted by location
+		std::vector<VertexInputInfo> vertexInputs;
 	};
 
 	struct ShaderSourceInfo {
-		std::vector<char> spv;
+		// spv points into file, copies share the mapping
+		std::shared_ptr<const MappedFile> file;
+		std::span<const char> spv;
 		VkShaderStageFlags stage;
 	};
 
@@ -27,35 +46,30 @@ namespace vkcore {
 		ShaderInputInfo inputInfo;
 	};
 
-	struct SharedShaderObjects {
-		VkDescriptorPool descriptorPool;
-		vkcore::ShaderLayout layout;
-	};
-
-	struct UniqueShaderObjects {
-		std::vector<VkDescriptorSet> descriptorSets;
-		ShaderSourceInfo sourceInfo;
-	};
-
-	SharedShaderObjects createSharedShaderObjects(
-		const VulkanContext& ctx,
-		const ShaderInputInfo& inputInfo,
-		const VkShaderStageFlags stage,
-		DeletionQueue& deletionQueue
+	// shaders are mapped and reflected in parallel on threadPool when set.
+	// shaders in archive are taken from it by file name instead, without
+	// reflection. the result is in the order of shaderPaths
+	std::vector<ShaderInfo> parseShaders(
+		const std::span<const std::filesystem::path>& shaderPaths,
+		ThreadPool* threadPool = nullptr,
+		const ShaderArchive* archive = nullptr
 	);
 
-	UniqueShaderObjects createUniqueShaderObjects(
-		const VulkanContext& ctx,
-		const ShaderSourceInfo& sourceInfo,
-		const SharedShaderObjects sharedShaderObjects
-	);
+	// the inputs of every stage of a pipeline. bindings used by several
+	// stages have to agree, push constants become one range
+	ShaderInputInfo
+		mergeShaderInputInfos(const std::span<const ShaderInfo>& shaders);
 
-	std::vector<ShaderInfo>
-		parseShaders(const std::span<const std::filesystem::path>& shaderPaths);
+	VkShaderStageFlags
+		getShaderStages(const std::span<const ShaderInfo>& shaders);
 
+	// modules are created in parallel on threadPool when set. identical
+	// modules are shared through registry, deletionQueue releases them
 	std::vector<VkPipelineShaderStageCreateInfo> createShaderStages(
 		const VulkanContext& ctx,
+		ObjectRegistry& registry,
 		const std::span<const ShaderSourceInfo>& shaderSourceInfos,
+		ThreadPool* threadPool,
 		DeletionQueue& deletionQueue
 	);
 }  // namespace vkcore
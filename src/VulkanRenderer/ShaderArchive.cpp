@@ -0,0 +1,340 @@
+#include "RendererPCH.h"
+
+#include "ShaderArchive.h"
+
+#include "debug/Debug.h"
+
+#include <cstring>
+#include <fstream>
+#include <type_traits>
+
+using namespace vkcore;
+
+namespace {
+	constexpr uint32_t SHADER_ARCHIVE_MAGIC{ 0x41534143 };  // "CASA"
+	constexpr uint32_t SHADER_ARCHIVE_VERSION{ 1 };
+
+	struct ShaderArchiveHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t shaderCount;
+		uint32_t reserved;
+	};
+
+	// offsets are from the start of the file. spir-v is 4 byte aligned so
+	// it can be handed to vkCreateShaderModule in place
+	struct ShaderArchiveEntry {
+		uint32_t nameOffset;
+		uint32_t nameSize;
+		uint32_t stage;
+		uint32_t spvOffset;
+		uint32_t spvSize;
+		uint32_t inputOffset;
+		uint32_t inputSize;
+		uint32_t reserved;
+	};
+
+	// sequential reads from a blob, every read past the end fails the
+	// whole reader instead of reading garbage
+	struct BlobReader {
+		std::span<const char> data;
+		size_t offset;
+		bool failed;
+	};
+
+	template<typename T>
+	void writeValue(std::vector<char>& blob, const T& value);
+	void alignBlob(std::vector<char>& blob);
+
+	template<typename T>
+	T readValue(BlobReader& reader);
+
+	std::vector<char> serializeInputInfo(const ShaderInputInfo& inputInfo);
+	bool deserializeInputInfo(
+		const std::span<const char> data, ShaderInputInfo& inputInfo
+	);
+}  // namespace
+
+bool vkcore::writeShaderArchive(
+	const std::filesystem::path& path,
+	const std::span<const ShaderArchiveInput>& shaders
+) {
+	std::vector<char> blob;
+
+	ShaderArchiveHeader header{
+		.magic = SHADER_ARCHIVE_MAGIC,
+		.version = SHADER_ARCHIVE_VERSION,
+		.shaderCount = (uint32_t)shaders.size(),
+	};
+	writeValue(blob, header);
+
+	// filled in once the offsets are known
+	size_t entriesOffset{ blob.size() };
+	blob.resize(blob.size() + shaders.size() * sizeof(ShaderArchiveEntry));
+
+	std::vector<ShaderArchiveEntry> entries;
+	entries.reserve(shaders.size());
+	for (const auto& shader : shaders) {
+		ShaderArchiveEntry entry{ .stage = shader.stage };
+
+		entry.nameOffset = blob.size();
+		entry.nameSize = shader.name.size();
+		blob.insert(blob.end(), shader.name.begin(), shader.name.end());
+		alignBlob(blob);
+
+		entry.spvOffset = blob.size();
+		entry.spvSize = shader.spv.size();
+		blob.insert(blob.end(), shader.spv.begin(), shader.spv.end());
+		alignBlob(blob);
+
+		std::vector<char> input{ serializeInputInfo(shader.inputInfo) };
+		entry.inputOffset = blob.size();
+		entry.inputSize = input.size();
+		blob.insert(blob.end(), input.begin(), input.end());
+
+		entries.emplace_back(entry);
+	}
+
+	std::memcpy(
+		blob.data() + entriesOffset,
+		entries.data(),
+		entries.size() * sizeof(ShaderArchiveEntry)
+	);
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file) {
+		logWarning("could not write shader archive ", path);
+		return false;
+	}
+
+	file.write(blob.data(), blob.size());
+	if (!file) {
+		logWarning("could not write shader archive ", path);
+		return false;
+	}
+
+	return true;
+}
+
+ShaderArchive vkcore::openShaderArchive(const std::filesystem::path& path) {
+	if (!std::filesystem::exists(path)) {
+		return {};
+	}
+
+	auto file{ MappedFile::open(path) };
+	if (!file) {
+		return {};
+	}
+
+	std::span<const char> data{ file->getData() };
+
+	ShaderArchiveHeader header{};
+	if (data.size() < sizeof(header)) {
+		logWarning("shader archive ", path, " is truncated");
+		return {};
+	}
+	std::memcpy(&header, data.data(), sizeof(header));
+
+	if (header.magic != SHADER_ARCHIVE_MAGIC ||
+		header.version != SHADER_ARCHIVE_VERSION) {
+		logWarning("shader archive ", path, " is from another version");
+		return {};
+	}
+
+	size_t entriesEnd{
+		sizeof(header) + (size_t)header.shaderCount * sizeof(ShaderArchiveEntry)
+	};
+	if (data.size() < entriesEnd) {
+		logWarning("shader archive ", path, " is truncated");
+		return {};
+	}
+
+	ShaderArchive archive{ .file = file };
+	for (uint32_t i{}; i < header.shaderCount; i++) {
+		ShaderArchiveEntry entry{};
+		std::memcpy(
+			&entry,
+			data.data() + sizeof(header) + i * sizeof(ShaderArchiveEntry),
+			sizeof(entry)
+		);
+
+		if ((size_t)entry.nameOffset + entry.nameSize > data.size() ||
+			(size_t)entry.spvOffset + entry.spvSize > data.size() ||
+			(size_t)entry.inputOffset + entry.inputSize > data.size()) {
+			logWarning("shader archive ", path, " is truncated");
+			return {};
+		}
+
+		std::string name(data.data() + entry.nameOffset, entry.nameSize);
+		archive.entryIndices.emplace(std::move(name), i);
+	}
+
+	return archive;
+}
+
+ShaderInfo vkcore::loadArchivedShader(
+	const ShaderArchive& archive, std::string_view name
+) {
+	if (!archive.file) {
+		return {};
+	}
+
+	auto indexItt{ archive.entryIndices.find(std::string(name)) };
+	if (indexItt == archive.entryIndices.end()) {
+		return {};
+	}
+
+	std::span<const char> data{ archive.file->getData() };
+
+	ShaderArchiveEntry entry{};
+	std::memcpy(
+		&entry,
+		data.data() + sizeof(ShaderArchiveHeader) +
+			indexItt->second * sizeof(ShaderArchiveEntry),
+		sizeof(entry)
+	);
+
+	ShaderInfo shaderInfo{
+		.sourceInfo = { .file = archive.file,
+						.spv = data.subspan(entry.spvOffset, entry.spvSize),
+						.stage = entry.stage },
+	};
+
+	if (!deserializeInputInfo(
+			data.subspan(entry.inputOffset, entry.inputSize),
+			shaderInfo.inputInfo
+		)) {
+		logWarning("shader archive entry ", name, " is corrupt");
+		return {};
+	}
+
+	return shaderInfo;
+}
+
+namespace {
+	template<typename T>
+	void writeValue(std::vector<char>& blob, const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		const char* bytes{ reinterpret_cast<const char*>(&value) };
+		blob.insert(blob.end(), bytes, bytes + sizeof(T));
+	}
+
+	void alignBlob(std::vector<char>& blob) {
+		blob.resize((blob.size() + 3) & ~(size_t)3);
+	}
+
+	template<typename T>
+	T readValue(BlobReader& reader) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		T value{};
+		if (reader.failed || reader.offset + sizeof(T) > reader.data.size()) {
+			reader.failed = true;
+			return value;
+		}
+
+		std::memcpy(&value, reader.data.data() + reader.offset, sizeof(T));
+		reader.offset += sizeof(T);
+
+		return value;
+	}
+
+	// counts followed by their elements, every field a uint32_t
+	std::vector<char> serializeInputInfo(const ShaderInputInfo& inputInfo) {
+		const ShaderLayoutInfo& layoutInfo{ inputInfo.layoutInfo };
+		std::vector<char> blob;
+
+		writeValue(blob, (uint32_t)layoutInfo.descriptorSetLayoutInfos.size());
+		for (const auto& setInfo : layoutInfo.descriptorSetLayoutInfos) {
+			writeValue(blob, (uint32_t)setInfo.size());
+			for (const auto& binding : setInfo) {
+				writeValue(blob, binding.binding);
+				writeValue(blob, (uint32_t)binding.type);
+				writeValue(blob, binding.count);
+			}
+		}
+
+		writeValue(blob, (uint32_t)layoutInfo.pushConstantRanges.size());
+		for (const auto& range : layoutInfo.pushConstantRanges) {
+			writeValue(blob, (uint32_t)range.stageFlags);
+			writeValue(blob, range.offset);
+			writeValue(blob, range.size);
+		}
+
+		writeValue(blob, (uint32_t)layoutInfo.specializationConstants.size());
+		for (const auto& constant : layoutInfo.specializationConstants) {
+			writeValue(blob, constant.id);
+			writeValue(blob, (uint32_t)constant.name.size());
+			blob.insert(blob.end(), constant.name.begin(), constant.name.end());
+			alignBlob(blob);
+		}
+
+		writeValue(blob, (uint32_t)inputInfo.vertexInputs.size());
+		for (const auto& input : inputInfo.vertexInputs) {
+			writeValue(blob, input.location);
+			writeValue(blob, (uint32_t)input.format);
+			writeValue(blob, input.size);
+		}
+
+		return blob;
+	}
+
+	bool deserializeInputInfo(
+		const std::span<const char> data, ShaderInputInfo& inputInfo
+	) {
+		BlobReader reader{ .data = data };
+		ShaderLayoutInfo& layoutInfo{ inputInfo.layoutInfo };
+
+		// counts are bounded by the data left, so a corrupt count can't
+		// allocate more than the archive holds
+		auto readCount{ [&]() {
+			uint32_t count{ readValue<uint32_t>(reader) };
+			if (count > reader.data.size() - reader.offset) {
+				reader.failed = true;
+				return 0u;
+			}
+			return count;
+		} };
+
+		layoutInfo.descriptorSetLayoutInfos.resize(readCount());
+		for (auto& setInfo : layoutInfo.descriptorSetLayoutInfos) {
+			setInfo.resize(readCount());
+			for (auto& binding : setInfo) {
+				binding.binding = readValue<uint32_t>(reader);
+				binding.type = (VkDescriptorType)readValue<uint32_t>(reader);
+				binding.count = readValue<uint32_t>(reader);
+			}
+		}
+
+		layoutInfo.pushConstantRanges.resize(readCount());
+		for (auto& range : layoutInfo.pushConstantRanges) {
+			range.stageFlags = readValue<uint32_t>(reader);
+			range.offset = readValue<uint32_t>(reader);
+			range.size = readValue<uint32_t>(reader);
+		}
+
+		layoutInfo.specializationConstants.resize(readCount());
+		for (auto& constant : layoutInfo.specializationConstants) {
+			constant.id = readValue<uint32_t>(reader);
+
+			uint32_t nameSize{ readCount() };
+			if (reader.failed) {
+				break;
+			}
+			constant.name.assign(
+				reader.data.data() + reader.offset, nameSize
+			);
+			reader.offset = (reader.offset + nameSize + 3) & ~(size_t)3;
+		}
+
+		inputInfo.vertexInputs.resize(readCount());
+		for (auto& input : inputInfo.vertexInputs) {
+			input.location = readValue<uint32_t>(reader);
+			input.format = (VkFormat)readValue<uint32_t>(reader);
+			input.size = readValue<uint32_t>(reader);
+		}
+
+		return !reader.failed;
+	}
+}  // namespace
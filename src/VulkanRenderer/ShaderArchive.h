@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+#include "utils/MappedFile.h"
+
+namespace vkcore {
+	// every shader of the build in one file, written by the shader packer.
+	// spir-v is used straight from the mapping and layouts are stored
+	// flat, so nothing is reflected at runtime
+	struct ShaderArchive {
+		std::shared_ptr<const MappedFile> file;
+		// file name of the .spv the shader was packed from, to its index
+		std::unordered_map<std::string, uint32_t> entryIndices;
+	};
+
+	struct ShaderArchiveInput {
+		std::string name;
+		std::span<const char> spv;
+		VkShaderStageFlags stage;
+		ShaderInputInfo inputInfo;
+	};
+
+	bool writeShaderArchive(
+		const std::filesystem::path& path,
+		const std::span<const ShaderArchiveInput>& shaders
+	);
+
+	// file is null when the archive is missing or from another version
+	ShaderArchive openShaderArchive(const std::filesystem::path& path);
+
+	// the source info points into the archive's mapping and keeps it
+	// alive. spv is null when the archive has no shader called name
+	ShaderInfo
+		loadArchivedShader(const ShaderArchive& archive, std::string_view name);
+}  // namespace vkcore
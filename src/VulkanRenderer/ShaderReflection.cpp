@@ -0,0 +1,179 @@
+#include "RendererPCH.h"
+#include "ShaderReflection.h"
+
+#include "debug/Debug.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+#include <spirv_reflect.h>
+
+using namespace vkcore;
+
+namespace {
+	const std::unordered_map<std::string, VkShaderStageFlags>
+		extensionToShaderStageMap{
+			{ ".vert", VK_SHADER_STAGE_VERTEX_BIT },
+			{ ".tesc", VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT },
+			{ ".tese", VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT },
+			{ ".geom", VK_SHADER_STAGE_GEOMETRY_BIT },
+			{ ".frag", VK_SHADER_STAGE_FRAGMENT_BIT },
+			{ ".comp", VK_SHADER_STAGE_COMPUTE_BIT },
+		};
+}  // namespace
+
+VkShaderStageFlags vkcore::getShaderStage(const std::filesystem::path& spvPath
+) {
+	// stemed to remove .spv
+	std::string extension{ spvPath.stem().extension().string() };
+
+	auto shaderStageItt{ extensionToShaderStageMap.find(extension) };
+	if (shaderStageItt == extensionToShaderStageMap.end()) {
+		return 0;
+	}
+
+	return shaderStageItt->second;
+}
+
+ShaderInputInfo vkcore::reflectShader(const ShaderSourceInfo& shaderSrcInfo) {
+	SpvReflectResult res{};
+
+	SpvReflectShaderModule reflectModule{};
+	res = spvReflectCreateShaderModule(
+		shaderSrcInfo.spv.size(), shaderSrcInfo.spv.data(), &reflectModule
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	uint32_t inSetsCount{};
+	res = spvReflectEnumerateDescriptorSets(
+		&reflectModule, &inSetsCount, nullptr
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	std::vector<SpvReflectDescriptorSet*> sets(inSetsCount);
+	res = spvReflectEnumerateDescriptorSets(
+		&reflectModule, &inSetsCount, sets.data()
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	uint32_t pushConstantCount{};
+	res = spvReflectEnumeratePushConstantBlocks(
+		&reflectModule, &pushConstantCount, nullptr
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	std::vector<SpvReflectBlockVariable*> pushConstants(pushConstantCount);
+	res = spvReflectEnumeratePushConstantBlocks(
+		&reflectModule, &pushConstantCount, pushConstants.data()
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	uint32_t specConstantCount{};
+	res = spvReflectEnumerateSpecializationConstants(
+		&reflectModule, &specConstantCount, nullptr
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	std::vector<SpvReflectSpecializationConstant*> specConstants(
+		specConstantCount
+	);
+	res = spvReflectEnumerateSpecializationConstants(
+		&reflectModule, &specConstantCount, specConstants.data()
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	uint32_t inputCount{};
+	res = spvReflectEnumerateInputVariables(
+		&reflectModule, &inputCount, nullptr
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	std::vector<SpvReflectInterfaceVariable*> inputs(inputCount);
+	res = spvReflectEnumerateInputVariables(
+		&reflectModule, &inputCount, inputs.data()
+	);
+	assertWarning(res == SPV_REFLECT_RESULT_SUCCESS);
+
+	int nSets{ (int)sets.size() };
+
+	ShaderInputInfo inputInfo{};
+	ShaderLayoutInfo& layoutInfo{ inputInfo.layoutInfo };
+
+	// indexed by set number, sets the shader skips are left empty
+	for (const auto& set : sets) {
+		if (set->set >= layoutInfo.descriptorSetLayoutInfos.size()) {
+			layoutInfo.descriptorSetLayoutInfos.resize(set->set + 1);
+		}
+	}
+
+	for (size_t setIndex{}; setIndex < nSets; setIndex++) {
+		DescriptorSetLayoutInfo setLayout(sets[setIndex]->binding_count);
+
+		for (size_t bindingIndex{};
+			 bindingIndex < sets[setIndex]->binding_count;
+			 bindingIndex++) {
+			auto& binding{ sets[setIndex]->bindings[bindingIndex] };
+
+			setLayout[bindingIndex] = { .binding = binding->binding,
+										.type = (VkDescriptorType
+										)binding->descriptor_type,
+										.count = binding->count };
+		}
+
+		layoutInfo.descriptorSetLayoutInfos[sets[setIndex]->set] =
+			std::move(setLayout);
+	}
+
+	layoutInfo.pushConstantRanges.reserve(pushConstantCount);
+	for (const auto& pushConstant : pushConstants) {
+		VkPushConstantRange range{
+			.stageFlags = shaderSrcInfo.stage,
+			.offset = pushConstant->offset,
+			.size = pushConstant->size,
+		};
+
+		layoutInfo.pushConstantRanges.emplace_back(range);
+	}
+
+	layoutInfo.specializationConstants.reserve(specConstantCount);
+	for (const auto& specConstant : specConstants) {
+		layoutInfo.specializationConstants.emplace_back(
+			SpecializationConstantInfo{
+				.id = specConstant->constant_id,
+				.name = specConstant->name ? specConstant->name : "",
+			}
+		);
+	}
+
+	if (shaderSrcInfo.stage == VK_SHADER_STAGE_VERTEX_BIT) {
+		for (const auto& input : inputs) {
+			if (input->decoration_flags &
+				SPV_REFLECT_DECORATION_BUILT_IN) {
+				continue;
+			}
+
+			uint32_t componentCount{
+				std::max(input->numeric.vector.component_count, 1u)
+			};
+
+			inputInfo.vertexInputs.emplace_back(VertexInputInfo{
+				.location = input->location,
+				.format = (VkFormat)input->format,
+				.size = input->numeric.scalar.width / 8 * componentCount,
+			});
+		}
+
+		std::sort(
+			inputInfo.vertexInputs.begin(),
+			inputInfo.vertexInputs.end(),
+			[](const VertexInputInfo& a, const VertexInputInfo& b) {
+				return a.location < b.location;
+			}
+		);
+	}
+
+	spvReflectDestroyShaderModule(&reflectModule);
+
+	return inputInfo;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <filesystem>
+
+#include "Shader.h"
+
+// reflection is kept apart from the rest of Shader.h, the shader packer
+// reflects at build time with it
+namespace vkcore {
+	// from the extension before .spv, 0 when it isn't a shader stage
+	VkShaderStageFlags getShaderStage(const std::filesystem::path& spvPath);
+
+	ShaderInputInfo reflectShader(const ShaderSourceInfo& shaderSrcInfo);
+}  // namespace vkcore
@@ -0,0 +1,274 @@
+#include "RendererPCH.h"
+
+#include "ShaderReloader.h"
+
+#include "Cleanup.h"
+#include "Context.h"
+#include "Shader.h"
+#include "debug/Debug.h"
+#include "utils/CpuProfiler.h"
+#include "utils/FileWatcher.h"
+#include "vkcore/ObjectRegistry.h"
+
+#include <array>
+#include <cstdlib>
+#include <string>
+
+using namespace vkcore;
+
+namespace {
+	// compiled shaders go here rather than over the build's output
+	const std::filesystem::path RELOAD_DIRECTORY{ "shaders/reload" };
+
+	constexpr std::chrono::milliseconds WATCH_INTERVAL{ 100 };
+
+	// not tracked per pipeline, a change rebuilds every pipeline
+	const std::filesystem::path INCLUDE_EXTENSION{ ".glsl" };
+
+	bool compileShader(
+		const std::filesystem::path& glslcPath,
+		const std::string& glslcFlags,
+		const std::filesystem::path& source,
+		const std::filesystem::path& spv
+	);
+
+	bool isLayoutCompatible(
+		const ShaderLayoutInfo& layoutInfo, const ShaderLayoutInfo& expected
+	);
+}  // namespace
+
+VulkanRenderer::ShaderReloader::ShaderReloader(
+	const VulkanContext& ctx,
+	vkcore::ObjectRegistry& registry,
+	const VkPipelineCache pipelineCache,
+	const std::filesystem::path& sourceDirectory,
+	const std::filesystem::path& glslcPath,
+	const std::string& glslcFlags,
+	std::vector<ReloadableComputePipeline> pipelines
+) :
+	m_Ctx(ctx),
+	m_Registry(registry),
+	m_PipelineCache(pipelineCache),
+	m_SourceDirectory(sourceDirectory),
+	m_GlslcPath(glslcPath),
+	m_GlslcFlags(glslcFlags),
+	m_Pipelines(std::move(pipelines)) {
+	m_Thread = std::thread(&ShaderReloader::watchLoop, this);
+}
+
+VulkanRenderer::ShaderReloader::~ShaderReloader() {
+	m_Stopping = true;
+	m_Thread.join();
+
+	// built after the last applyReloads, never used
+	for (const auto& reloaded : m_Reloaded) {
+		releasePipeline(m_Ctx, m_Registry, reloaded.pipeline);
+	}
+}
+
+void VulkanRenderer::ShaderReloader::applyReloads(
+	DeferredDeletionQueue& deletionQueue, const uint64_t retireValue
+) {
+	std::vector<ReloadedPipeline> reloaded;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		reloaded.swap(m_Reloaded);
+	}
+
+	for (const auto& pipeline : reloaded) {
+		const ReloadableComputePipeline& target{ m_Pipelines[pipeline.index] };
+
+		VkPipeline oldPipeline{ *target.pipeline };
+		*target.pipeline = pipeline.pipeline;
+
+		// may run after the reloader is gone
+		deletionQueue.pushFunction(
+			retireValue,
+			[oldPipeline, &ctx = m_Ctx, &registry = m_Registry]() {
+				releasePipeline(ctx, registry, oldPipeline);
+			}
+		);
+
+		logInfo("reloaded ", target.source);
+	}
+}
+
+void VulkanRenderer::ShaderReloader::watchLoop() {
+	CpuProfiler::setThreadName("shader reloader");
+
+	FileWatcher watcher{ m_SourceDirectory };
+	if (!watcher.isValid()) {
+		return;
+	}
+
+	std::error_code error{};
+	std::filesystem::create_directories(RELOAD_DIRECTORY, error);
+
+	// the layouts the pipelines were created with
+	std::vector<ShaderLayoutInfo> layoutInfos;
+	{
+		std::vector<std::filesystem::path> spvPaths;
+		for (const auto& target : m_Pipelines) {
+			spvPaths.emplace_back(target.spv);
+		}
+
+		for (auto& shader : parseShaders(spvPaths)) {
+			layoutInfos.emplace_back(std::move(shader.inputInfo.layoutInfo));
+		}
+	}
+
+	while (!m_Stopping) {
+		std::vector<std::filesystem::path> changed{
+			watcher.waitForChanges(WATCH_INTERVAL)
+		};
+
+		// each pipeline is rebuilt once, however many of its files changed
+		std::vector<bool> stale(m_Pipelines.size());
+		for (const auto& path : changed) {
+			const std::string source{ path.filename().string() };
+			const bool isInclude{ path.extension() == INCLUDE_EXTENSION };
+
+			for (uint32_t i{}; i < m_Pipelines.size(); i++) {
+				if (isInclude || m_Pipelines[i].source == source) {
+					stale[i] = true;
+				}
+			}
+		}
+
+		for (uint32_t i{}; i < m_Pipelines.size(); i++) {
+			if (!stale[i]) {
+				continue;
+			}
+
+			VkPipeline pipeline{
+				rebuildPipeline(m_Pipelines[i], layoutInfos[i])
+			};
+			if (pipeline == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Reloaded.emplace_back(
+				ReloadedPipeline{ .index = i, .pipeline = pipeline }
+			);
+		}
+	}
+}
+
+VkPipeline VulkanRenderer::ShaderReloader::rebuildPipeline(
+	const ReloadableComputePipeline& target,
+	const ShaderLayoutInfo& layoutInfo
+) {
+	CPU_ZONE("rebuildPipeline");
+
+	std::filesystem::path spvPath{ RELOAD_DIRECTORY / target.spv.filename() };
+	if (!compileShader(
+			m_GlslcPath,
+			m_GlslcFlags,
+			m_SourceDirectory / target.source,
+			spvPath
+		)) {
+		logWarning(
+			"could not compile ", target.source, ", keeping the old pipeline"
+		);
+		return VK_NULL_HANDLE;
+	}
+
+	std::array<std::filesystem::path, 1> spvPaths{ spvPath };
+	ShaderInfo shader{ parseShaders(spvPaths)[0] };
+	if (!shader.sourceInfo.spv.data()) {
+		return VK_NULL_HANDLE;
+	}
+
+	if (!isLayoutCompatible(shader.inputInfo.layoutInfo, layoutInfo)) {
+		logWarning(
+			target.source, " changed its resource layout, restart to apply it"
+		);
+		return VK_NULL_HANDLE;
+	}
+
+	// the module is only needed while the pipeline is created
+	DeletionQueue moduleDeletionQueue;
+	VkPipelineShaderStageCreateInfo shaderStageInfo{ createShaderStages(
+		m_Ctx,
+		m_Registry,
+		std::array{ shader.sourceInfo },
+		nullptr,
+		moduleDeletionQueue
+	)[0] };
+
+	VkPipeline pipeline{ acquireComputePipeline(
+		m_Ctx,
+		m_Registry,
+		shaderStageInfo,
+		target.layout,
+		target.specializationConstants,
+		m_PipelineCache
+	) };
+	moduleDeletionQueue.flush();
+
+	return pipeline;
+}
+
+namespace {
+	bool compileShader(
+		const std::filesystem::path& glslcPath,
+		const std::string& glslcFlags,
+		const std::filesystem::path& source,
+		const std::filesystem::path& spv
+	) {
+		std::string command{ "\"" + glslcPath.string() + "\" " + glslcFlags +
+							 " \"" + source.string() + "\" -o \"" +
+							 spv.string() + "\"" };
+#ifdef _WIN32
+		// cmd strips the outer quotes of the whole command line
+		command = "\"" + command + "\"";
+#endif
+
+		return std::system(command.c_str()) == 0;
+	}
+
+	bool isLayoutCompatible(
+		const ShaderLayoutInfo& layoutInfo, const ShaderLayoutInfo& expected
+	) {
+		const auto& sets{ layoutInfo.descriptorSetLayoutInfos };
+		const auto& expectedSets{ expected.descriptorSetLayoutInfos };
+		if (sets.size() != expectedSets.size()) {
+			return false;
+		}
+
+		for (size_t i{}; i < sets.size(); i++) {
+			if (sets[i].size() != expectedSets[i].size()) {
+				return false;
+			}
+
+			for (size_t j{}; j < sets[i].size(); j++) {
+				const DescriptorBindingInfo& binding{ sets[i][j] };
+				const DescriptorBindingInfo& expectedBinding{
+					expectedSets[i][j]
+				};
+
+				if (binding.binding != expectedBinding.binding ||
+					binding.type != expectedBinding.type ||
+					binding.count != expectedBinding.count) {
+					return false;
+				}
+			}
+		}
+
+		const auto& ranges{ layoutInfo.pushConstantRanges };
+		const auto& expectedRanges{ expected.pushConstantRanges };
+		if (ranges.size() != expectedRanges.size()) {
+			return false;
+		}
+
+		for (size_t i{}; i < ranges.size(); i++) {
+			if (ranges[i].offset != expectedRanges[i].offset ||
+				ranges[i].size != expectedRanges[i].size) {
+				return false;
+			}
+		}
+
+		return true;
+	}
+}  // namespace
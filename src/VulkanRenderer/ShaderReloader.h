@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vkcore/ShaderLayout.h"
+
+// forward declerations
+struct VulkanContext;
+class DeferredDeletionQueue;
+
+namespace VulkanRenderer {
+	// a compute pipeline rebuilt whenever its glsl source or any included
+	// .glsl file changes. the reloaded shader must keep the descriptor and
+	// push constant layout of spv, layout changes need a restart
+	struct ReloadableComputePipeline {
+		// file name inside the shader source directory, "second.comp"
+		std::string source;
+		std::filesystem::path spv;
+
+		VkPipelineLayout layout;
+		std::vector<vkcore::SpecializationConstant> specializationConstants;
+		// written by applyReloads. pipelines come from the object registry,
+		// the owner releases the last one
+		VkPipeline* pipeline;
+	};
+
+	// watches the shader sources and compiles and builds changed pipelines
+	// on a background thread. the render loop only ever picks up finished
+	// pipelines
+	class ShaderReloader {
+	   public:
+		// glslcFlags are the ones the build compiles its shaders with
+		ShaderReloader(
+			const VulkanContext& ctx,
+			vkcore::ObjectRegistry& registry,
+			const VkPipelineCache pipelineCache,
+			const std::filesystem::path& sourceDirectory,
+			const std::filesystem::path& glslcPath,
+			const std::string& glslcFlags,
+			std::vector<ReloadableComputePipeline> pipelines
+		);
+		~ShaderReloader();
+
+		ShaderReloader(const ShaderReloader&) = delete;
+		ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+		// swaps in every pipeline finished since the last call. replaced
+		// pipelines are released once the timeline reaches retireValue
+		void applyReloads(
+			DeferredDeletionQueue& deletionQueue, const uint64_t retireValue
+		);
+
+	   private:
+		struct ReloadedPipeline {
+			uint32_t index;
+			VkPipeline pipeline;
+		};
+
+		void watchLoop();
+		VkPipeline rebuildPipeline(
+			const ReloadableComputePipeline& target,
+			const vkcore::ShaderLayoutInfo& layoutInfo
+		);
+
+		const VulkanContext& m_Ctx;
+		vkcore::ObjectRegistry& m_Registry;
+		VkPipelineCache m_PipelineCache;
+		std::filesystem::path m_SourceDirectory;
+		std::filesystem::path m_GlslcPath;
+		std::string m_GlslcFlags;
+		std::vector<ReloadableComputePipeline> m_Pipelines;
+
+		std::mutex m_Mutex;
+		std::vector<ReloadedPipeline> m_Reloaded;
+
+		std::atomic<bool> m_Stopping{};
+		std::thread m_Thread;
+	};
+}  // namespace VulkanRenderer
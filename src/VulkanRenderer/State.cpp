@@ -1,82 +1,194 @@
 #include "RendererPCH.h"
 #include "State.h"
 
+#include "AsyncUploader.h"
 #include "Context.h"
+#include "vkutils/Barriers.h"
+#include "vkutils/Commands.h"
 #include "vkutils/Synchronization.h"
 #include "DefaultCreateInfos.h"
+#include "vkcore/BindlessHeap.h"
+#include "vkcore/ObjectRegistry.h"
 #include "vkcore/ShaderLayout.h"
 #include "Pipelines.h"
+#include "PipelineCache.h"
 #include "Shader.h"
+#include "ShaderArchive.h"
+#include "UploadRing.h"
+#include "WorkgroupTuner.h"
 
 #include "debug/Debug.h"
+#include "utils/CpuProfiler.h"
 #include "utils/FileIO.h"
+#include "utils/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
 
 using namespace vkcore;
 
+namespace {
+	// default cap on recording threads, more rarely pays off for the number
+	// of passes we have
+	constexpr uint32_t DEFAULT_MAX_RECORD_THREADS{ 4 };
+
+	// what a frame's transient sets are expected to hold, the pools grow
+	// from FRAME_DESCRIPTOR_SETS when a frame needs more
+	constexpr std::array<DescriptorPoolRatio, 5> FRAME_DESCRIPTOR_RATIOS{ {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.f },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.f },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.f },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.f },
+	} };
+	constexpr uint32_t FRAME_DESCRIPTOR_SETS{ 64 };
+
+	// per frame constants, instance data and simulation parameters
+	constexpr VkDeviceSize UPLOAD_RING_FRAME_SIZE{ 8 * 1024 * 1024 };
+
+	// written by the build next to the loose .spv files, which are only
+	// read for shaders the archive is missing
+	const std::filesystem::path SHADER_ARCHIVE_PATH{ "shaders/shaders.pack" };
+
+	// a checkerboard until meshes sample streamed textures
+	constexpr uint32_t MESH_TEXTURE_SIZE{ 64 };
+	constexpr uint32_t MESH_TEXTURE_CELL_SIZE{ 8 };
+
+	// two triangles in clip space, covering the middle of the draw image
+	const std::array<VulkanRenderer::MeshVertex, 6> MESH_VERTICES{ {
+		{ { -0.5f, -0.5f, 0.f }, { 0.f, 0.f } },
+		{ { 0.5f, -0.5f, 0.f }, { 1.f, 0.f } },
+		{ { 0.5f, 0.5f, 0.f }, { 1.f, 1.f } },
+		{ { -0.5f, -0.5f, 0.f }, { 0.f, 0.f } },
+		{ { 0.5f, 0.5f, 0.f }, { 1.f, 1.f } },
+		{ { -0.5f, 0.5f, 0.f }, { 0.f, 1.f } },
+	} };
+
+	std::vector<uint8_t> createCheckerTexels(
+		const uint32_t size, const uint32_t cellSize
+	);
+
+	VkPresentModeKHR getVkPresentMode(
+		const VulkanRenderer::PresentMode presentMode
+	);
+
+}  // namespace
+
 VulkanRenderer::VulkanState VulkanRenderer::createVulkanState(
-	const VulkanContext& ctx, SDL_Window* window, DeletionQueue& deletionQueue
+	const VulkanContext& ctx,
+	SDL_Window* window,
+	const RendererSettings& settings,
+	DeletionQueue& deletionQueue
 ) {
-	constexpr int MAX_FRAMES_IN_FLIGHT{ VulkanState::MAX_FRAMES_IN_FLIGHT };
+	CPU_ZONE("createVulkanState");
+
+	const uint32_t framesInFlight{ settings.framesInFlight };
+	assertFatal(framesInFlight > 0, "at least one frame must be in flight");
+
+	const VkPresentModeKHR presentMode{
+		getVkPresentMode(settings.presentMode)
+	};
+
+	// pushed first so it's destroyed after every release of its objects
+	auto objectRegistry{ std::make_unique<ObjectRegistry>() };
+	deletionQueue.pushFunction([=, registry = objectRegistry.get()]() {
+		destroyObjectRegistry(ctx, *registry);
+	});
 
 	DeletionQueue swapchainDeletionQueue;
-	Deletable<Swapchain> swapchain{ createSwapchain(ctx, window) };
-	swapchainDeletionQueue.pushFunction(std::move(swapchain.deleter));
+	Deletable<Swapchain> swapchain{};
+	VkExtent2D renderExtent{ .width = settings.renderWidth,
+							 .height = settings.renderHeight };
+	if (!settings.headless) {
+		swapchain =
+			createSwapchain(ctx, window, presentMode, framesInFlight);
+		swapchainDeletionQueue.pushFunction(std::move(swapchain.deleter));
+
+		renderExtent = swapchain.obj.extent;
+	}
 
 	Queues queues{ getDeviceQueues(ctx.device) };
 
-	VkCommandPool frameCommandPool{};
+	RenderGraphQueues renderQueues{};
 	{
-		VkCommandPoolCreateInfo poolCreateInfo{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-			.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
-			.queueFamilyIndex = ctx.device.queueFamilyIndices.graphicsIndex,
-		};
+		const QueueFamilyIndices& familyIndices{ ctx.device.queueFamilyIndices };
 
-		if (vkCreateCommandPool(
-				ctx.device.logical, &poolCreateInfo, nullptr, &frameCommandPool
-			) != VK_SUCCESS) {
-			logFatal("could not create command pool");
-		}
+		renderQueues[(size_t)RenderGraphQueue::graphics] = {
+			.queue = queues.graphicsQueue,
+			.familyIndex = familyIndices.graphicsIndex,
+			.timeline = vkutils::createTimelineSemaphore(ctx, 0),
+		};
+		renderQueues[(size_t)RenderGraphQueue::compute] = {
+			.queue = queues.computeQueue,
+			.familyIndex = familyIndices.computeIndex,
+			.timeline = vkutils::createTimelineSemaphore(ctx, 0),
+		};
 
 		deletionQueue.pushFunction([=]() {
-			vkDestroyCommandPool(ctx.device.logical, frameCommandPool, nullptr);
+			for (const auto& renderQueue : renderQueues) {
+				vkDestroySemaphore(
+					ctx.device.logical, renderQueue.timeline, nullptr
+				);
+			}
 		});
 	}
 
-	std::array<PerFrameVulkanState, MAX_FRAMES_IN_FLIGHT> frames;
+	GpuProfiler gpuProfiler{};
 	{
-		std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT> cmdBuffers;
-
-		VkCommandBufferAllocateInfo cmdBuffAllocInfo{
-			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-			.commandPool = frameCommandPool,
-			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-			.commandBufferCount = MAX_FRAMES_IN_FLIGHT,
+		constexpr std::array<const char*, RENDER_GRAPH_QUEUE_COUNT> queueNames{
+			"graphics", "compute"
 		};
 
-		if (vkAllocateCommandBuffers(
-				ctx.device.logical, &cmdBuffAllocInfo, cmdBuffers.data()
-			) != VK_SUCCESS) {
-			logFatal("could not allocate command buffers");
+		std::vector<GpuProfilerQueue> profilerQueues;
+		for (size_t i{}; i < RENDER_GRAPH_QUEUE_COUNT; i++) {
+			profilerQueues.emplace_back(GpuProfilerQueue{
+				.name = queueNames[i],
+				.familyIndex = renderQueues[i].familyIndex,
+			});
 		}
 
-		for (int i{}; i < MAX_FRAMES_IN_FLIGHT; i++) {
+		gpuProfiler = createGpuProfiler(
+			ctx, framesInFlight, profilerQueues, deletionQueue
+		);
+	}
+
+	VkSemaphore frameTimeline{ vkutils::createTimelineSemaphore(ctx, 0) };
+	deletionQueue.pushFunction([=]() {
+		vkDestroySemaphore(ctx.device.logical, frameTimeline, nullptr);
+	});
+
+	// the thread calling renderFrame records too
+	uint32_t recordThreads{ settings.recordThreads };
+	if (recordThreads == 0) {
+		recordThreads = std::clamp(
+			std::thread::hardware_concurrency(), 1u, DEFAULT_MAX_RECORD_THREADS
+		);
+	}
+	auto recordThreadPool{ std::make_unique<ThreadPool>(recordThreads - 1) };
+
+	std::vector<PerFrameVulkanState> frames(framesInFlight);
+	{
+		for (uint32_t i{}; i < framesInFlight; i++) {
 			PerFrameVulkanState& frame{ frames[i] };
-			frame.commandBuffer = cmdBuffers[i];
-			frame.fenceRenderFinished =
-				vkutils::createFence(ctx, VK_FENCE_CREATE_SIGNALED_BIT);
 
+			frame.commandPools.resize(recordThreads);
+			for (auto& threadPools : frame.commandPools) {
+				for (size_t j{}; j < RENDER_GRAPH_QUEUE_COUNT; j++) {
+					threadPools[j] = vkutils::createCommandBufferPool(
+						ctx, renderQueues[j].familyIndex, deletionQueue
+					);
+				}
+			}
+			frame.descriptorAllocator = createDescriptorAllocator(
+				ctx, FRAME_DESCRIPTOR_RATIOS, FRAME_DESCRIPTOR_SETS
+			);
 			frame.semRenderFinished = vkutils::createSemaphore(ctx);
 			frame.semFrameAvaliable = vkutils::createSemaphore(ctx);
 		}
 
 		deletionQueue.pushFunction([=]() {
-			for (int i{}; i < MAX_FRAMES_IN_FLIGHT; i++) {
-				const PerFrameVulkanState& frame{ frames[i] };
-				vkDestroyFence(
-					ctx.device.logical, frame.fenceRenderFinished, nullptr
-				);
-
+			for (const auto& frame : frames) {
 				vkDestroySemaphore(
 					ctx.device.logical, frame.semFrameAvaliable, nullptr
 				);
@@ -87,77 +199,47 @@ VulkanRenderer::VulkanState VulkanRenderer::createVulkanState(
 		});
 	}
 
+	UploadRing uploadRing{ createUploadRing(
+		ctx, UPLOAD_RING_FRAME_SIZE, framesInFlight, deletionQueue
+	) };
+
+	AsyncUploader uploader{
+		createAsyncUploader(ctx, queues.transferQueue, queues.graphicsQueue)
+	};
+
+	DeletionQueue drawImageDeletionQueue;
 	Image drawImage{
-		createDrawImage(ctx, swapchain.obj, swapchainDeletionQueue)
+		createDrawImage(ctx, renderExtent, drawImageDeletionQueue)
 	};
 
-	UniqueShaderObjects uniqueGradientShaderInfo{};
-	SharedShaderObjects sharedGradientShaderInfo{};
+	ShaderArchive shaderArchive{ openShaderArchive(SHADER_ARCHIVE_PATH) };
+	if (!shaderArchive.file) {
+		logWarning("no shader archive, reflecting shaders at runtime");
+	}
+
+	BindlessHeap bindlessHeap{ createBindlessHeap(ctx, deletionQueue) };
+	uint32_t drawImageIndex{
+		registerStorageImage(ctx, bindlessHeap, drawImage.view)
+	};
+
+	ShaderInfo gradientShaderInfo{};
+	ShaderLayout gradientShaderLayout{};
 	{
 		std::array<std::filesystem::path, 1> shaderPaths{
 			"shaders/second.comp.spv"
 		};
-		ShaderInfo gradientShaderInfo = parseShaders(shaderPaths)[0];
+		gradientShaderInfo = parseShaders(
+			shaderPaths, recordThreadPool.get(), &shaderArchive
+		)[0];
 
-		sharedGradientShaderInfo = vkcore::createSharedShaderObjects(
+		gradientShaderLayout = createBindlessShaderLayout(
 			ctx,
+			*objectRegistry,
+			bindlessHeap,
 			gradientShaderInfo.inputInfo,
 			gradientShaderInfo.sourceInfo.stage,
 			deletionQueue
 		);
-		uniqueGradientShaderInfo = vkcore::createUniqueShaderObjects(
-			ctx, gradientShaderInfo.sourceInfo, sharedGradientShaderInfo
-		);
-	}
-
-	{
-		VkDescriptorImageInfo imageInfo{
-			.imageView = drawImage.view,
-			.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
-		};
-
-		VkWriteDescriptorSet writeDescriptorSet{
-			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-			.dstSet = uniqueGradientShaderInfo.descriptorSets[0],
-			.dstBinding = 0,
-			.descriptorCount = 1,
-			.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
-			.pImageInfo = &imageInfo,
-		};
-
-		vkUpdateDescriptorSets(
-			ctx.device.logical, 1, &writeDescriptorSet, 0, nullptr
-		);
-	}
-
-	VkPipelineLayout gradientPipelineLayout{};
-	VkPipeline gradientPipeline{};
-	{
-		gradientPipelineLayout = createPipelineLayout(
-			ctx, sharedGradientShaderInfo.layout, deletionQueue
-		);
-
-		VkPipelineShaderStageCreateInfo shaderStageInfo{ createShaderStages(
-			ctx,
-			std::array{ uniqueGradientShaderInfo.sourceInfo },
-			deletionQueue
-		)[0] };
-
-		VkComputePipelineCreateInfo pipeInfo{
-			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-			.stage = shaderStageInfo,
-			.layout = gradientPipelineLayout,
-		};
-
-		if (vkCreateComputePipelines(
-				ctx.device.logical, 0, 1, &pipeInfo, nullptr, &gradientPipeline
-			) != VK_SUCCESS) {
-			logWarning("could not create compute pipelines");
-		}
-
-		deletionQueue.pushFunction([=]() {
-			vkDestroyPipeline(ctx.device.logical, gradientPipeline, nullptr);
-		});
 	}
 
 	VkCommandPool immediateCommandPool{};
@@ -201,51 +283,399 @@ VulkanRenderer::VulkanState VulkanRenderer::createVulkanState(
 		}
 	}
 
-	VkGraphicsPipelineCreateInfo pipeInfo{};
+	PipelineCache pipelineCache{
+		createPipelineCache(ctx, settings.pipelineCachePath, deletionQueue)
+	};
+	auto pipelineStartTime{ std::chrono::high_resolution_clock::now() };
+	std::chrono::high_resolution_clock::duration tuneDuration{};
+
+	VkPipelineLayout gradientPipelineLayout{};
+	WorkgroupSize gradientWorkgroupSize{};
+	VkPipeline gradientPipeline{};
+	{
+		gradientPipelineLayout = createPipelineLayout(
+			ctx, *objectRegistry, gradientShaderLayout, deletionQueue
+		);
+
+		// pipelines don't need their modules once created
+		DeletionQueue moduleDeletionQueue;
+		VkPipelineShaderStageCreateInfo shaderStageInfo{ createShaderStages(
+			ctx,
+			*objectRegistry,
+			std::array{ gradientShaderInfo.sourceInfo },
+			recordThreadPool.get(),
+			moduleDeletionQueue
+		)[0] };
+
+		// frames dispatch the gradient on the compute queue
+		WorkgroupTunerSettings tunerSettings{
+			.pipelineCache = pipelineCache.handle,
+			.queue = queues.computeQueue,
+			.queueFamilyIndex = ctx.device.queueFamilyIndices.computeIndex,
+			.cachePath = settings.workgroupCachePath,
+			.retune = settings.retuneWorkgroups,
+		};
+
+		// benchmarked on the draw image at the render size, frames only
+		// ever clear it so the contents don't matter
+		WorkgroupTuneInfo tuneInfo{
+			.kernel = "gradient",
+			.spv = gradientShaderInfo.sourceInfo.spv,
+			.stage = shaderStageInfo,
+			.layout = gradientPipelineLayout,
+			.prepare =
+				[&](VkCommandBuffer cmdBuffer) {
+					vkutils::ImageStateTracker tracker{};
+					vkutils::trackImage(
+						tracker, drawImage.handle, VK_IMAGE_ASPECT_COLOR_BIT, {}
+					);
+					vkutils::requestImageAccess(
+						tracker,
+						drawImage.handle,
+						VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+						VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+						VK_IMAGE_LAYOUT_GENERAL,
+						true
+					);
+					vkutils::cmdFlushBarriers(tracker, cmdBuffer);
+				},
+			.record =
+				[&](VkCommandBuffer cmdBuffer, const WorkgroupSize size) {
+					cmdBindBindlessHeap(
+						cmdBuffer,
+						bindlessHeap,
+						VK_PIPELINE_BIND_POINT_COMPUTE,
+						gradientPipelineLayout
+					);
+
+					GradientPushConstants constants{ .screen = drawImageIndex };
+					vkCmdPushConstants(
+						cmdBuffer,
+						gradientPipelineLayout,
+						VK_SHADER_STAGE_COMPUTE_BIT,
+						0,
+						sizeof(constants),
+						&constants
+					);
+
+					vkCmdDispatch(
+						cmdBuffer,
+						getGroupCount(renderExtent.width, size.x),
+						getGroupCount(renderExtent.height, size.y),
+						1
+					);
+				},
+		};
+
+		auto tuneStartTime{ std::chrono::high_resolution_clock::now() };
+		WorkgroupTuneResult tuned{
+			tuneWorkgroupSize(ctx, *objectRegistry, tunerSettings, tuneInfo)
+		};
+		tuneDuration =
+			std::chrono::high_resolution_clock::now() - tuneStartTime;
+		gradientWorkgroupSize = tuned.size;
+		gradientPipeline = tuned.pipeline;
+		moduleDeletionQueue.flush();
+	}
+
+	VkPipelineLayout meshPipelineLayout{};
+	VkPipeline meshPipeline{};
+	VkDescriptorSetLayout meshSetLayout{};
+	DescriptorSetLayoutInfo meshSetLayoutInfo{};
 	{
-		DeletionQueue pipeTempDeletionQueue;
 		std::array<std::filesystem::path, 2> shaderPaths{
 			"shaders/first.vert.spv", "shaders/first.frag.spv"
 		};
 
-		std::vector<ShaderInfo> shaders{ parseShaders(shaderPaths) };
+		std::vector<ShaderInfo> shaders{
+			parseShaders(shaderPaths, recordThreadPool.get(), &shaderArchive)
+		};
+
+		// one layout for every stage, bindings are visible to all of them
+		ShaderInputInfo meshInputInfo{ mergeShaderInputInfos(shaders) };
 
+		ShaderLayout meshShaderLayout{ createShaderLayout(
+			ctx,
+			*objectRegistry,
+			meshInputInfo,
+			getShaderStages(shaders),
+			deletionQueue
+		) };
+
+		meshPipelineLayout = createPipelineLayout(
+			ctx, *objectRegistry, meshShaderLayout, deletionQueue
+		);
+		// the ubo and the texture, allocated every frame
+		meshSetLayout = meshShaderLayout.shaderDescriptorLayout[0];
+		meshSetLayoutInfo =
+			meshInputInfo.layoutInfo.descriptorSetLayoutInfos[0];
+
+		std::vector<ShaderSourceInfo> sourceInfos;
 		for (const auto& shader : shaders) {
-			SharedShaderObjects sharedShaderObjects{ createSharedShaderObjects(
-				ctx, shader.inputInfo, shader.sourceInfo.stage, deletionQueue
-			) };
+			sourceInfos.emplace_back(shader.sourceInfo);
+		}
+
+		DeletionQueue moduleDeletionQueue;
+		GraphicsPipelineDesc meshPipelineDesc{
+			.stages = createShaderStages(
+				ctx,
+				*objectRegistry,
+				sourceInfos,
+				recordThreadPool.get(),
+				moduleDeletionQueue
+			),
+			.layout = meshPipelineLayout,
+			.vertexInputs = meshInputInfo.vertexInputs,
+			.colorFormats = { drawImage.format },
 		};
 
-		VkPipelineShaderStageCreateInfo shaderStages{
-			.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		// shared through the registry, the deletion queue releases it
+		meshPipeline = createGraphicsPipelines(
+			ctx,
+			*objectRegistry,
+			std::array{ meshPipelineDesc },
+			pipelineCache.handle,
+			deletionQueue
+		)[0];
+		moduleDeletionQueue.flush();
+	}
 
+	{
+		// the tuner benchmarks its candidates on the gpu, that isn't
+		// pipeline creation
+		auto pipelineEndTime{ std::chrono::high_resolution_clock::now() };
+		float duration{
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				pipelineEndTime - pipelineStartTime - tuneDuration
+			)
+				.count()
+		};
+		float tuneMs{
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				tuneDuration
+			)
+				.count()
 		};
-		pipeInfo = { .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+		std::cout << "pipelines: " << duration << "ms | "
+				  << (pipelineCache.warm ? "warm" : "cold")
+				  << " pipeline cache | workgroup tuning: " << tuneMs << "ms"
+				  << std::endl;
+	}
+
+	Buffer meshVertices{};
+	Image meshTexture{};
+	VkSampler meshSampler{};
+	{
+		meshVertices = createBuffer(
+			ctx,
+			sizeof(MESH_VERTICES),
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			BufferMemory::gpuOnly,
+			MemoryCategory::other
+		);
+
+		const VkExtent3D textureExtent{ .width = MESH_TEXTURE_SIZE,
+										.height = MESH_TEXTURE_SIZE,
+										.depth = 1 };
+		meshTexture = createImage(
+			ctx,
+			textureExtent,
+			VK_FORMAT_R8G8B8A8_SRGB,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			MemoryCategory::textures
+		);
+
+		std::vector<uint8_t> texels{
+			createCheckerTexels(MESH_TEXTURE_SIZE, MESH_TEXTURE_CELL_SIZE)
+		};
+
+		enqueueBufferUpload(
+			ctx,
+			uploader,
+			meshVertices.handle,
+			0,
+			{ (const char*)MESH_VERTICES.data(), sizeof(MESH_VERTICES) }
+		);
+		UploadTicket ticket{ enqueueImageUpload(
+			ctx,
+			uploader,
+			{ .image = meshTexture.handle,
+			  .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+			  .extent = textureExtent,
+			  .data = { (const char*)texels.data(), texels.size() },
+			  .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+		) };
+		waitForUpload(ctx, uploader, ticket);
+
+		VkSamplerCreateInfo samplerCreateInfo{
+			.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+			.magFilter = VK_FILTER_NEAREST,
+			.minFilter = VK_FILTER_NEAREST,
+			.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+			.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		};
+		if (vkCreateSampler(
+				ctx.device.logical, &samplerCreateInfo, nullptr, &meshSampler
+			) != VK_SUCCESS) {
+			logFatal("could not create mesh sampler");
+		}
+
+		deletionQueue.pushFunction([=]() {
+			vkDestroySampler(ctx.device.logical, meshSampler, nullptr);
+			destroyImage(ctx, meshTexture);
+			destroyBuffer(ctx, meshVertices);
+		});
 	}
 
 	VulkanState state{
 		.swapchainDeletionQueue = swapchainDeletionQueue,
 		.swapchain = swapchain.obj,
+		.presentMode = presentMode,
+
+		.drawImageDeletionQueue = drawImageDeletionQueue,
 		.drawImage = drawImage,
+		.renderExtent = renderExtent,
 
 		.graphicsQueue = queues.graphicsQueue,
 		.presentationQueue = queues.presentationQueue,
 		.transferQueue = queues.transferQueue,
+		.computeQueue = queues.computeQueue,
+		.renderQueues = renderQueues,
 
 		.immediateCommandPool = immediateCommandPool,
 		.immediateCommandBuffer = immediateCommandBuffer,
 		.immediateFence = immediateFence,
 
-		.frameCommandPool = frameCommandPool,
 		.frames = std::move(frames),
+		.recordThreadPool = std::move(recordThreadPool),
+		.uploadRing = uploadRing,
+		.uploader = std::move(uploader),
+
+		.bindlessHeap = bindlessHeap,
+		.drawImageIndex = drawImageIndex,
 
-		.mainDescriptorPool = sharedGradientShaderInfo.descriptorPool,
-		.imageDescriptoreSetLayout =
-			sharedGradientShaderInfo.layout.shaderDescriptorLayout[0],
-		.imageDescriptorSet = uniqueGradientShaderInfo.descriptorSets[0],
+		.frameTimeline = frameTimeline,
+
+		.gpuProfiler = std::move(gpuProfiler),
+		.memoryBudget = createMemoryBudget(ctx),
+		.defragmenter = createDefragmenter(
+			ctx,
+			ctx.device.queueFamilyIndices.graphicsIndex,
+			settings.defragmentBytesPerFrame
+		),
+
+		.pipelineCache = pipelineCache,
+		.objectRegistry = std::move(objectRegistry),
 
 		.gradientPipeline = gradientPipeline,
-		.gradientPipeLayout = gradientPipelineLayout
+		.gradientPipeLayout = gradientPipelineLayout,
+		.gradientWorkgroupSize = gradientWorkgroupSize,
+
+		.meshPipeline = meshPipeline,
+		.meshPipeLayout = meshPipelineLayout,
+		.meshSetLayout = meshSetLayout,
+		.meshSetLayoutInfo = meshSetLayoutInfo,
+		.meshVertices = meshVertices,
+		.meshVertexCount = (uint32_t)MESH_VERTICES.size(),
+		.meshTexture = meshTexture,
+		.meshSampler = meshSampler,
 	};
 	return state;
 }
+
+bool VulkanRenderer::recreateSwapchain(
+	const VulkanContext& ctx, VulkanState& state, SDL_Window* window
+) {
+	CPU_ZONE("recreateSwapchain");
+
+	int width{};
+	int height{};
+	SDL_Vulkan_GetDrawableSize(window, &width, &height);
+	if (width == 0 || height == 0) {
+		return false;
+	}
+
+	Deletable<Swapchain> swapchain{ createSwapchain(
+		ctx,
+		window,
+		state.presentMode,
+		(uint32_t)state.frames.size(),
+		state.swapchain.handle
+	) };
+
+	// frames up to the last submitted one may still use the old images
+	DeletionQueue oldSwapchainDeletionQueue{
+		std::move(state.swapchainDeletionQueue)
+	};
+	state.frameDeletionQueue.pushFunction(
+		state.frameNumber,
+		[=]() mutable { oldSwapchainDeletionQueue.flush(); }
+	);
+	state.swapchainDeletionQueue = DeletionQueue{};
+	state.swapchainDeletionQueue.pushFunction(std::move(swapchain.deleter));
+
+	state.swapchain = swapchain.obj;
+	state.renderExtent = swapchain.obj.extent;
+	state.swapchainOutdated = false;
+
+	const VkExtent3D& drawExtent{ state.drawImage.extent };
+	if (state.renderExtent.width <= drawExtent.width &&
+		state.renderExtent.height <= drawExtent.height) {
+		return true;
+	}
+
+	// the draw image's heap index is rewritten in place, so the frames still
+	// reading it have to finish. this only happens when the window outgrows
+	// every size it had before
+	vkutils::waitForTimeline(ctx, state.frameTimeline, state.frameNumber);
+	state.drawImageDeletionQueue.flush();
+
+	VkExtent2D drawImageExtent{
+		.width = std::max(state.renderExtent.width, drawExtent.width),
+		.height = std::max(state.renderExtent.height, drawExtent.height),
+	};
+	state.drawImage = createDrawImage(
+		ctx, drawImageExtent, state.drawImageDeletionQueue
+	);
+	updateStorageImage(
+		ctx, state.bindlessHeap, state.drawImageIndex, state.drawImage.view
+	);
+
+	return true;
+}
+
+namespace {
+	VkPresentModeKHR getVkPresentMode(
+		const VulkanRenderer::PresentMode presentMode
+	) {
+		switch (presentMode) {
+			case VulkanRenderer::PresentMode::mailbox:
+				return VK_PRESENT_MODE_MAILBOX_KHR;
+			case VulkanRenderer::PresentMode::fifoRelaxed:
+				return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			case VulkanRenderer::PresentMode::immediate:
+				return VK_PRESENT_MODE_IMMEDIATE_KHR;
+			case VulkanRenderer::PresentMode::fifo:
+			default:
+				return VK_PRESENT_MODE_FIFO_KHR;
+		}
+	}
+
+	std::vector<uint8_t> createCheckerTexels(
+		const uint32_t size, const uint32_t cellSize
+	) {
+		std::vector<uint8_t> texels;
+		texels.reserve(size * size * 4);
+
+		for (uint32_t y{}; y < size; y++) {
+			for (uint32_t x{}; x < size; x++) {
+				const bool light{ ((x / cellSize) + (y / cellSize)) % 2 == 0 };
+				const uint8_t value{ light ? (uint8_t)200 : (uint8_t)60 };
+				texels.insert(texels.end(), { value, value, value, 255 });
+			}
+		}
+
+		return texels;
+	}
+}  // namespace
@@ -2,52 +2,164 @@
 
 #include <vulkan/vulkan.h>
 #include <array>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
 
 #include "Swapchain.h"
+#include "AsyncUploader.h"
 #include "Context.h"
 #include "Cleanup.h"
+#include "Defragmenter.h"
 #include "Image.h"
+#include "Renderer.h"
+#include "RenderGraph.h"
+#include "GpuProfiler.h"
+#include "MemoryBudget.h"
+#include "PipelineCache.h"
+#include "ShaderReloader.h"
+#include "TextureStreamer.h"
+#include "UploadRing.h"
+#include "WorkgroupTuner.h"
+#include "vkcore/BindlessHeap.h"
+#include "vkcore/ObjectRegistry.h"
+#include "utils/ThreadPool.h"
 
 namespace VulkanRenderer {
 
+	// matches second.comp
+	struct GradientPushConstants {
+		glm::vec4 d1;
+		glm::vec4 d2;
+		glm::vec4 d3;
+		glm::vec4 d4;
+		// bindless storage image index of the target
+		uint32_t screen;
+	};
+
+	// matches first.vert
+	struct MeshVertex {
+		glm::vec3 position;
+		glm::vec2 texCoord;
+	};
+	// pushed to the upload ring every frame
+	struct MeshUniforms {
+		glm::mat4 model;
+		glm::mat4 view;
+		glm::mat4 proj;
+	};
+
 	struct PerFrameVulkanState {
-		VkCommandBuffer commandBuffer;
+		// a set of pools per recording thread
+		RenderGraphCommandPools commandPools;
+		// sets that live for one frame, reset with the command pools. only
+		// allocate while building the graph, not from pass callbacks
+		vkcore::DescriptorAllocator descriptorAllocator;
 
 		VkSemaphore semFrameAvaliable;
 		VkSemaphore semRenderFinished;
-		VkFence fenceRenderFinished;
 	};
 
 	struct VulkanState {
-		static constexpr int MAX_FRAMES_IN_FLIGHT{ 2 };
-
+		// swapchain is empty when headless
 		DeletionQueue swapchainDeletionQueue;
 		Swapchain swapchain;
+		VkPresentModeKHR presentMode;
+		// set when acquire or present report the swapchain no longer matches
+		// the surface
+		bool swapchainOutdated;
 
+		// the draw image only grows, renderExtent is the part that is drawn
+		// and presented
+		DeletionQueue drawImageDeletionQueue;
 		Image drawImage;
+		VkExtent2D renderExtent;
+		RenderGraphTransientPool transientImages;
 
 		VkQueue graphicsQueue;
 		VkQueue presentationQueue;
 		VkQueue transferQueue;
+		VkQueue computeQueue;
+
+		// graphics and compute queues with their timelines, indexed by
+		// RenderGraphQueue
+		RenderGraphQueues renderQueues;
 
 		VkCommandPool immediateCommandPool{};
 		VkCommandBuffer immediateCommandBuffer{};
 		VkFence immediateFence{};
 
-		VkCommandPool frameCommandPool;
-		std::array<PerFrameVulkanState, MAX_FRAMES_IN_FLIGHT> frames;
+		// one per frame in flight, sized by RendererSettings::framesInFlight
+		std::vector<PerFrameVulkanState> frames;
+		// records render graph passes, also loads shaders at startup
+		std::unique_ptr<ThreadPool> recordThreadPool;
+		// per frame data too big for push constants, a region per frame in
+		// flight
+		UploadRing uploadRing;
+		// streams buffers and images in on the transfer queue, updated once
+		// per frame
+		AsyncUploader uploader;
+
+		// every resource shaders index, bound once per command buffer
+		vkcore::BindlessHeap bindlessHeap;
+		// follows the draw image when it is recreated
+		uint32_t drawImageIndex;
+
+		// the last submission of every frame signals the frame's number, cpu
+		// side waits and deferred deletions are keyed on it
+		VkSemaphore frameTimeline;
+		uint64_t frameNumber;
+		DeferredDeletionQueue frameDeletionQueue;
+
+		// queues indexed by RenderGraphQueue, frames by frame in flight
+		GpuProfiler gpuProfiler;
+		// refreshed every frame, its pressure callbacks let caches shrink
+		// before allocations start failing
+		MemoryBudget memoryBudget;
+		// moves textures out of sparsely used blocks a few MiB per frame,
+		// submits to the graphics queue of renderQueues
+		Defragmenter defragmenter;
 
-		VkDescriptorPool mainDescriptorPool;
-		VkDescriptorSetLayout imageDescriptoreSetLayout;
-		VkDescriptorSet imageDescriptorSet;
+		// saved periodically and on cleanup
+		PipelineCache pipelineCache;
+		// layouts, modules and pipelines shared by content
+		std::unique_ptr<vkcore::ObjectRegistry> objectRegistry;
+		// null unless RendererSettings::shaderHotReload is set
+		std::unique_ptr<ShaderReloader> shaderReloader;
+		// submits to the graphics queue of renderQueues
+		std::unique_ptr<TextureStreamer> textureStreamer;
 
+		// replaced when its shader is reloaded, released in cleanup
 		VkPipeline gradientPipeline;
 		VkPipelineLayout gradientPipeLayout;
+		// picked by the workgroup tuner, passed as specialization constants
+		WorkgroupSize gradientWorkgroupSize;
+
+		// first.vert and first.frag, drawn over the gradient
+		VkPipeline meshPipeline;
+		VkPipelineLayout meshPipeLayout;
+		// set 0 of meshPipeLayout, allocated from the frame's allocator
+		VkDescriptorSetLayout meshSetLayout;
+		vkcore::DescriptorSetLayoutInfo meshSetLayoutInfo;
+		// a quad of MeshVertex
+		Buffer meshVertices;
+		uint32_t meshVertexCount;
+		Image meshTexture;
+		VkSampler meshSampler;
 	};
 
 	VulkanState createVulkanState(
 		const VulkanContext& ctx,
 		SDL_Window* window,
+		const RendererSettings& settings,
 		DeletionQueue& deletionQueue
 	);
+
+	// recreates the swapchain at the window's current size. the old swapchain
+	// is destroyed once the frames using it retire. returns false while the
+	// window has no area, nothing can be presented until it has one
+	bool recreateSwapchain(
+		const VulkanContext& ctx, VulkanState& state, SDL_Window* window
+	);
 }  // namespace VulkanRenderer
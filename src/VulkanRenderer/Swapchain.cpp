@@ -21,20 +21,24 @@ namespace {
 
 	SwapchainInfo fillSwapchainInfo(
 		SDL_Window* window,
-		const vkutils::SurfaceSupportDetails& surfaceSupportDetails
+		const vkutils::SurfaceSupportDetails& surfaceSupportDetails,
+		const VkPresentModeKHR preferredPresentMode,
+		const uint32_t framesInFlight
 	);
 
 	VkSurfaceFormatKHR chooseSwapchainSurfaceFormat(
 		const std::vector<VkSurfaceFormatKHR>& availableSurfaceFormats
 	);
 	VkPresentModeKHR chooseSwapchainPresentMode(
-		const std::vector<VkPresentModeKHR>& presentModes
+		const std::vector<VkPresentModeKHR>& presentModes,
+		const VkPresentModeKHR preferredPresentMode
 	);
 	VkExtent2D chooseSwapchainExtent(
 		SDL_Window* window, VkSurfaceCapabilitiesKHR capabilities
 	);
 	uint32_t chooseImageCount(
-		const vkutils::SurfaceSupportDetails& surfaceSupportDetails
+		const vkutils::SurfaceSupportDetails& surfaceSupportDetails,
+		const uint32_t framesInFlight
 	);
 
 	void destroySwapchainImageViews(
@@ -52,6 +56,8 @@ namespace {
 Deletable<Swapchain> VulkanRenderer::createSwapchain(
 	const VulkanContext& ctx,
 	SDL_Window* window,
+	const VkPresentModeKHR presentMode,
+	const uint32_t framesInFlight,
 	const VkSwapchainKHR oldSwapchainHandle
 ) {
 	Swapchain swapchain{};
@@ -61,9 +67,9 @@ Deletable<Swapchain> VulkanRenderer::createSwapchain(
 			ctx.device.physical, ctx.surface
 		)
 	};
-	SwapchainInfo swapchainInfo{
-		fillSwapchainInfo(window, surfaceSupportDetails)
-	};
+	SwapchainInfo swapchainInfo{ fillSwapchainInfo(
+		window, surfaceSupportDetails, presentMode, framesInFlight
+	) };
 
 	VkSwapchainCreateInfoKHR swapchainCreateInfo{
 		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
@@ -131,18 +137,22 @@ void destroySwapchain(const Device& device, Swapchain* swapchain) {
 namespace {
 	SwapchainInfo fillSwapchainInfo(
 		SDL_Window* window,
-		const vkutils::SurfaceSupportDetails& surfaceSupportDetails
+		const vkutils::SurfaceSupportDetails& surfaceSupportDetails,
+		const VkPresentModeKHR preferredPresentMode,
+		const uint32_t framesInFlight
 	) {
 		VkSurfaceFormatKHR surfaceFormat{
 			chooseSwapchainSurfaceFormat(surfaceSupportDetails.surfaceFormats)
 		};
-		VkPresentModeKHR presentMode{
-			chooseSwapchainPresentMode(surfaceSupportDetails.presentModes)
-		};
+		VkPresentModeKHR presentMode{ chooseSwapchainPresentMode(
+			surfaceSupportDetails.presentModes, preferredPresentMode
+		) };
 		VkExtent2D extent{ chooseSwapchainExtent(
 			window, surfaceSupportDetails.surfaceCapabilities
 		) };
-		uint32_t imageCount{ chooseImageCount(surfaceSupportDetails) };
+		uint32_t imageCount{
+			chooseImageCount(surfaceSupportDetails, framesInFlight)
+		};
 
 		SwapchainInfo swapchainInfo{ .presentMode = presentMode,
 									 .colorSpace = surfaceFormat.colorSpace,
@@ -181,13 +191,19 @@ namespace {
 	}
 
 	VkPresentModeKHR chooseSwapchainPresentMode(
-		const std::vector<VkPresentModeKHR>& presentModes
+		const std::vector<VkPresentModeKHR>& presentModes,
+		const VkPresentModeKHR preferredPresentMode
 	) {
 		for (const auto& presentMode : presentModes) {
-			if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+			if (presentMode == preferredPresentMode) {
 				return presentMode;
 			}
 		}
+
+		// fifo is the only mode every surface supports
+		logWarning(
+			"present mode ", preferredPresentMode, " not supported, using fifo"
+		);
 		return VK_PRESENT_MODE_FIFO_KHR;
 	}
 
@@ -224,12 +240,16 @@ namespace {
 	}
 
 	uint32_t chooseImageCount(
-		const vkutils::SurfaceSupportDetails& surfaceSupportDetails
+		const vkutils::SurfaceSupportDetails& surfaceSupportDetails,
+		const uint32_t framesInFlight
 	) {
 		uint32_t imageCount{};
 
-		imageCount =
-			surfaceSupportDetails.surfaceCapabilities.minImageCount + 1;
+		// one image per frame being recorded plus the one on screen
+		imageCount = std::max(
+			surfaceSupportDetails.surfaceCapabilities.minImageCount,
+			framesInFlight + 1
+		);
 		if (imageCount >
 				surfaceSupportDetails.surfaceCapabilities.maxImageCount &&
 			surfaceSupportDetails.surfaceCapabilities.maxImageCount > 0) {
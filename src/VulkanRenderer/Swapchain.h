@@ -26,9 +26,13 @@ struct Swapchain {
 namespace VulkanRenderer {
 	// will call flush to ensure only 1 swapchain per window.
 	// use a deticated swapchain deletion queue
+	// presentMode falls back to fifo when unsupported. the image count is
+	// framesInFlight + 1 within the surface limits
 	Deletable<Swapchain> createSwapchain(
 		const VulkanContext& ctx,
 		SDL_Window* window,
+		const VkPresentModeKHR presentMode,
+		const uint32_t framesInFlight,
 		const VkSwapchainKHR oldSwapchainHandle = VK_NULL_HANDLE
 	);
 }  // namespace VulkanRenderer
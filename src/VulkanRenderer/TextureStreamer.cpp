@@ -0,0 +1,839 @@
+#include "RendererPCH.h"
+
+#include "TextureStreamer.h"
+
+#include "debug/Debug.h"
+
+#include "vkcore/BindlessHeap.h"
+#include "Context.h"
+#include "DefaultCreateInfos.h"
+#include "utils/CpuProfiler.h"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+using namespace VulkanRenderer;
+
+namespace {
+	constexpr VkFormat TEXTURE_FORMAT{ VK_FORMAT_R8G8B8A8_SRGB };
+	constexpr VkDeviceSize TEXEL_SIZE{ 4 };
+	// levels up to 64x64 are never evicted, so a texture always has
+	// something to sample
+	constexpr uint32_t MIN_RESIDENT_LEVELS{ 7 };
+	// decoded images uploaded per frame, the rest wait for the next one.
+	// keeps staging memory and copy time of a frame bounded
+	constexpr VkDeviceSize MAX_UPLOAD_BYTES_PER_FRAME{ 32 * 1024 * 1024 };
+	// evicted images are only freed once their submission finished, memory
+	// is not shed again before then
+	constexpr uint64_t SHED_INTERVAL_FRAMES{ 8 };
+	constexpr uint64_t BUDGET_RECOVERY_FRAMES{ 600 };
+
+	constexpr std::array<uint8_t, 4> FALLBACK_TEXEL{ 128, 128, 128, 255 };
+
+	uint32_t getMipLevelCount(const VkExtent3D extent);
+	VkExtent3D getMipExtent(const VkExtent3D extent, const uint32_t level);
+	VkOffset3D getMipEnd(const VkExtent3D extent, const uint32_t level);
+	VkDeviceSize getLevelBytes(const VkExtent3D extent, const uint32_t level);
+	// levels 0 to mipLevels
+	VkDeviceSize
+		getChainBytes(const VkExtent3D extent, const uint32_t mipLevels);
+
+	// stages, accesses and layouts are left to the caller
+	VkImageMemoryBarrier2 getLevelBarrier(
+		const Image& image, const uint32_t baseLevel, const uint32_t levelCount
+	);
+	void cmdImageBarriers(
+		VkCommandBuffer cmdBuffer,
+		const std::span<const VkImageMemoryBarrier2> barriers
+	);
+}  // namespace
+
+VulkanRenderer::TextureStreamer::TextureStreamer(
+	const VulkanContext& ctx,
+	AsyncUploader& uploader,
+	vkcore::BindlessHeap& heap,
+	Defragmenter& defragmenter,
+	vkutils::TimelineQueue& graphicsQueue,
+	const TextureStreamerSettings& settings
+) :
+	m_Ctx(ctx),
+	m_Uploader(uploader),
+	m_Heap(heap),
+	m_Defragmenter(defragmenter),
+	m_GraphicsQueue(graphicsQueue),
+	m_Settings(settings),
+	m_Budget(settings.budget) {
+	VkCommandPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+				 VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = graphicsQueue.familyIndex,
+	};
+	if (vkCreateCommandPool(
+			ctx.device.logical, &poolCreateInfo, nullptr, &m_CmdPool
+		) != VK_SUCCESS) {
+		logFatal("could not create texture streamer command pool");
+	}
+
+	// sampled until a texture's first upload finished
+	const VkExtent3D fallbackExtent{ .width = 1, .height = 1, .depth = 1 };
+	m_FallbackImage = createImage(
+		ctx,
+		fallbackExtent,
+		TEXTURE_FORMAT,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		MemoryCategory::textures
+	);
+
+	UploadTicket fallbackTicket{ enqueueImageUpload(
+		ctx,
+		uploader,
+		{ .image = m_FallbackImage.handle,
+		  .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+		  .extent = fallbackExtent,
+		  .data = { (const char*)FALLBACK_TEXEL.data(),
+					FALLBACK_TEXEL.size() },
+		  .finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL }
+	) };
+	waitForUpload(ctx, uploader, fallbackTicket);
+
+	m_FallbackIndex =
+		vkcore::registerSampledImage(ctx, heap, m_FallbackImage.view);
+
+	VkSamplerCreateInfo samplerCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.magFilter = VK_FILTER_LINEAR,
+		.minFilter = VK_FILTER_LINEAR,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.anisotropyEnable = VK_TRUE,
+		.maxAnisotropy = std::min(
+			16.f, ctx.device.properties.limits.maxSamplerAnisotropy
+		),
+		.maxLod = VK_LOD_CLAMP_NONE,
+	};
+	if (vkCreateSampler(
+			ctx.device.logical, &samplerCreateInfo, nullptr, &m_Sampler
+		) != VK_SUCCESS) {
+		logFatal("could not create texture sampler");
+	}
+	m_SamplerIndex = vkcore::registerSampler(ctx, heap, m_Sampler);
+
+	for (uint32_t i{}; i < std::max(settings.decodeThreads, 1u); i++) {
+		m_DecodeThreads.emplace_back(&TextureStreamer::decodeLoop, this);
+	}
+}
+
+VulkanRenderer::TextureStreamer::~TextureStreamer() {
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_Stopping = true;
+	}
+	m_RequestAvailable.notify_all();
+	for (auto& thread : m_DecodeThreads) {
+		thread.join();
+	}
+
+	m_DeletionQueue.flush();
+
+	for (const auto& texture : m_Textures) {
+		if (texture.image.handle == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		vkcore::unregisterBindless(
+			m_Heap, vkcore::BindlessType::sampledImage, texture.bindlessIndex
+		);
+		destroyMovableImage(m_Ctx, m_Defragmenter, texture.image);
+	}
+	for (const auto& pending : m_Pending) {
+		destroyImage(m_Ctx, pending.image);
+	}
+
+	vkcore::unregisterBindless(
+		m_Heap, vkcore::BindlessType::sampledImage, m_FallbackIndex
+	);
+	vkcore::unregisterBindless(
+		m_Heap, vkcore::BindlessType::sampler, m_SamplerIndex
+	);
+	destroyImage(m_Ctx, m_FallbackImage);
+	vkDestroySampler(m_Ctx.device.logical, m_Sampler, nullptr);
+	vkDestroyCommandPool(m_Ctx.device.logical, m_CmdPool, nullptr);
+}
+
+TextureHandle VulkanRenderer::TextureStreamer::requestTexture(
+	const std::filesystem::path& path
+) {
+	TextureHandle handle{ (TextureHandle)m_Textures.size() };
+	m_Textures.emplace_back(Texture{
+		.path = path,
+		.bindlessIndex = m_FallbackIndex,
+		.movedIndex = vkcore::BINDLESS_INVALID_INDEX,
+		.lastUsedFrame = m_FrameNumber,
+		.loading = true,
+	});
+
+	{
+		std::lock_guard lock{ m_Mutex };
+		m_Requests.emplace_back(DecodeRequest{ handle, path });
+	}
+	m_RequestAvailable.notify_one();
+
+	return handle;
+}
+
+uint32_t VulkanRenderer::TextureStreamer::useTexture(
+	const TextureHandle texture, const uint32_t mip
+) {
+	if (texture >= m_Textures.size()) {
+		logWarning("unknown texture ", texture);
+		return m_FallbackIndex;
+	}
+
+	Texture& used{ m_Textures[texture] };
+	used.wantedMip = used.lastUsedFrame == m_FrameNumber
+						 ? std::min(used.wantedMip, mip)
+						 : mip;
+	used.lastUsedFrame = m_FrameNumber;
+
+	// nothing is resident, so it is loaded regardless of the budget like
+	// any first load
+	if (used.dropped && !m_HeapFull) {
+		used.dropped = false;
+		used.loading = true;
+
+		{
+			std::lock_guard lock{ m_Mutex };
+			m_Requests.emplace_back(DecodeRequest{ texture, used.path });
+		}
+		m_RequestAvailable.notify_one();
+
+		return used.bindlessIndex;
+	}
+
+	// evicted levels come back by decoding the whole image again
+	if (used.image.handle != VK_NULL_HANDLE && !used.loading &&
+		!m_HeapFull && mip < used.residentMip) {
+		VkDeviceSize promotedBytes{
+			m_ResidentBytes -
+			getChainBytes(used.image.extent, used.image.mipLevels) +
+			getChainBytes(used.fullExtent, used.fullMipLevels)
+		};
+
+		if (promotedBytes <= m_Budget) {
+			used.loading = true;
+
+			{
+				std::lock_guard lock{ m_Mutex };
+				m_Requests.emplace_back(DecodeRequest{ texture, used.path });
+			}
+			m_RequestAvailable.notify_one();
+		}
+	}
+
+	return used.bindlessIndex;
+}
+
+uint32_t VulkanRenderer::TextureStreamer::getSamplerIndex() const {
+	return m_SamplerIndex;
+}
+
+void VulkanRenderer::TextureStreamer::update(const uint64_t frameNumber) {
+	m_FrameNumber = frameNumber;
+	if (m_FrameNumber > m_LastShedFrame + BUDGET_RECOVERY_FRAMES) {
+		m_Budget = m_Settings.budget;
+	}
+
+	const uint64_t completed{
+		vkutils::getTimelineValue(m_Ctx, m_GraphicsQueue.timeline)
+	};
+	m_DeletionQueue.collect(completed);
+	while (!m_InFlightCmdBuffers.empty() &&
+		   m_InFlightCmdBuffers.front().retireValue <= completed) {
+		m_FreeCmdBuffers.emplace_back(m_InFlightCmdBuffers.front().cmdBuffer);
+		m_InFlightCmdBuffers.pop_front();
+	}
+
+	// indices the streamer or anyone else released make room again
+	if (m_HeapFull) {
+		m_HeapFull = vkcore::isBindlessFull(
+			m_Heap, vkcore::BindlessType::sampledImage
+		);
+	}
+
+	// mip 0 was acquired by the graphics queue ahead of this submission
+	for (auto it{ m_Pending.begin() }; it != m_Pending.end();) {
+		if (!isUploadComplete(m_Uploader, it->ticket)) {
+			it++;
+			continue;
+		}
+
+		Texture& texture{ m_Textures[it->texture] };
+		cmdGenerateMips(getCommandBuffer(), it->image);
+		swapImage(texture, it->image, 0);
+		texture.loading = false;
+
+		it = m_Pending.erase(it);
+	}
+
+	std::vector<DecodedImage> decoded;
+	{
+		std::lock_guard lock{ m_Mutex };
+
+		VkDeviceSize uploadBytes{};
+		while (!m_Decoded.empty() && uploadBytes < MAX_UPLOAD_BYTES_PER_FRAME) {
+			uploadBytes += getLevelBytes(m_Decoded.front().extent, 0);
+
+			decoded.emplace_back(std::move(m_Decoded.front()));
+			m_Decoded.pop_front();
+		}
+	}
+	for (const auto& image : decoded) {
+		startUpload(image);
+	}
+
+	cmdEvict();
+
+	if (m_CmdBuffer == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkCommandBuffer cmdBuffer{ m_CmdBuffer };
+	m_CmdBuffer = VK_NULL_HANDLE;
+	CHECK_VK_FATAL(vkEndCommandBuffer(cmdBuffer));
+
+	const uint64_t signalValue{ m_GraphicsQueue.value + 1 };
+	std::array cmdBufferInfos{ vkdefaults::cmdBufferSubmitInfo(cmdBuffer) };
+	std::array signalInfos{ vkdefaults::semSubmitInfo(
+		m_GraphicsQueue.timeline,
+		VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		signalValue
+	) };
+	VkSubmitInfo2 submitInfo{
+		vkdefaults::submitInfo(cmdBufferInfos, {}, signalInfos)
+	};
+	CHECK_VK_FATAL(vkQueueSubmit2(
+		m_GraphicsQueue.queue, 1, &submitInfo, VK_NULL_HANDLE
+	));
+
+	m_GraphicsQueue.value = signalValue;
+	m_InFlightCmdBuffers.emplace_back(InFlightCmdBuffer{
+		.cmdBuffer = cmdBuffer,
+		.retireValue = signalValue,
+	});
+}
+
+VkDeviceSize VulkanRenderer::TextureStreamer::getResidentBytes() const {
+	return m_ResidentBytes;
+}
+
+void VulkanRenderer::TextureStreamer::shedMemory(const VkDeviceSize bytes) {
+	if (m_LastShedFrame != 0 &&
+		m_FrameNumber < m_LastShedFrame + SHED_INTERVAL_FRAMES) {
+		return;
+	}
+
+	m_Budget = std::min(
+		m_Budget, m_ResidentBytes > bytes ? m_ResidentBytes - bytes : 0
+	);
+	m_LastShedFrame = m_FrameNumber;
+}
+
+void VulkanRenderer::TextureStreamer::decodeLoop() {
+	CpuProfiler::setThreadName("texture decoder");
+
+	while (true) {
+		DecodeRequest request{};
+		{
+			std::unique_lock lock{ m_Mutex };
+			m_RequestAvailable.wait(lock, [this]() {
+				return m_Stopping || !m_Requests.empty();
+			});
+			if (m_Stopping) {
+				return;
+			}
+
+			request = std::move(m_Requests.front());
+			m_Requests.pop_front();
+		}
+
+		DecodedImage decoded{ .texture = request.texture };
+		{
+			CPU_ZONE("decode texture");
+
+			int width{};
+			int height{};
+			int channels{};
+			stbi_uc* pixels{ stbi_load(
+				request.path.string().c_str(),
+				&width,
+				&height,
+				&channels,
+				STBI_rgb_alpha
+			) };
+
+			if (pixels) {
+				decoded.pixels = std::shared_ptr<const char>(
+					(const char*)pixels,
+					[](const char* data) { stbi_image_free((void*)data); }
+				);
+				decoded.extent = { .width = (uint32_t)width,
+								   .height = (uint32_t)height,
+								   .depth = 1 };
+			} else {
+				logWarning(
+					"could not decode ",
+					request.path.string(),
+					": ",
+					stbi_failure_reason()
+				);
+			}
+		}
+
+		std::lock_guard lock{ m_Mutex };
+		m_Decoded.emplace_back(std::move(decoded));
+	}
+}
+
+void VulkanRenderer::TextureStreamer::startUpload(const DecodedImage& decoded
+) {
+	Texture& texture{ m_Textures[decoded.texture] };
+
+	// keeps sampling whatever it had
+	if (!decoded.pixels) {
+		texture.loading = false;
+		return;
+	}
+
+	const uint32_t mipLevels{ getMipLevelCount(decoded.extent) };
+	Image image{ createImage(
+		m_Ctx,
+		decoded.extent,
+		TEXTURE_FORMAT,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		MemoryCategory::textures,
+		mipLevels
+	) };
+
+	UploadTicket ticket{ enqueueImageUpload(
+		m_Ctx,
+		m_Uploader,
+		{ .image = image.handle,
+		  .aspect = VK_IMAGE_ASPECT_COLOR_BIT,
+		  .extent = decoded.extent,
+		  .data = { decoded.pixels.get(),
+					getLevelBytes(decoded.extent, 0) },
+		  .finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL }
+	) };
+
+	texture.fullExtent = decoded.extent;
+	texture.fullMipLevels = mipLevels;
+
+	m_ResidentBytes += getChainBytes(image.extent, image.mipLevels);
+	m_Pending.emplace_back(PendingTexture{
+		.texture = decoded.texture,
+		.image = image,
+		.ticket = ticket,
+	});
+}
+
+void VulkanRenderer::TextureStreamer::cmdGenerateMips(
+	VkCommandBuffer cmdBuffer, const Image& image
+) {
+	// every level is blitted from the one before it, level 0 is in
+	// TRANSFER_SRC_OPTIMAL already
+	if (image.mipLevels > 1) {
+		VkImageMemoryBarrier2 barrier{
+			getLevelBarrier(image, 1, image.mipLevels - 1)
+		};
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		cmdImageBarriers(cmdBuffer, { &barrier, 1 });
+	}
+
+	for (uint32_t level{ 1 }; level < image.mipLevels; level++) {
+		VkImageBlit2 region{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
+			.srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+								.mipLevel = level - 1,
+								.layerCount = 1 },
+			.srcOffsets = { {}, getMipEnd(image.extent, level - 1) },
+			.dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+								.mipLevel = level,
+								.layerCount = 1 },
+			.dstOffsets = { {}, getMipEnd(image.extent, level) },
+		};
+		VkBlitImageInfo2 blitInfo{
+			.sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
+			.srcImage = image.handle,
+			.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.dstImage = image.handle,
+			.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			.regionCount = 1,
+			.pRegions = &region,
+			.filter = VK_FILTER_LINEAR,
+		};
+		vkCmdBlitImage2(cmdBuffer, &blitInfo);
+
+		VkImageMemoryBarrier2 barrier{ getLevelBarrier(image, level, 1) };
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		cmdImageBarriers(cmdBuffer, { &barrier, 1 });
+	}
+
+	VkImageMemoryBarrier2 barrier{ getLevelBarrier(image, 0, image.mipLevels) };
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_BLIT_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	cmdImageBarriers(cmdBuffer, { &barrier, 1 });
+}
+
+void VulkanRenderer::TextureStreamer::cmdTrimTexture(
+	VkCommandBuffer cmdBuffer, Texture& texture, const uint32_t residentMip
+) {
+	const Image& old{ texture.image };
+	const uint32_t droppedLevels{ residentMip - texture.residentMip };
+
+	Image trimmed{ createImage(
+		m_Ctx,
+		getMipExtent(old.extent, droppedLevels),
+		TEXTURE_FORMAT,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		MemoryCategory::textures,
+		old.mipLevels - droppedLevels
+	) };
+
+	// earlier graphics submissions may still sample the old image
+	std::array<VkImageMemoryBarrier2, 2> barriers{
+		getLevelBarrier(old, droppedLevels, trimmed.mipLevels),
+		getLevelBarrier(trimmed, 0, trimmed.mipLevels),
+	};
+	barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	barriers[1].dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	cmdImageBarriers(cmdBuffer, barriers);
+
+	std::vector<VkImageCopy2> regions;
+	regions.reserve(trimmed.mipLevels);
+	for (uint32_t level{}; level < trimmed.mipLevels; level++) {
+		regions.emplace_back(VkImageCopy2{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_COPY_2,
+			.srcSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+								.mipLevel = level + droppedLevels,
+								.layerCount = 1 },
+			.dstSubresource = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+								.mipLevel = level,
+								.layerCount = 1 },
+			.extent = getMipExtent(trimmed.extent, level),
+		});
+	}
+	VkCopyImageInfo2 copyInfo{
+		.sType = VK_STRUCTURE_TYPE_COPY_IMAGE_INFO_2,
+		.srcImage = old.handle,
+		.srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		.dstImage = trimmed.handle,
+		.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		.regionCount = (uint32_t)regions.size(),
+		.pRegions = regions.data(),
+	};
+	vkCmdCopyImage2(cmdBuffer, &copyInfo);
+
+	VkImageMemoryBarrier2 barrier{
+		getLevelBarrier(trimmed, 0, trimmed.mipLevels)
+	};
+	barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+	barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	barrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+	barrier.dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	cmdImageBarriers(cmdBuffer, { &barrier, 1 });
+
+	m_ResidentBytes += getChainBytes(trimmed.extent, trimmed.mipLevels);
+	swapImage(texture, trimmed, residentMip);
+}
+
+void VulkanRenderer::TextureStreamer::swapImage(
+	Texture& texture, const Image& image, const uint32_t residentMip
+) {
+	// the value the submission being recorded signals, nothing else
+	// submits to the graphics queue until it is submitted
+	const uint64_t retireValue{ m_GraphicsQueue.value + 1 };
+
+	uint32_t index{ vkcore::registerSampledImage(m_Ctx, m_Heap, image.view) };
+	if (index == vkcore::BINDLESS_INVALID_INDEX) {
+		logWarning(
+			"bindless heap is full, ", texture.path.string(), " is not updated"
+		);
+		m_HeapFull = true;
+		texture.dropped = texture.image.handle == VK_NULL_HANDLE;
+
+		m_ResidentBytes -= getChainBytes(image.extent, image.mipLevels);
+		m_DeletionQueue.pushFunction(retireValue, [this, image]() {
+			destroyImage(m_Ctx, image);
+		});
+		return;
+	}
+
+	if (texture.image.handle != VK_NULL_HANDLE) {
+		// released once the submission being recorded retires, it must
+		// not be moved in the meantime
+		unregisterMovable(m_Defragmenter, texture.image.allocation);
+
+		m_ResidentBytes -=
+			getChainBytes(texture.image.extent, texture.image.mipLevels);
+		m_DeletionQueue.pushFunction(
+			retireValue,
+			[this, old = texture.image, oldIndex = texture.bindlessIndex]() {
+				vkcore::unregisterBindless(
+					m_Heap, vkcore::BindlessType::sampledImage, oldIndex
+				);
+				destroyMovableImage(m_Ctx, m_Defragmenter, old);
+			}
+		);
+	}
+
+	texture.image = image;
+	texture.bindlessIndex = index;
+	texture.residentMip = residentMip;
+
+	const TextureHandle handle{ (TextureHandle)(&texture - m_Textures.data()) };
+	registerMovable(
+		m_Defragmenter,
+		MovableResource{
+			.type = MovableType::image,
+			.image = image,
+			.usage = VK_IMAGE_USAGE_SAMPLED_BIT |
+					 VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+					 VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			.onMoved =
+				[this, handle](
+					const MovableResource& moved, const uint64_t retireValue
+				) { onTextureMoved(handle, moved.image, retireValue); },
+			.canMove = [this, handle]() { return reserveMovedIndex(handle); },
+		}
+	);
+}
+
+void VulkanRenderer::TextureStreamer::cmdEvict() {
+	// a trimmed copy needs an index before the old one is released
+	if (m_ResidentBytes <= m_Budget || m_HeapFull) {
+		return;
+	}
+	const bool shedding{ m_Budget < m_Settings.budget };
+
+	struct Candidate {
+		TextureHandle texture;
+		uint32_t residentMip;
+	};
+
+	std::vector<Candidate> candidates;
+	for (TextureHandle i{}; i < m_Textures.size(); i++) {
+		const Texture& texture{ m_Textures[i] };
+		if (texture.image.handle != VK_NULL_HANDLE && !texture.loading &&
+			texture.residentMip < getMaxResidentMip(texture)) {
+			candidates.emplace_back(Candidate{ i, texture.residentMip });
+		}
+	}
+	std::sort(
+		candidates.begin(),
+		candidates.end(),
+		[this](const Candidate& a, const Candidate& b) {
+			return m_Textures[a.texture].lastUsedFrame <
+				   m_Textures[b.texture].lastUsedFrame;
+		}
+	);
+
+	// levels finer than what was last used go first, then whole levels of
+	// textures the last frame didn't use, or of any texture while memory is
+	// shed. least recently used first
+	VkDeviceSize projectedBytes{ m_ResidentBytes };
+	for (bool unusedPass : { false, true }) {
+		for (auto& candidate : candidates) {
+			const Texture& texture{ m_Textures[candidate.texture] };
+
+			uint32_t lastMip{ getMaxResidentMip(texture) };
+			if (!unusedPass) {
+				lastMip = std::min(lastMip, texture.wantedMip);
+			} else if (!shedding &&
+					   texture.lastUsedFrame + 1 >= m_FrameNumber) {
+				continue;
+			}
+
+			while (projectedBytes > m_Budget &&
+				   candidate.residentMip < lastMip) {
+				projectedBytes -=
+					getLevelBytes(texture.fullExtent, candidate.residentMip);
+				candidate.residentMip++;
+			}
+		}
+	}
+
+	for (const auto& candidate : candidates) {
+		Texture& texture{ m_Textures[candidate.texture] };
+		if (candidate.residentMip > texture.residentMip && !m_HeapFull) {
+			cmdTrimTexture(getCommandBuffer(), texture, candidate.residentMip);
+		}
+	}
+}
+
+bool VulkanRenderer::TextureStreamer::reserveMovedIndex(
+	const TextureHandle handle
+) {
+	Texture& texture{ m_Textures[handle] };
+
+	// points at the current image until the move switches it over
+	texture.movedIndex =
+		vkcore::registerSampledImage(m_Ctx, m_Heap, texture.image.view);
+
+	return texture.movedIndex != vkcore::BINDLESS_INVALID_INDEX;
+}
+
+void VulkanRenderer::TextureStreamer::onTextureMoved(
+	const TextureHandle handle, const Image& moved, const uint64_t retireValue
+) {
+	Texture& texture{ m_Textures[handle] };
+
+	// nothing has sampled the reserved index yet, work submitted before
+	// retireValue samples the old one
+	vkcore::updateSampledImage(m_Ctx, m_Heap, texture.movedIndex, moved.view);
+	m_DeletionQueue.pushFunction(
+		retireValue,
+		[this, oldIndex = texture.bindlessIndex]() {
+			vkcore::unregisterBindless(
+				m_Heap, vkcore::BindlessType::sampledImage, oldIndex
+			);
+		}
+	);
+
+	texture.bindlessIndex = texture.movedIndex;
+	texture.movedIndex = vkcore::BINDLESS_INVALID_INDEX;
+	texture.image = moved;
+}
+
+VkCommandBuffer VulkanRenderer::TextureStreamer::getCommandBuffer() {
+	if (m_CmdBuffer != VK_NULL_HANDLE) {
+		return m_CmdBuffer;
+	}
+
+	if (!m_FreeCmdBuffers.empty()) {
+		m_CmdBuffer = m_FreeCmdBuffers.back();
+		m_FreeCmdBuffers.pop_back();
+	} else {
+		VkCommandBufferAllocateInfo allocInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = m_CmdPool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		CHECK_VK_FATAL(vkAllocateCommandBuffers(
+			m_Ctx.device.logical, &allocInfo, &m_CmdBuffer
+		));
+	}
+
+	VkCommandBufferBeginInfo beginInfo{ vkdefaults::commandBufferBeginInfo(
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT
+	) };
+	CHECK_VK_FATAL(vkBeginCommandBuffer(m_CmdBuffer, &beginInfo));
+
+	return m_CmdBuffer;
+}
+
+uint32_t VulkanRenderer::TextureStreamer::getMaxResidentMip(
+	const Texture& texture
+) const {
+	if (texture.fullMipLevels <= MIN_RESIDENT_LEVELS) {
+		return 0;
+	}
+
+	return texture.fullMipLevels - MIN_RESIDENT_LEVELS;
+}
+
+namespace {
+	uint32_t getMipLevelCount(const VkExtent3D extent) {
+		return std::bit_width(std::max(extent.width, extent.height));
+	}
+
+	VkExtent3D getMipExtent(const VkExtent3D extent, const uint32_t level) {
+		return VkExtent3D{
+			.width = std::max(extent.width >> level, 1u),
+			.height = std::max(extent.height >> level, 1u),
+			.depth = 1,
+		};
+	}
+
+	VkOffset3D getMipEnd(const VkExtent3D extent, const uint32_t level) {
+		VkExtent3D mipExtent{ getMipExtent(extent, level) };
+		return VkOffset3D{
+			.x = (int32_t)mipExtent.width,
+			.y = (int32_t)mipExtent.height,
+			.z = 1,
+		};
+	}
+
+	VkDeviceSize getLevelBytes(const VkExtent3D extent, const uint32_t level) {
+		VkExtent3D mipExtent{ getMipExtent(extent, level) };
+		return (VkDeviceSize)mipExtent.width * mipExtent.height * TEXEL_SIZE;
+	}
+
+	VkDeviceSize
+		getChainBytes(const VkExtent3D extent, const uint32_t mipLevels) {
+		VkDeviceSize bytes{};
+		for (uint32_t level{}; level < mipLevels; level++) {
+			bytes += getLevelBytes(extent, level);
+		}
+
+		return bytes;
+	}
+
+	VkImageMemoryBarrier2 getLevelBarrier(
+		const Image& image, const uint32_t baseLevel, const uint32_t levelCount
+	) {
+		return VkImageMemoryBarrier2{
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = image.handle,
+			.subresourceRange = { .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+								  .baseMipLevel = baseLevel,
+								  .levelCount = levelCount,
+								  .layerCount = 1 },
+		};
+	}
+
+	void cmdImageBarriers(
+		VkCommandBuffer cmdBuffer,
+		const std::span<const VkImageMemoryBarrier2> barriers
+	) {
+		VkDependencyInfo depInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.imageMemoryBarrierCount = (uint32_t)barriers.size(),
+			.pImageMemoryBarriers = barriers.data(),
+		};
+		vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+	}
+}  // namespace
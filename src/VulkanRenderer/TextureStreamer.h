@@ -0,0 +1,206 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AsyncUploader.h"
+#include "Cleanup.h"
+#include "Defragmenter.h"
+#include "Image.h"
+#include "vkutils/Synchronization.h"
+
+// forward declerations
+struct VulkanContext;
+
+namespace vkcore {
+	struct BindlessHeap;
+}
+
+namespace VulkanRenderer {
+	// index of a texture in its streamer, valid for the streamer's lifetime
+	using TextureHandle = uint32_t;
+
+	struct TextureStreamerSettings {
+		// device memory textures may take. past it the least recently used
+		// textures lose their finest mips
+		VkDeviceSize budget;
+		uint32_t decodeThreads;
+	};
+
+	// decodes images on worker threads, uploads them through the uploader
+	// and generates their mips on the graphics queue. a texture samples a
+	// grey fallback until its mips are ready, and is recreated smaller when
+	// it is evicted. resident images are registered with the defragmenter.
+	// everything but decoding happens on the render thread. only the
+	// graphics queue may sample streamed textures
+	class TextureStreamer {
+	   public:
+		// submits to graphicsQueue and signals its timeline
+		TextureStreamer(
+			const VulkanContext& ctx,
+			AsyncUploader& uploader,
+			vkcore::BindlessHeap& heap,
+			Defragmenter& defragmenter,
+			vkutils::TimelineQueue& graphicsQueue,
+			const TextureStreamerSettings& settings
+		);
+		// the device has to be idle, destroyed before the defragmenter
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// the image is decoded as rgba8 srgb
+		TextureHandle requestTexture(const std::filesystem::path& path);
+
+		// bindless sampled image index of what is resident, only valid for
+		// the current frame. marks the texture used, evicted mips finer than
+		// mip are streamed back in while the budget allows
+		uint32_t
+			useTexture(const TextureHandle texture, const uint32_t mip = 0);
+		// linear with every mip, for sampleBindless
+		uint32_t getSamplerIndex() const;
+
+		// swaps in finished textures, starts uploads of decoded ones and
+		// evicts past the budget. mip generation and eviction copies are
+		// submitted on the graphics queue, call once per frame after
+		// updateUploads and before the frame's graph is compiled
+		void update(const uint64_t frameNumber);
+
+		// including uploads in flight
+		VkDeviceSize getResidentBytes() const;
+
+		// lowers the budget so the next update evicts about bytes, recently
+		// used textures included. the budget is restored once no memory was
+		// shed for a while
+		void shedMemory(const VkDeviceSize bytes);
+
+	   private:
+		struct Texture {
+			std::filesystem::path path;
+			// null until the first upload finished
+			Image image;
+			uint32_t bindlessIndex;
+			// reserved for the image a defragmentation pass is about to
+			// move it to
+			uint32_t movedIndex;
+
+			// of the image at full resolution
+			VkExtent3D fullExtent;
+			uint32_t fullMipLevels;
+			// finest level of the full chain the image holds
+			uint32_t residentMip;
+
+			uint32_t wantedMip;
+			uint64_t lastUsedFrame;
+			// a decode or upload is in flight
+			bool loading;
+			// the first load found the bindless heap full, the texture is
+			// loaded again once it is used while the heap has room
+			bool dropped;
+		};
+
+		struct DecodeRequest {
+			TextureHandle texture;
+			std::filesystem::path path;
+		};
+
+		struct DecodedImage {
+			TextureHandle texture;
+			std::shared_ptr<const char> pixels;
+			VkExtent3D extent;
+		};
+
+		struct PendingTexture {
+			TextureHandle texture;
+			Image image;
+			UploadTicket ticket;
+		};
+
+		struct InFlightCmdBuffer {
+			VkCommandBuffer cmdBuffer;
+			uint64_t retireValue;
+		};
+
+		void decodeLoop();
+
+		void startUpload(const DecodedImage& decoded);
+		void cmdGenerateMips(VkCommandBuffer cmdBuffer, const Image& image);
+		// replaces the texture's image by a copy without its finest levels
+		void cmdTrimTexture(
+			VkCommandBuffer cmdBuffer,
+			Texture& texture,
+			const uint32_t residentMip
+		);
+		// the old image is destroyed once the submission being recorded
+		// finished. on a full bindless heap the image is dropped and
+		// swapping stops until an index frees up, a first load is retried
+		// after that
+		void swapImage(
+			Texture& texture, const Image& image, const uint32_t residentMip
+		);
+		void cmdEvict();
+		// the defragmenter's canMove, reserves an index for the moved image.
+		// a texture isn't moved while the heap has none free
+		bool reserveMovedIndex(const TextureHandle texture);
+		// the defragmenter's onMoved, points the texture at the moved image
+		void onTextureMoved(
+			const TextureHandle texture,
+			const Image& moved,
+			const uint64_t retireValue
+		);
+
+		// the submission being recorded, begun on first use
+		VkCommandBuffer getCommandBuffer();
+
+		// highest residentMip, the coarsest levels always stay resident
+		uint32_t getMaxResidentMip(const Texture& texture) const;
+
+		const VulkanContext& m_Ctx;
+		AsyncUploader& m_Uploader;
+		vkcore::BindlessHeap& m_Heap;
+		Defragmenter& m_Defragmenter;
+		vkutils::TimelineQueue& m_GraphicsQueue;
+		TextureStreamerSettings m_Settings;
+
+		Image m_FallbackImage;
+		uint32_t m_FallbackIndex;
+		VkSampler m_Sampler;
+		uint32_t m_SamplerIndex;
+
+		std::vector<Texture> m_Textures;
+		std::vector<PendingTexture> m_Pending;
+		VkDeviceSize m_ResidentBytes{};
+		uint64_t m_FrameNumber{};
+		// below the settings' budget while memory is shed
+		VkDeviceSize m_Budget;
+		uint64_t m_LastShedFrame{};
+
+		// a swap found the bindless heap full, trims and promotions wait
+		// until it has room
+		bool m_HeapFull{};
+
+		VkCommandPool m_CmdPool;
+		// null until update records something
+		VkCommandBuffer m_CmdBuffer{};
+		std::vector<VkCommandBuffer> m_FreeCmdBuffers;
+		// oldest first
+		std::deque<InFlightCmdBuffer> m_InFlightCmdBuffers;
+		// keyed on the graphics timeline
+		DeferredDeletionQueue m_DeletionQueue;
+
+		std::vector<std::thread> m_DecodeThreads;
+		std::mutex m_Mutex;
+		std::condition_variable m_RequestAvailable;
+		std::deque<DecodeRequest> m_Requests;
+		std::deque<DecodedImage> m_Decoded;
+		bool m_Stopping{};
+	};
+}  // namespace VulkanRenderer
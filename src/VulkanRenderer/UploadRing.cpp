@@ -0,0 +1,105 @@
+#include "RendererPCH.h"
+
+#include "UploadRing.h"
+
+#include "debug/Debug.h"
+
+#include "Cleanup.h"
+#include "Context.h"
+
+#include <algorithm>
+
+namespace {
+	VkDeviceSize
+		alignUp(const VkDeviceSize value, const VkDeviceSize alignment);
+}  // namespace
+
+VulkanRenderer::UploadRing VulkanRenderer::createUploadRing(
+	const VulkanContext& ctx,
+	const VkDeviceSize regionSize,
+	const uint32_t regionCount,
+	DeletionQueue& deletionQueue
+) {
+	const VkPhysicalDeviceLimits& limits{ ctx.device.properties.limits };
+
+	// alignments are powers of two, the largest is a multiple of the rest
+	UploadRing ring{
+		.alignment = std::max(
+			{ limits.minUniformBufferOffsetAlignment,
+			  limits.minStorageBufferOffsetAlignment,
+			  (VkDeviceSize)16 }
+		),
+	};
+	ring.regionSize = alignUp(regionSize, ring.alignment);
+
+	VkBufferUsageFlags usage{ VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+							  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+							  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+							  VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+							  VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+							  VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT };
+
+	ring.buffer = createBuffer(
+		ctx,
+		ring.regionSize * regionCount,
+		usage,
+		BufferMemory::upload,
+		MemoryCategory::staging
+	);
+
+	deletionQueue.pushFunction([=, buffer = ring.buffer]() {
+		destroyBuffer(ctx, buffer);
+	});
+
+	return ring;
+}
+
+void VulkanRenderer::beginUploadRingFrame(
+	UploadRing& ring, const uint32_t region
+) {
+	ring.region = region;
+	ring.used = 0;
+}
+
+VulkanRenderer::UploadAllocation
+	VulkanRenderer::allocateUpload(UploadRing& ring, const VkDeviceSize size) {
+	VkDeviceSize alignedSize{ alignUp(size, ring.alignment) };
+	if (ring.used + alignedSize > ring.regionSize) {
+		logWarning("upload ring region is full, ", size, " bytes dropped");
+		return {};
+	}
+
+	VkDeviceSize offset{ ring.region * ring.regionSize + ring.used };
+	ring.used += alignedSize;
+
+	return UploadAllocation{
+		.mapped = (char*)ring.buffer.mapped + offset,
+		.buffer = ring.buffer.handle,
+		.offset = offset,
+		.size = size,
+		.address = ring.buffer.address + offset,
+	};
+}
+
+void VulkanRenderer::flushUploadRing(
+	const VulkanContext& ctx, const UploadRing& ring
+) {
+	if (ring.used == 0) {
+		return;
+	}
+
+	// no-op on coherent memory
+	CHECK_VK_FATAL(vmaFlushAllocation(
+		ctx.allocator,
+		ring.buffer.allocation,
+		ring.region * ring.regionSize,
+		ring.used
+	));
+}
+
+namespace {
+	VkDeviceSize
+		alignUp(const VkDeviceSize value, const VkDeviceSize alignment) {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+}  // namespace
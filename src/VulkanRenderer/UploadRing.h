@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+#include "Buffer.h"
+
+// forward declerations
+struct VulkanContext;
+class DeletionQueue;
+
+namespace VulkanRenderer {
+	// one persistently mapped buffer split into a region per frame in
+	// flight. a frame allocates linearly from its region, which is reused
+	// once the frame retires, so allocating never maps or allocates memory.
+	// not thread safe, allocate while building the frame and not from pass
+	// callbacks
+	struct UploadRing {
+		Buffer buffer;
+		VkDeviceSize regionSize;
+		// satisfies uniform and storage buffer offsets, including dynamic
+		// ones
+		VkDeviceSize alignment;
+
+		uint32_t region;
+		// from the start of region
+		VkDeviceSize used;
+	};
+
+	struct UploadAllocation {
+		// null when the frame's region is full
+		void* mapped;
+
+		VkBuffer buffer;
+		// from the start of buffer, also the dynamic offset of a descriptor
+		// bound to the start of buffer
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		VkDeviceAddress address;
+	};
+
+	// usable as uniform, storage, vertex, index and indirect buffers and
+	// through device addresses
+	UploadRing createUploadRing(
+		const VulkanContext& ctx,
+		const VkDeviceSize regionSize,
+		const uint32_t regionCount,
+		DeletionQueue& deletionQueue
+	);
+
+	// drops everything allocated from region, whose last frame has to have
+	// retired
+	void beginUploadRingFrame(UploadRing& ring, const uint32_t region);
+
+	UploadAllocation allocateUpload(UploadRing& ring, const VkDeviceSize size);
+
+	template<typename T>
+	UploadAllocation
+		pushUpload(UploadRing& ring, const std::span<const T> data) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		UploadAllocation allocation{ allocateUpload(ring, data.size_bytes()) };
+		if (allocation.mapped) {
+			std::memcpy(allocation.mapped, data.data(), data.size_bytes());
+		}
+
+		return allocation;
+	}
+
+	template<typename T>
+	UploadAllocation pushUpload(UploadRing& ring, const T& value) {
+		return pushUpload(ring, std::span<const T>{ &value, 1 });
+	}
+
+	// makes the frame's writes visible to its submission when the memory
+	// isn't host coherent, call once before submitting
+	void flushUploadRing(const VulkanContext& ctx, const UploadRing& ring);
+}  // namespace VulkanRenderer
@@ -0,0 +1,422 @@
+#include "RendererPCH.h"
+
+#include "WorkgroupTuner.h"
+
+#include "Context.h"
+#include "debug/Debug.h"
+#include "utils/CpuProfiler.h"
+#include "utils/Hash.h"
+#include "vkcore/ObjectRegistry.h"
+#include "vkutils/Commands.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+using namespace VulkanRenderer;
+
+namespace {
+	constexpr std::array<WorkgroupSize, 12> CANDIDATE_SIZES{ {
+		{ 8, 4 },
+		{ 8, 8 },
+		{ 16, 8 },
+		{ 8, 16 },
+		{ 16, 16 },
+		{ 32, 8 },
+		{ 32, 16 },
+		{ 16, 32 },
+		{ 32, 32 },
+		{ 64, 2 },
+		{ 64, 4 },
+		{ 64, 8 },
+	} };
+
+	// the first dispatches of a pipeline pay for cold caches and clocks
+	constexpr uint32_t WARMUP_DISPATCHES{ 2 };
+	constexpr uint32_t TIMED_DISPATCHES{ 8 };
+
+	// everything the winner depends on, one cache line per key
+	std::string getCacheKey(
+		const VulkanContext& ctx, const WorkgroupTuneInfo& info
+	);
+
+	bool readCachedSize(
+		const std::filesystem::path& cachePath,
+		const std::string& key,
+		WorkgroupSize* outSize
+	);
+	void writeCachedSize(
+		const std::filesystem::path& cachePath,
+		const std::string& key,
+		const WorkgroupSize size
+	);
+
+	VkPipeline acquireTunedPipeline(
+		const VulkanContext& ctx,
+		vkcore::ObjectRegistry& registry,
+		const WorkgroupTunerSettings& settings,
+		const WorkgroupTuneInfo& info,
+		const WorkgroupSize size
+	);
+
+	bool isWithinLimits(const VulkanContext& ctx, const WorkgroupSize size);
+	uint32_t getTimestampValidBits(
+		const VulkanContext& ctx, const uint32_t queueFamilyIndex
+	);
+
+	void cmdComputeWriteBarrier(const VkCommandBuffer cmdBuffer);
+}  // namespace
+
+WorkgroupTuneResult VulkanRenderer::tuneWorkgroupSize(
+	const VulkanContext& ctx,
+	vkcore::ObjectRegistry& registry,
+	const WorkgroupTunerSettings& settings,
+	const WorkgroupTuneInfo& info
+) {
+	CPU_ZONE("tuneWorkgroupSize");
+
+	const std::string key{ getCacheKey(ctx, info) };
+
+	WorkgroupSize cachedSize{};
+	if (!settings.retune && !settings.cachePath.empty() &&
+		readCachedSize(settings.cachePath, key, &cachedSize) &&
+		isWithinLimits(ctx, cachedSize)) {
+		return { .size = cachedSize,
+				 .pipeline = acquireTunedPipeline(
+					 ctx, registry, settings, info, cachedSize
+				 ) };
+	}
+
+	const uint32_t validBits{
+		getTimestampValidBits(ctx, settings.queueFamilyIndex)
+	};
+	if (validBits == 0) {
+		logWarning("can't time workgroup sizes, timestamps are unsupported");
+		return { .size = DEFAULT_WORKGROUP_SIZE,
+				 .pipeline = acquireTunedPipeline(
+					 ctx, registry, settings, info, DEFAULT_WORKGROUP_SIZE
+				 ) };
+	}
+	const uint64_t timestampMask{
+		validBits >= 64 ? std::numeric_limits<uint64_t>::max()
+						: (uint64_t{ 1 } << validBits) - 1
+	};
+
+	std::vector<WorkgroupSize> candidates;
+	for (const auto& size : CANDIDATE_SIZES) {
+		if (isWithinLimits(ctx, size)) {
+			candidates.emplace_back(size);
+		}
+	}
+
+	// every candidate compiles its own pipeline, the winner's is handed to
+	// the caller
+	std::vector<VkPipeline> pipelines;
+	for (const auto& size : candidates) {
+		pipelines.emplace_back(
+			acquireTunedPipeline(ctx, registry, settings, info, size)
+		);
+	}
+
+	const uint32_t queryCount{ (uint32_t)candidates.size() * 2 };
+	VkQueryPoolCreateInfo queryPoolInfo{
+		.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+		.queryType = VK_QUERY_TYPE_TIMESTAMP,
+		.queryCount = queryCount,
+	};
+	VkQueryPool queryPool{};
+	if (vkCreateQueryPool(
+			ctx.device.logical, &queryPoolInfo, nullptr, &queryPool
+		) != VK_SUCCESS) {
+		logFatal("could not create timestamp query pool");
+	}
+	vkResetQueryPool(ctx.device.logical, queryPool, 0, queryCount);
+
+	VkCommandPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+				 VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = settings.queueFamilyIndex,
+	};
+	VkCommandPool cmdPool{};
+	if (vkCreateCommandPool(
+			ctx.device.logical, &poolCreateInfo, nullptr, &cmdPool
+		) != VK_SUCCESS) {
+		logFatal("could not create workgroup tuner command pool");
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+		.commandPool = cmdPool,
+		.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+		.commandBufferCount = 1,
+	};
+	VkCommandBuffer cmdBuffer{};
+	CHECK_VK_FATAL(
+		vkAllocateCommandBuffers(ctx.device.logical, &allocInfo, &cmdBuffer)
+	);
+	VkFence fence{ vkutils::createFence(ctx, 0) };
+
+	vkutils::immediateSubmit(
+		ctx, cmdBuffer, settings.queue, fence, [&]() {
+			if (info.prepare) {
+				info.prepare(cmdBuffer);
+			}
+
+			for (uint32_t i{}; i < candidates.size(); i++) {
+				if (pipelines[i] == VK_NULL_HANDLE) {
+					continue;
+				}
+
+				vkCmdBindPipeline(
+					cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[i]
+				);
+
+				for (uint32_t j{}; j < WARMUP_DISPATCHES; j++) {
+					info.record(cmdBuffer, candidates[i]);
+					cmdComputeWriteBarrier(cmdBuffer);
+				}
+
+				vkCmdWriteTimestamp2(
+					cmdBuffer,
+					VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+					queryPool,
+					i * 2
+				);
+				for (uint32_t j{}; j < TIMED_DISPATCHES; j++) {
+					info.record(cmdBuffer, candidates[i]);
+					cmdComputeWriteBarrier(cmdBuffer);
+				}
+				vkCmdWriteTimestamp2(
+					cmdBuffer,
+					VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+					queryPool,
+					i * 2 + 1
+				);
+			}
+		}
+	);
+	vkDestroyFence(ctx.device.logical, fence, nullptr);
+	vkDestroyCommandPool(ctx.device.logical, cmdPool, nullptr);
+
+	std::vector<uint64_t> timestamps(queryCount);
+	std::vector<bool> written(candidates.size());
+	for (uint32_t i{}; i < candidates.size(); i++) {
+		written[i] = pipelines[i] != VK_NULL_HANDLE;
+		if (!written[i]) {
+			continue;
+		}
+
+		if (vkGetQueryPoolResults(
+				ctx.device.logical,
+				queryPool,
+				i * 2,
+				2,
+				sizeof(uint64_t) * 2,
+				timestamps.data() + i * 2,
+				sizeof(uint64_t),
+				VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT
+			) != VK_SUCCESS) {
+			written[i] = false;
+		}
+	}
+	vkDestroyQueryPool(ctx.device.logical, queryPool, nullptr);
+
+	const double msPerTick{
+		ctx.device.properties.limits.timestampPeriod / 1e6
+	};
+
+	const uint32_t noWinner{ (uint32_t)candidates.size() };
+	uint32_t best{ noWinner };
+	uint64_t bestTicks{ std::numeric_limits<uint64_t>::max() };
+	for (uint32_t i{}; i < candidates.size(); i++) {
+		if (!written[i]) {
+			continue;
+		}
+
+		const uint64_t ticks{
+			(timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask
+		};
+		logInfo(
+			info.kernel,
+			" ",
+			candidates[i].x,
+			"x",
+			candidates[i].y,
+			": ",
+			ticks * msPerTick / TIMED_DISPATCHES,
+			"ms"
+		);
+
+		if (ticks < bestTicks) {
+			bestTicks = ticks;
+			best = i;
+		}
+	}
+
+	for (uint32_t i{}; i < candidates.size(); i++) {
+		if (i != best) {
+			vkcore::releasePipeline(ctx, registry, pipelines[i]);
+		}
+	}
+
+	if (best == noWinner) {
+		logWarning("no workgroup size of ", info.kernel, " could be timed");
+		return { .size = DEFAULT_WORKGROUP_SIZE,
+				 .pipeline = acquireTunedPipeline(
+					 ctx, registry, settings, info, DEFAULT_WORKGROUP_SIZE
+				 ) };
+	}
+
+	if (!settings.cachePath.empty()) {
+		writeCachedSize(settings.cachePath, key, candidates[best]);
+	}
+
+	return { .size = candidates[best], .pipeline = pipelines[best] };
+}
+
+std::array<vkcore::SpecializationConstant, 2>
+	VulkanRenderer::getWorkgroupSizeConstants(const WorkgroupSize size) {
+	return { {
+		{ .id = WORKGROUP_SIZE_X_CONSTANT_ID, .value = size.x },
+		{ .id = WORKGROUP_SIZE_Y_CONSTANT_ID, .value = size.y },
+	} };
+}
+
+uint32_t VulkanRenderer::getGroupCount(
+	const uint32_t extent, const uint32_t groupSize
+) {
+	return (extent + groupSize - 1) / groupSize;
+}
+
+namespace {
+	std::string getCacheKey(
+		const VulkanContext& ctx, const WorkgroupTuneInfo& info
+	) {
+		const VkPhysicalDeviceProperties& properties{ ctx.device.properties };
+
+		std::ostringstream key;
+		key << std::hex << properties.vendorID << " " << properties.deviceID
+			<< " " << properties.driverVersion << " " << hashBytes(info.spv)
+			<< " " << info.kernel;
+
+		return key.str();
+	}
+
+	// lines are "<key> <x> <y>"
+	bool readCachedSize(
+		const std::filesystem::path& cachePath,
+		const std::string& key,
+		WorkgroupSize* outSize
+	) {
+		std::ifstream file(cachePath);
+
+		std::string line;
+		while (std::getline(file, line)) {
+			if (line.size() <= key.size() || line.compare(0, key.size(), key) ||
+				line[key.size()] != ' ') {
+				continue;
+			}
+
+			std::istringstream values(line.substr(key.size()));
+			WorkgroupSize size{};
+			if (values >> size.x >> size.y && size.x > 0 && size.y > 0) {
+				*outSize = size;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void writeCachedSize(
+		const std::filesystem::path& cachePath,
+		const std::string& key,
+		const WorkgroupSize size
+	) {
+		// keeps the winners of other devices and kernels
+		std::vector<std::string> lines;
+		{
+			std::ifstream file(cachePath);
+
+			std::string line;
+			while (std::getline(file, line)) {
+				bool sameKey{ line.size() > key.size() &&
+							  line.compare(0, key.size(), key) == 0 &&
+							  line[key.size()] == ' ' };
+				if (!line.empty() && !sameKey) {
+					lines.emplace_back(std::move(line));
+				}
+			}
+		}
+
+		std::ofstream file(cachePath, std::ios::trunc);
+		if (!file) {
+			logWarning("could not write workgroup sizes to ", cachePath);
+			return;
+		}
+
+		for (const auto& line : lines) {
+			file << line << "\n";
+		}
+		file << key << " " << std::dec << size.x << " " << size.y << "\n";
+	}
+
+	VkPipeline acquireTunedPipeline(
+		const VulkanContext& ctx,
+		vkcore::ObjectRegistry& registry,
+		const WorkgroupTunerSettings& settings,
+		const WorkgroupTuneInfo& info,
+		const WorkgroupSize size
+	) {
+		return vkcore::acquireComputePipeline(
+			ctx,
+			registry,
+			info.stage,
+			info.layout,
+			getWorkgroupSizeConstants(size),
+			settings.pipelineCache
+		);
+	}
+
+	bool isWithinLimits(const VulkanContext& ctx, const WorkgroupSize size) {
+		const VkPhysicalDeviceLimits& limits{ ctx.device.properties.limits };
+
+		return size.x <= limits.maxComputeWorkGroupSize[0] &&
+			   size.y <= limits.maxComputeWorkGroupSize[1] &&
+			   size.x * size.y <= limits.maxComputeWorkGroupInvocations;
+	}
+
+	uint32_t getTimestampValidBits(
+		const VulkanContext& ctx, const uint32_t queueFamilyIndex
+	) {
+		uint32_t familyCount{};
+		vkGetPhysicalDeviceQueueFamilyProperties(
+			ctx.device.physical, &familyCount, nullptr
+		);
+		std::vector<VkQueueFamilyProperties> familyProperties(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(
+			ctx.device.physical, &familyCount, familyProperties.data()
+		);
+
+		return familyProperties[queueFamilyIndex].timestampValidBits;
+	}
+
+	void cmdComputeWriteBarrier(const VkCommandBuffer cmdBuffer) {
+		VkMemoryBarrier2 barrier{
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+			.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+			.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		};
+
+		VkDependencyInfo dependencyInfo{
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.memoryBarrierCount = 1,
+			.pMemoryBarriers = &barrier,
+		};
+		vkCmdPipelineBarrier2(cmdBuffer, &dependencyInfo);
+	}
+}  // namespace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <string>
+
+#include "vkcore/ShaderLayout.h"
+
+// forward declerations
+struct VulkanContext;
+
+namespace VulkanRenderer {
+	// tunable kernels declare their workgroup size with these ids, as in
+	// layout (local_size_x_id = 0, local_size_y_id = 1) in;
+	constexpr uint32_t WORKGROUP_SIZE_X_CONSTANT_ID{ 0 };
+	constexpr uint32_t WORKGROUP_SIZE_Y_CONSTANT_ID{ 1 };
+
+	struct WorkgroupSize {
+		uint32_t x;
+		uint32_t y;
+	};
+
+	constexpr WorkgroupSize DEFAULT_WORKGROUP_SIZE{ .x = 16, .y = 16 };
+
+	struct WorkgroupTunerSettings {
+		VkPipelineCache pipelineCache;
+
+		// the queue frames dispatch the kernel on, the benchmark is
+		// submitted there and waited on
+		VkQueue queue;
+		uint32_t queueFamilyIndex;
+
+		// winners per device, driver and kernel binary. empty benchmarks
+		// every start
+		std::filesystem::path cachePath;
+		// benchmarks even when the cache has a winner
+		bool retune;
+	};
+
+	struct WorkgroupTuneInfo {
+		// names the kernel in the cache
+		std::string kernel;
+		std::span<const char> spv;
+
+		VkPipelineShaderStageCreateInfo stage;
+		VkPipelineLayout layout;
+
+		// recorded once before the first dispatch, transitions images
+		std::function<void(VkCommandBuffer cmdBuffer)> prepare;
+		// binds everything but the pipeline and dispatches the kernel over
+		// its whole problem
+		std::function<void(VkCommandBuffer cmdBuffer, const WorkgroupSize size)>
+			record;
+	};
+
+	struct WorkgroupTuneResult {
+		WorkgroupSize size;
+		// built with size, the caller releases it from the registry
+		VkPipeline pipeline;
+	};
+
+	// benchmarks candidate sizes within the device limits and returns the
+	// fastest, or the cached winner. falls back to DEFAULT_WORKGROUP_SIZE
+	// when the queue can't write timestamps
+	WorkgroupTuneResult tuneWorkgroupSize(
+		const VulkanContext& ctx,
+		vkcore::ObjectRegistry& registry,
+		const WorkgroupTunerSettings& settings,
+		const WorkgroupTuneInfo& info
+	);
+
+	std::array<vkcore::SpecializationConstant, 2>
+		getWorkgroupSizeConstants(const WorkgroupSize size);
+
+	// groups needed to cover extent, rounded up
+	uint32_t getGroupCount(const uint32_t extent, const uint32_t groupSize);
+}  // namespace VulkanRenderer
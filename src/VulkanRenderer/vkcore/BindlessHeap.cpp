@@ -0,0 +1,337 @@
+#include "VulkanRenderer/RendererPCH.h"
+#include "BindlessHeap.h"
+
+#include "VulkanRenderer/Context.h"
+#include "VulkanRenderer/Shader.h"
+#include "debug/Debug.h"
+#include "ObjectRegistry.h"
+
+#include <algorithm>
+
+using namespace vkcore;
+
+namespace {
+	// what the heap asks for before clamping to the device's limits
+	constexpr std::array<uint32_t, BINDLESS_TYPE_COUNT>
+		DESIRED_BINDLESS_CAPACITIES{ 1024, 16384, 64, 8192 };
+
+	constexpr std::array<VkDescriptorType, BINDLESS_TYPE_COUNT>
+		BINDLESS_DESCRIPTOR_TYPES{
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+			VK_DESCRIPTOR_TYPE_SAMPLER,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+		};
+
+	std::array<uint32_t, BINDLESS_TYPE_COUNT>
+		getBindlessCapacities(const VulkanContext& ctx);
+
+	uint32_t allocateIndex(BindlessHeap& heap, const BindlessType type);
+
+	void writeDescriptor(
+		const VulkanContext& ctx,
+		const BindlessHeap& heap,
+		const BindlessType type,
+		const uint32_t index,
+		const VkDescriptorImageInfo* imageInfo,
+		const VkDescriptorBufferInfo* bufferInfo
+	);
+}  // namespace
+
+BindlessHeap vkcore::createBindlessHeap(
+	const VulkanContext& ctx, DeletionQueue& deletionQueue
+) {
+	BindlessHeap heap{ .capacities = getBindlessCapacities(ctx) };
+
+	std::array<VkDescriptorSetLayoutBinding, BINDLESS_TYPE_COUNT> bindings{};
+	std::array<VkDescriptorBindingFlags, BINDLESS_TYPE_COUNT> bindingFlags{};
+	std::array<VkDescriptorPoolSize, BINDLESS_TYPE_COUNT> poolSizes{};
+
+	for (uint32_t i{}; i < BINDLESS_TYPE_COUNT; i++) {
+		bindings[i] = {
+			.binding = i,
+			.descriptorType = BINDLESS_DESCRIPTOR_TYPES[i],
+			.descriptorCount = heap.capacities[i],
+			.stageFlags = VK_SHADER_STAGE_ALL,
+		};
+
+		// unregistered slots are never written, in flight frames may still
+		// read other slots while new ones are registered
+		bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+			VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+		poolSizes[i] = {
+			.type = BINDLESS_DESCRIPTOR_TYPES[i],
+			.descriptorCount = heap.capacities[i],
+		};
+	}
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{
+		.sType =
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+		.bindingCount = (uint32_t)bindingFlags.size(),
+		.pBindingFlags = bindingFlags.data(),
+	};
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+		.pNext = &bindingFlagsInfo,
+		.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+		.bindingCount = (uint32_t)bindings.size(),
+		.pBindings = bindings.data(),
+	};
+
+	if (vkCreateDescriptorSetLayout(
+			ctx.device.logical, &layoutInfo, nullptr, &heap.layout
+		) != VK_SUCCESS) {
+		logFatal("could not create bindless set layout");
+	}
+
+	VkDescriptorPoolCreateInfo poolInfo{
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+		.maxSets = 1,
+		.poolSizeCount = (uint32_t)poolSizes.size(),
+		.pPoolSizes = poolSizes.data(),
+	};
+
+	if (vkCreateDescriptorPool(
+			ctx.device.logical, &poolInfo, nullptr, &heap.pool
+		) != VK_SUCCESS) {
+		logFatal("could not create bindless descriptor pool");
+	}
+
+	heap.set = allocateDescriptorSets(ctx, heap.layout, heap.pool);
+
+	deletionQueue.pushFunction([=]() {
+		vkDestroyDescriptorPool(ctx.device.logical, heap.pool, nullptr);
+		vkDestroyDescriptorSetLayout(ctx.device.logical, heap.layout, nullptr);
+	});
+
+	return heap;
+}
+
+uint32_t vkcore::registerStorageImage(
+	const VulkanContext& ctx, BindlessHeap& heap, const VkImageView view
+) {
+	uint32_t index{ allocateIndex(heap, BindlessType::storageImage) };
+	if (index != BINDLESS_INVALID_INDEX) {
+		updateStorageImage(ctx, heap, index, view);
+	}
+
+	return index;
+}
+
+uint32_t vkcore::registerSampledImage(
+	const VulkanContext& ctx,
+	BindlessHeap& heap,
+	const VkImageView view,
+	const VkImageLayout layout
+) {
+	uint32_t index{ allocateIndex(heap, BindlessType::sampledImage) };
+	if (index != BINDLESS_INVALID_INDEX) {
+		updateSampledImage(ctx, heap, index, view, layout);
+	}
+
+	return index;
+}
+
+uint32_t vkcore::registerSampler(
+	const VulkanContext& ctx, BindlessHeap& heap, const VkSampler sampler
+) {
+	uint32_t index{ allocateIndex(heap, BindlessType::sampler) };
+	if (index == BINDLESS_INVALID_INDEX) {
+		return index;
+	}
+
+	VkDescriptorImageInfo imageInfo{ .sampler = sampler };
+	writeDescriptor(
+		ctx, heap, BindlessType::sampler, index, &imageInfo, nullptr
+	);
+
+	return index;
+}
+
+uint32_t vkcore::registerStorageBuffer(
+	const VulkanContext& ctx,
+	BindlessHeap& heap,
+	const VkBuffer buffer,
+	const VkDeviceSize offset,
+	const VkDeviceSize range
+) {
+	uint32_t index{ allocateIndex(heap, BindlessType::storageBuffer) };
+	if (index == BINDLESS_INVALID_INDEX) {
+		return index;
+	}
+
+	VkDescriptorBufferInfo bufferInfo{
+		.buffer = buffer,
+		.offset = offset,
+		.range = range,
+	};
+	writeDescriptor(
+		ctx, heap, BindlessType::storageBuffer, index, nullptr, &bufferInfo
+	);
+
+	return index;
+}
+
+void vkcore::updateStorageImage(
+	const VulkanContext& ctx,
+	BindlessHeap& heap,
+	const uint32_t index,
+	const VkImageView view
+) {
+	VkDescriptorImageInfo imageInfo{
+		.imageView = view,
+		.imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+	};
+	writeDescriptor(
+		ctx, heap, BindlessType::storageImage, index, &imageInfo, nullptr
+	);
+}
+
+void vkcore::updateSampledImage(
+	const VulkanContext& ctx,
+	BindlessHeap& heap,
+	const uint32_t index,
+	const VkImageView view,
+	const VkImageLayout layout
+) {
+	VkDescriptorImageInfo imageInfo{
+		.imageView = view,
+		.imageLayout = layout,
+	};
+	writeDescriptor(
+		ctx, heap, BindlessType::sampledImage, index, &imageInfo, nullptr
+	);
+}
+
+void vkcore::unregisterBindless(
+	BindlessHeap& heap, const BindlessType type, const uint32_t index
+) {
+	if (index == BINDLESS_INVALID_INDEX) {
+		return;
+	}
+
+	heap.freeIndices[(size_t)type].emplace_back(index);
+}
+
+bool vkcore::isBindlessFull(const BindlessHeap& heap, const BindlessType type) {
+	return heap.freeIndices[(size_t)type].empty() &&
+		   heap.nextIndices[(size_t)type] >= heap.capacities[(size_t)type];
+}
+
+ShaderLayout vkcore::createBindlessShaderLayout(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const BindlessHeap& heap,
+	const ShaderInputInfo& inputInfo,
+	const VkShaderStageFlags stage,
+	DeletionQueue& deletionQueue
+) {
+	// the reflected set is emptied instead of removed so the sets after it
+	// keep their numbers
+	ShaderInputInfo otherSets{ inputInfo };
+	auto& setInfos{ otherSets.layoutInfo.descriptorSetLayoutInfos };
+	if (setInfos.size() <= BINDLESS_SET) {
+		setInfos.resize(BINDLESS_SET + 1);
+	}
+	setInfos[BINDLESS_SET] = {};
+
+	ShaderLayout layout{
+		createShaderLayout(ctx, registry, otherSets, stage, deletionQueue)
+	};
+	layout.shaderDescriptorLayout[BINDLESS_SET] = heap.layout;
+
+	return layout;
+}
+
+void vkcore::cmdBindBindlessHeap(
+	VkCommandBuffer cmdBuffer,
+	const BindlessHeap& heap,
+	const VkPipelineBindPoint bindPoint,
+	const VkPipelineLayout layout
+) {
+	vkCmdBindDescriptorSets(
+		cmdBuffer, bindPoint, layout, BINDLESS_SET, 1, &heap.set, 0, nullptr
+	);
+}
+
+namespace {
+	std::array<uint32_t, BINDLESS_TYPE_COUNT>
+		getBindlessCapacities(const VulkanContext& ctx) {
+		VkPhysicalDeviceVulkan12Properties vulkan12Properties{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+		};
+		VkPhysicalDeviceProperties2 properties{
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+			.pNext = &vulkan12Properties,
+		};
+		vkGetPhysicalDeviceProperties2(ctx.device.physical, &properties);
+
+		const auto& limits{ vulkan12Properties };
+		std::array<uint32_t, BINDLESS_TYPE_COUNT> deviceLimits{
+			limits.maxPerStageDescriptorUpdateAfterBindStorageImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+			limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+		};
+
+		// every binding counts against the per set resource limit
+		uint32_t resourceBudget{
+			limits.maxPerStageUpdateAfterBindResources
+		};
+
+		std::array<uint32_t, BINDLESS_TYPE_COUNT> capacities{};
+		for (size_t i{}; i < BINDLESS_TYPE_COUNT; i++) {
+			capacities[i] = std::min(
+				{ DESIRED_BINDLESS_CAPACITIES[i],
+				  deviceLimits[i],
+				  resourceBudget / (uint32_t)BINDLESS_TYPE_COUNT }
+			);
+		}
+
+		return capacities;
+	}
+
+	uint32_t allocateIndex(BindlessHeap& heap, const BindlessType type) {
+		auto& freeIndices{ heap.freeIndices[(size_t)type] };
+		if (!freeIndices.empty()) {
+			uint32_t index{ freeIndices.back() };
+			freeIndices.pop_back();
+			return index;
+		}
+
+		uint32_t& nextIndex{ heap.nextIndices[(size_t)type] };
+		if (nextIndex >= heap.capacities[(size_t)type]) {
+			logWarning("bindless heap is full, type ", (uint32_t)type);
+			return BINDLESS_INVALID_INDEX;
+		}
+
+		return nextIndex++;
+	}
+
+	void writeDescriptor(
+		const VulkanContext& ctx,
+		const BindlessHeap& heap,
+		const BindlessType type,
+		const uint32_t index,
+		const VkDescriptorImageInfo* imageInfo,
+		const VkDescriptorBufferInfo* bufferInfo
+	) {
+		VkWriteDescriptorSet write{
+			.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+			.dstSet = heap.set,
+			.dstBinding = (uint32_t)type,
+			.dstArrayElement = index,
+			.descriptorCount = 1,
+			.descriptorType = BINDLESS_DESCRIPTOR_TYPES[(size_t)type],
+			.pImageInfo = imageInfo,
+			.pBufferInfo = bufferInfo,
+		};
+
+		vkUpdateDescriptorSets(ctx.device.logical, 1, &write, 0, nullptr);
+	}
+}  // namespace
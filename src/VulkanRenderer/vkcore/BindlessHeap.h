@@ -0,0 +1,119 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <array>
+#include <vector>
+
+#include "ShaderLayout.h"
+
+// forward declerations
+struct VulkanContext;
+class DeletionQueue;
+
+namespace vkcore {
+	struct ShaderInputInfo;
+	struct ObjectRegistry;
+}  // namespace vkcore
+
+namespace vkcore {
+	// bindings of the heap's set, shaders/bindless.glsl has to match
+	enum class BindlessType : uint32_t {
+		storageImage = 0,
+		sampledImage,
+		sampler,
+		storageBuffer,
+
+		count,
+	};
+	constexpr size_t BINDLESS_TYPE_COUNT{ (size_t)BindlessType::count };
+
+	// bindless shaders declare the heap as this set
+	constexpr uint32_t BINDLESS_SET{ 0 };
+	constexpr uint32_t BINDLESS_INVALID_INDEX{ UINT32_MAX };
+
+	// one update after bind set holding every resource that is registered,
+	// shaders get indices into it through push constants. bound once per
+	// command buffer instead of per pass. not thread safe
+	struct BindlessHeap {
+		VkDescriptorPool pool;
+		VkDescriptorSetLayout layout;
+		VkDescriptorSet set;
+
+		// indexed by BindlessType
+		std::array<uint32_t, BINDLESS_TYPE_COUNT> capacities;
+		std::array<uint32_t, BINDLESS_TYPE_COUNT> nextIndices;
+		std::array<std::vector<uint32_t>, BINDLESS_TYPE_COUNT> freeIndices;
+	};
+
+	// capacities are clamped to the device's update after bind limits
+	BindlessHeap createBindlessHeap(
+		const VulkanContext& ctx, DeletionQueue& deletionQueue
+	);
+
+	// return BINDLESS_INVALID_INDEX once the heap is full
+	uint32_t registerStorageImage(
+		const VulkanContext& ctx,
+		BindlessHeap& heap,
+		const VkImageView view
+	);
+	uint32_t registerSampledImage(
+		const VulkanContext& ctx,
+		BindlessHeap& heap,
+		const VkImageView view,
+		const VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	);
+	uint32_t registerSampler(
+		const VulkanContext& ctx, BindlessHeap& heap, const VkSampler sampler
+	);
+	uint32_t registerStorageBuffer(
+		const VulkanContext& ctx,
+		BindlessHeap& heap,
+		const VkBuffer buffer,
+		const VkDeviceSize offset = 0,
+		const VkDeviceSize range = VK_WHOLE_SIZE
+	);
+
+	// points a registered index at another resource. rewriting a
+	// descriptor pending work reads is undefined, callers have to make sure
+	// no submission that may still be executing reads the index
+	void updateStorageImage(
+		const VulkanContext& ctx,
+		BindlessHeap& heap,
+		const uint32_t index,
+		const VkImageView view
+	);
+	void updateSampledImage(
+		const VulkanContext& ctx,
+		BindlessHeap& heap,
+		const uint32_t index,
+		const VkImageView view,
+		const VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+	);
+
+	// the index is handed out again right away, unregistering has to be
+	// deferred until no submitted work reads it
+	void unregisterBindless(
+		BindlessHeap& heap, const BindlessType type, const uint32_t index
+	);
+	// the next register of type returns BINDLESS_INVALID_INDEX
+	bool isBindlessFull(const BindlessHeap& heap, const BindlessType type);
+
+	// like createShaderLayout, with the reflected BINDLESS_SET replaced by
+	// the heap's layout
+	ShaderLayout createBindlessShaderLayout(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const BindlessHeap& heap,
+		const ShaderInputInfo& inputInfo,
+		const VkShaderStageFlags stage,
+		DeletionQueue& deletionQueue
+	);
+
+	void cmdBindBindlessHeap(
+		VkCommandBuffer cmdBuffer,
+		const BindlessHeap& heap,
+		const VkPipelineBindPoint bindPoint,
+		const VkPipelineLayout layout
+	);
+}  // namespace vkcore
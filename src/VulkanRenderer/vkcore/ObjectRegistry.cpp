@@ -0,0 +1,532 @@
+#include "VulkanRenderer/RendererPCH.h"
+#include "ObjectRegistry.h"
+
+#include "VulkanRenderer/Context.h"
+#include "debug/Debug.h"
+#include "utils/Hash.h"
+
+#include <string_view>
+#include <unordered_set>
+
+using namespace vkcore;
+
+namespace {
+	// the key an object was created from. handles of released objects get
+	// reused, so keys made from other objects can't hold their handles
+	template<typename Handle>
+	std::string getObjectKey(
+		ObjectRegistry& registry,
+		const RegistryTable<Handle>& table,
+		const Handle handle
+	);
+
+	// creation runs unlocked, when two threads race for the same key the
+	// loser's object is destroyed and it shares the winner's
+	template<typename Handle, typename Create, typename Destroy>
+	Handle acquireObject(
+		ObjectRegistry& registry,
+		RegistryTable<Handle>& table,
+		std::string&& key,
+		const Create& create,
+		const Destroy& destroy
+	);
+
+	template<typename Handle, typename Destroy>
+	void releaseObject(
+		ObjectRegistry& registry,
+		RegistryTable<Handle>& table,
+		const Handle handle,
+		const Destroy& destroy
+	);
+}  // namespace
+
+VkDescriptorSetLayout vkcore::acquireDescriptorSetLayout(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const DescriptorSetLayoutInfo& layoutInfo,
+	const VkShaderStageFlags stages
+) {
+	std::string key;
+	appendKey(key, stages);
+	for (const auto& binding : layoutInfo) {
+		appendKey(key, binding.binding);
+		appendKey(key, binding.type);
+		appendKey(key, binding.count);
+	}
+
+	auto create{ [&]() {
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		bindings.reserve(layoutInfo.size());
+
+		for (auto& bindingInfo : layoutInfo) {
+			VkDescriptorSetLayoutBinding bindingLayout{
+				.binding = bindingInfo.binding,
+				.descriptorType = bindingInfo.type,
+				.descriptorCount = bindingInfo.count,
+				.stageFlags = stages
+			};
+			bindings.emplace_back(bindingLayout);
+		}
+
+		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.bindingCount = (uint32_t)bindings.size(),
+			.pBindings = bindings.data(),
+		};
+
+		VkDescriptorSetLayout layout{};
+		if (vkCreateDescriptorSetLayout(
+				ctx.device.logical, &descriptorSetLayoutInfo, nullptr, &layout
+			) != VK_SUCCESS) {
+			logFatal("couldnt create descriptor set layout");
+		}
+
+		return layout;
+	} };
+
+	return acquireObject(
+		registry,
+		registry.descriptorSetLayouts,
+		std::move(key),
+		create,
+		[&](VkDescriptorSetLayout layout) {
+			vkDestroyDescriptorSetLayout(ctx.device.logical, layout, nullptr);
+		}
+	);
+}
+
+VkPipelineLayout vkcore::acquirePipelineLayout(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const ShaderLayout& shaderLayout
+) {
+	std::string key;
+	for (const auto& setLayout : shaderLayout.shaderDescriptorLayout) {
+		std::string setKey{
+			getObjectKey(registry, registry.descriptorSetLayouts, setLayout)
+		};
+		appendKey(key, setKey.size());
+		key.append(setKey);
+	}
+	for (const auto& range : shaderLayout.pushConstants) {
+		appendKey(key, range.stageFlags);
+		appendKey(key, range.offset);
+		appendKey(key, range.size);
+	}
+
+	auto create{ [&]() {
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+			.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+			.setLayoutCount =
+				(uint32_t)shaderLayout.shaderDescriptorLayout.size(),
+			.pSetLayouts = shaderLayout.shaderDescriptorLayout.data(),
+			.pushConstantRangeCount =
+				(uint32_t)shaderLayout.pushConstants.size(),
+			.pPushConstantRanges = shaderLayout.pushConstants.data()
+		};
+
+		VkPipelineLayout pipelineLayout{};
+		if (vkCreatePipelineLayout(
+				ctx.device.logical,
+				&pipelineLayoutInfo,
+				nullptr,
+				&pipelineLayout
+			) != VK_SUCCESS) {
+			logWarning("could not create pipeline layout");
+			return VkPipelineLayout{};
+		}
+
+		return pipelineLayout;
+	} };
+
+	return acquireObject(
+		registry,
+		registry.pipelineLayouts,
+		std::move(key),
+		create,
+		[&](VkPipelineLayout layout) {
+			vkDestroyPipelineLayout(ctx.device.logical, layout, nullptr);
+		}
+	);
+}
+
+VkShaderModule vkcore::acquireShaderModule(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const std::span<const char> spv
+) {
+	std::string key;
+	appendKey(key, hashBytes(spv));
+	appendKey(key, spv.size());
+
+	auto create{ [&]() {
+		VkShaderModuleCreateInfo moduleInfo{
+			.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+			.codeSize = spv.size(),
+			.pCode = (const uint32_t*)spv.data(),
+		};
+
+		VkShaderModule shaderModule{};
+		if (vkCreateShaderModule(
+				ctx.device.logical, &moduleInfo, nullptr, &shaderModule
+			) != VK_SUCCESS) {
+			logWarning("could not compile shader");
+			return VkShaderModule{};
+		}
+
+		return shaderModule;
+	} };
+
+	return acquireObject(
+		registry,
+		registry.shaderModules,
+		std::move(key),
+		create,
+		[&](VkShaderModule shaderModule) {
+			vkDestroyShaderModule(ctx.device.logical, shaderModule, nullptr);
+		}
+	);
+}
+
+VkPipeline vkcore::acquireComputePipeline(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const VkPipelineShaderStageCreateInfo& stage,
+	const VkPipelineLayout layout,
+	const std::span<const SpecializationConstant> specializationConstants,
+	const VkPipelineCache pipelineCache
+) {
+	std::string key{
+		getObjectKey(registry, registry.shaderModules, stage.module)
+	};
+
+	std::string layoutKey{
+		getObjectKey(registry, registry.pipelineLayouts, layout)
+	};
+	appendKey(key, layoutKey.size());
+	key.append(layoutKey);
+
+	for (const auto& constant : specializationConstants) {
+		appendKey(key, constant.id);
+		appendKey(key, constant.value);
+	}
+
+	key.append(stage.pName);
+
+	auto create{ [&]() {
+		std::vector<VkSpecializationMapEntry> mapEntries;
+		std::vector<uint32_t> data;
+		for (const auto& constant : specializationConstants) {
+			mapEntries.emplace_back(VkSpecializationMapEntry{
+				.constantID = constant.id,
+				.offset = (uint32_t)(data.size() * sizeof(uint32_t)),
+				.size = sizeof(uint32_t),
+			});
+			data.emplace_back(constant.value);
+		}
+
+		VkSpecializationInfo specializationInfo{
+			.mapEntryCount = (uint32_t)mapEntries.size(),
+			.pMapEntries = mapEntries.data(),
+			.dataSize = data.size() * sizeof(uint32_t),
+			.pData = data.data(),
+		};
+
+		VkComputePipelineCreateInfo pipeInfo{
+			.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+			.stage = stage,
+			.layout = layout,
+		};
+		pipeInfo.stage.pSpecializationInfo =
+			mapEntries.empty() ? nullptr : &specializationInfo;
+
+		VkPipeline pipeline{};
+		if (vkCreateComputePipelines(
+				ctx.device.logical,
+				pipelineCache,
+				1,
+				&pipeInfo,
+				nullptr,
+				&pipeline
+			) != VK_SUCCESS) {
+			logWarning("could not create compute pipelines");
+			return VkPipeline{};
+		}
+
+		return pipeline;
+	} };
+
+	return acquireObject(
+		registry,
+		registry.pipelines,
+		std::move(key),
+		create,
+		[&](VkPipeline pipeline) {
+			vkDestroyPipeline(ctx.device.logical, pipeline, nullptr);
+		}
+	);
+}
+
+std::vector<VkPipeline> vkcore::acquirePipelines(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const std::span<const std::string> keys,
+	const std::function<std::vector<VkPipeline>(
+		std::span<const uint32_t> missingKeys
+	)>& create
+) {
+	RegistryTable<VkPipeline>& table{ registry.pipelines };
+
+	std::vector<VkPipeline> pipelines(keys.size());
+	std::vector<uint32_t> missingKeys;
+	{
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		// a key repeated in the batch is only created once
+		std::unordered_set<std::string_view> missingSet;
+		for (uint32_t i{}; i < keys.size(); i++) {
+			auto handleItt{ table.handles.find(keys[i]) };
+			if (handleItt != table.handles.end()) {
+				table.entries[handleItt->second].refCount++;
+				pipelines[i] = handleItt->second;
+			} else if (missingSet.insert(keys[i]).second) {
+				missingKeys.emplace_back(i);
+			}
+		}
+	}
+
+	if (missingKeys.empty()) {
+		return pipelines;
+	}
+
+	std::vector<VkPipeline> created{ create(missingKeys) };
+	assertFatal(created.size() == missingKeys.size());
+
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for (uint32_t i{}; i < missingKeys.size(); i++) {
+		const std::string& key{ keys[missingKeys[i]] };
+		if (created[i] == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		auto handleItt{ table.handles.find(key) };
+		if (handleItt != table.handles.end()) {
+			vkDestroyPipeline(ctx.device.logical, created[i], nullptr);
+
+			table.entries[handleItt->second].refCount++;
+			pipelines[missingKeys[i]] = handleItt->second;
+			continue;
+		}
+
+		table.handles.emplace(key, created[i]);
+		table.entries.emplace(
+			created[i], RegistryEntry{ .key = key, .refCount = 1 }
+		);
+		pipelines[missingKeys[i]] = created[i];
+	}
+
+	// repeats of a key share the pipeline created for its first use
+	for (uint32_t i{}; i < keys.size(); i++) {
+		if (pipelines[i] != VK_NULL_HANDLE) {
+			continue;
+		}
+
+		auto handleItt{ table.handles.find(keys[i]) };
+		if (handleItt != table.handles.end()) {
+			table.entries[handleItt->second].refCount++;
+			pipelines[i] = handleItt->second;
+		}
+	}
+
+	return pipelines;
+}
+
+std::string vkcore::getShaderModuleKey(
+	ObjectRegistry& registry, const VkShaderModule shaderModule
+) {
+	return getObjectKey(registry, registry.shaderModules, shaderModule);
+}
+
+std::string vkcore::getPipelineLayoutKey(
+	ObjectRegistry& registry, const VkPipelineLayout layout
+) {
+	return getObjectKey(registry, registry.pipelineLayouts, layout);
+}
+
+void vkcore::releaseDescriptorSetLayout(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const VkDescriptorSetLayout layout
+) {
+	releaseObject(
+		registry,
+		registry.descriptorSetLayouts,
+		layout,
+		[&](VkDescriptorSetLayout layout) {
+			vkDestroyDescriptorSetLayout(ctx.device.logical, layout, nullptr);
+		}
+	);
+}
+
+void vkcore::releasePipelineLayout(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const VkPipelineLayout layout
+) {
+	releaseObject(
+		registry,
+		registry.pipelineLayouts,
+		layout,
+		[&](VkPipelineLayout layout) {
+			vkDestroyPipelineLayout(ctx.device.logical, layout, nullptr);
+		}
+	);
+}
+
+void vkcore::releaseShaderModule(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const VkShaderModule shaderModule
+) {
+	releaseObject(
+		registry,
+		registry.shaderModules,
+		shaderModule,
+		[&](VkShaderModule shaderModule) {
+			vkDestroyShaderModule(ctx.device.logical, shaderModule, nullptr);
+		}
+	);
+}
+
+void vkcore::releasePipeline(
+	const VulkanContext& ctx,
+	ObjectRegistry& registry,
+	const VkPipeline pipeline
+) {
+	releaseObject(
+		registry,
+		registry.pipelines,
+		pipeline,
+		[&](VkPipeline pipeline) {
+			vkDestroyPipeline(ctx.device.logical, pipeline, nullptr);
+		}
+	);
+}
+
+void vkcore::destroyObjectRegistry(
+	const VulkanContext& ctx, ObjectRegistry& registry
+) {
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// pipelines first, they were created from everything else
+	for (const auto& [pipeline, entry] : registry.pipelines.entries) {
+		vkDestroyPipeline(ctx.device.logical, pipeline, nullptr);
+	}
+	for (const auto& [layout, entry] : registry.pipelineLayouts.entries) {
+		vkDestroyPipelineLayout(ctx.device.logical, layout, nullptr);
+	}
+	for (const auto& [layout, entry] : registry.descriptorSetLayouts.entries) {
+		vkDestroyDescriptorSetLayout(ctx.device.logical, layout, nullptr);
+	}
+	for (const auto& [shaderModule, entry] : registry.shaderModules.entries) {
+		vkDestroyShaderModule(ctx.device.logical, shaderModule, nullptr);
+	}
+
+	registry.pipelines = {};
+	registry.pipelineLayouts = {};
+	registry.descriptorSetLayouts = {};
+	registry.shaderModules = {};
+}
+
+namespace {
+	template<typename Handle>
+	std::string getObjectKey(
+		ObjectRegistry& registry,
+		const RegistryTable<Handle>& table,
+		const Handle handle
+	) {
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto entryItt{ table.entries.find(handle) };
+		if (entryItt != table.entries.end()) {
+			return entryItt->second.key;
+		}
+
+		// not created through the registry, the handle is all there is
+		std::string key;
+		appendKey(key, handle);
+		return key;
+	}
+
+	template<typename Handle, typename Create, typename Destroy>
+	Handle acquireObject(
+		ObjectRegistry& registry,
+		RegistryTable<Handle>& table,
+		std::string&& key,
+		const Create& create,
+		const Destroy& destroy
+	) {
+		{
+			std::lock_guard<std::mutex> lock(registry.mutex);
+
+			auto handleItt{ table.handles.find(key) };
+			if (handleItt != table.handles.end()) {
+				table.entries[handleItt->second].refCount++;
+				return handleItt->second;
+			}
+		}
+
+		Handle handle{ create() };
+		if (handle == VK_NULL_HANDLE) {
+			return handle;
+		}
+
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto handleItt{ table.handles.find(key) };
+		if (handleItt != table.handles.end()) {
+			destroy(handle);
+
+			table.entries[handleItt->second].refCount++;
+			return handleItt->second;
+		}
+
+		table.handles.emplace(key, handle);
+		table.entries.emplace(
+			handle, RegistryEntry{ .key = std::move(key), .refCount = 1 }
+		);
+
+		return handle;
+	}
+
+	template<typename Handle, typename Destroy>
+	void releaseObject(
+		ObjectRegistry& registry,
+		RegistryTable<Handle>& table,
+		const Handle handle,
+		const Destroy& destroy
+	) {
+		if (handle == VK_NULL_HANDLE) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto entryItt{ table.entries.find(handle) };
+		if (entryItt == table.entries.end()) {
+			logWarning("released an object the registry doesn't own");
+			return;
+		}
+
+		RegistryEntry& entry{ entryItt->second };
+		entry.refCount--;
+		if (entry.refCount > 0) {
+			return;
+		}
+
+		table.handles.erase(entry.key);
+		table.entries.erase(entryItt);
+		destroy(handle);
+	}
+}  // namespace
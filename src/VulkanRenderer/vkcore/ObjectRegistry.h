@@ -0,0 +1,130 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "ShaderLayout.h"
+
+// forward declerations
+struct VulkanContext;
+
+namespace vkcore {
+	struct RegistryEntry {
+		std::string key;
+		uint32_t refCount;
+	};
+
+	// keys are the bytes of everything the object is created from
+	template<typename Handle>
+	struct RegistryTable {
+		std::unordered_map<std::string, Handle> handles;
+		std::unordered_map<Handle, RegistryEntry> entries;
+	};
+
+	// shares identical objects between everyone that creates them. every
+	// acquire returns a reference that has to be released once, the object
+	// is destroyed with its last reference. releasing an object the gpu may
+	// still use has to be deferred by the caller
+	struct ObjectRegistry {
+		// shaders are loaded from worker threads
+		std::mutex mutex;
+
+		RegistryTable<VkDescriptorSetLayout> descriptorSetLayouts;
+		RegistryTable<VkPipelineLayout> pipelineLayouts;
+		// keyed by a hash of the spir-v, not the whole binary
+		RegistryTable<VkShaderModule> shaderModules;
+		RegistryTable<VkPipeline> pipelines;
+	};
+
+	template<typename T>
+	void appendKey(std::string& key, const T& value) {
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		key.append((const char*)&value, sizeof(T));
+	}
+
+	VkDescriptorSetLayout acquireDescriptorSetLayout(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const DescriptorSetLayoutInfo& layoutInfo,
+		const VkShaderStageFlags stages
+	);
+
+	VkPipelineLayout acquirePipelineLayout(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const ShaderLayout& shaderLayout
+	);
+
+	VkShaderModule acquireShaderModule(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const std::span<const char> spv
+	);
+
+	// stage.pSpecializationInfo is ignored, specializationConstants are
+	// part of the key instead
+	VkPipeline acquireComputePipeline(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const VkPipelineShaderStageCreateInfo& stage,
+		const VkPipelineLayout layout,
+		const std::span<const SpecializationConstant> specializationConstants,
+		const VkPipelineCache pipelineCache
+	);
+
+	// pipelines with keys the registry doesn't have yet are created by one
+	// call to create, which gets their indices into keys and returns them in
+	// that order. lets callers batch creation of any kind of pipeline
+	std::vector<VkPipeline> acquirePipelines(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const std::span<const std::string> keys,
+		const std::function<std::vector<VkPipeline>(
+			std::span<const uint32_t> missingKeys
+		)>& create
+	);
+
+	// keys of objects from the registry, to build keys of objects created
+	// from them. handles get reused once released, keys don't
+	std::string getShaderModuleKey(
+		ObjectRegistry& registry, const VkShaderModule shaderModule
+	);
+	std::string getPipelineLayoutKey(
+		ObjectRegistry& registry, const VkPipelineLayout layout
+	);
+
+	// distinct names, non dispatchable handles are all uint64_t on 32 bit
+	void releaseDescriptorSetLayout(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const VkDescriptorSetLayout layout
+	);
+	void releasePipelineLayout(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const VkPipelineLayout layout
+	);
+	void releaseShaderModule(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const VkShaderModule shaderModule
+	);
+	void releasePipeline(
+		const VulkanContext& ctx,
+		ObjectRegistry& registry,
+		const VkPipeline pipeline
+	);
+
+	// destroys whatever is still referenced
+	void destroyObjectRegistry(
+		const VulkanContext& ctx, ObjectRegistry& registry
+	);
+}  // namespace vkcore
@@ -4,29 +4,31 @@
 #include "VulkanRenderer/Context.h"
 #include "debug/Debug.h"
 #include "VulkanRenderer/Shader.h"
+#include "ObjectRegistry.h"
 
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
 
 namespace {
-	std::vector<VkDescriptorPoolSize> createDescriptorPoolSizes(
-		const std::span<const vkcore::DescriptorBindingInfo>& descriptorInfos
-	);
+	// pools double up to this many sets
+	constexpr uint32_t MAX_SETS_PER_POOL{ 4096 };
 
-	std::vector<VkDescriptorPoolSize> createDescriptorPoolSizes(
-		const std::span<const vkcore::DescriptorSetLayoutInfo>& shaderLayoutInfo
+	// a pool with space left, created when there is none
+	VkDescriptorPool getReadyPool(
+		const VulkanContext& ctx, vkcore::DescriptorAllocator& allocator
 	);
-
-	VkDescriptorPool baseCreateDescriptorPool(
+	// sized from the ratios, plus setsPerPool sets of fitBindings
+	VkDescriptorPool createAllocatorPool(
 		const VulkanContext& ctx,
-		const std::span<const VkDescriptorPoolSize>& descriptorSizes,
-		const uint32_t maxSets,
-		DeletionQueue& deletionQueue
+		vkcore::DescriptorAllocator& allocator,
+		const std::span<const vkcore::DescriptorBindingInfo> fitBindings
 	);
 }  // namespace
 
 vkcore::ShaderLayout vkcore::createShaderLayout(
 	const VulkanContext& ctx,
+	ObjectRegistry& registry,
 	const ShaderInputInfo& inputInfo,
 	const VkShaderStageFlags stage,
 	DeletionQueue& deletionQueue
@@ -34,6 +36,7 @@ vkcore::ShaderLayout vkcore::createShaderLayout(
 	std::vector<VkDescriptorSetLayout> descriptorSetLayouts{
 		createDescriptorSetLayouts(
 			ctx,
+			registry,
 			inputInfo.layoutInfo.descriptorSetLayoutInfos,
 			stage,
 			deletionQueue
@@ -48,40 +51,9 @@ vkcore::ShaderLayout vkcore::createShaderLayout(
 	return layout;
 }
 
-VkDescriptorPool vkcore::createDescriptorPool(
-	const VulkanContext& ctx,
-	const std::span<const DescriptorBindingInfo>& descriptorInfos,
-	const uint32_t maxSets,
-	DeletionQueue& deletionQueue
-) {
-	std::vector<VkDescriptorPoolSize> descriptorSizes{
-		createDescriptorPoolSizes(descriptorInfos)
-	};
-	VkDescriptorPool pool{
-		baseCreateDescriptorPool(ctx, descriptorSizes, maxSets, deletionQueue)
-	};
-
-	return pool;
-}
-
-VkDescriptorPool vkcore::createDescriptorPool(
-	const VulkanContext& ctx,
-	const std::span<const DescriptorSetLayoutInfo>& shaderDescriptorInfo,
-	const uint32_t maxSets,
-	DeletionQueue& deletionQueue
-) {
-	std::vector<VkDescriptorPoolSize> descriptorSizes{
-		createDescriptorPoolSizes(shaderDescriptorInfo)
-	};
-	VkDescriptorPool pool{
-		baseCreateDescriptorPool(ctx, descriptorSizes, maxSets, deletionQueue)
-	};
-
-	return pool;
-}
-
 std::vector<VkDescriptorSetLayout> vkcore::createDescriptorSetLayouts(
 	const VulkanContext& ctx,
+	ObjectRegistry& registry,
 	const std::span<const DescriptorSetLayoutInfo>& shaderDescriptorInfo,
 	const VkShaderStageFlags stages,
 	DeletionQueue& deletionQueue
@@ -90,38 +62,14 @@ std::vector<VkDescriptorSetLayout> vkcore::createDescriptorSetLayouts(
 	layouts.reserve(shaderDescriptorInfo.size());
 
 	for (auto& setInfo : shaderDescriptorInfo) {
-		std::vector<VkDescriptorSetLayoutBinding> bindings;
-		bindings.reserve(setInfo.size());
-
-		for (auto& bindingInfo : setInfo) {
-			VkDescriptorSetLayoutBinding bindingLayout{
-				.binding = bindingInfo.binding,
-				.descriptorType = bindingInfo.type,
-				.descriptorCount = bindingInfo.count,
-				.stageFlags = stages
-			};
-			bindings.emplace_back(bindingLayout);
-		}
-
-		VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
-			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
-			.bindingCount = (uint32_t)bindings.size(),
-			.pBindings = bindings.data(),
-		};
-
-		VkDescriptorSetLayout layout{};
-		if (vkCreateDescriptorSetLayout(
-				ctx.device.logical, &descriptorSetLayoutInfo, nullptr, &layout
-			) != VK_SUCCESS) {
-			logFatal("couldnt create descriptor set layout");
-		}
-
-		layouts.emplace_back(layout);
+		layouts.emplace_back(
+			acquireDescriptorSetLayout(ctx, registry, setInfo, stages)
+		);
 	}
 
-	auto deleter{ [=]() {
+	auto deleter{ [=, &registry]() {
 		for (auto& layout : layouts) {
-			vkDestroyDescriptorSetLayout(ctx.device.logical, layout, nullptr);
+			releaseDescriptorSetLayout(ctx, registry, layout);
 		}
 	} };
 	deletionQueue.pushFunction(deleter);
@@ -129,32 +77,50 @@ std::vector<VkDescriptorSetLayout> vkcore::createDescriptorSetLayouts(
 	return layouts;
 }
 
-std::vector<VkDescriptorSet> vkcore::allocateDescriptorSets(
+VkDescriptorSet vkcore::allocateDescriptorSets(
 	const VulkanContext& ctx,
-	const std::span<const VkDescriptorSetLayout>& descriptorSetLayouts,
+	const VkDescriptorSetLayout descriptorSetLayout,
 	const VkDescriptorPool pool
 ) {
 	VkDescriptorSetAllocateInfo allocInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.descriptorPool = pool,
-		.descriptorSetCount = (uint32_t)descriptorSetLayouts.size(),
-		.pSetLayouts = descriptorSetLayouts.data(),
+		.descriptorSetCount = 1,
+		.pSetLayouts = &descriptorSetLayout,
 	};
 
-	std::vector<VkDescriptorSet> sets(descriptorSetLayouts.size());
-	if (vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, sets.data()) !=
+	VkDescriptorSet set{};
+	if (vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, &set) !=
 		VK_SUCCESS) {
 		logFatal("could not create descriptor sets");
 	}
 
-	return sets;
+	return set;
 }
 
-VkDescriptorSet vkcore::allocateDescriptorSets(
+vkcore::DescriptorAllocator vkcore::createDescriptorAllocator(
+	const VulkanContext& ctx,
+	const std::span<const DescriptorPoolRatio>& ratios,
+	const uint32_t initialSets
+) {
+	DescriptorAllocator allocator{
+		.ratios = { ratios.begin(), ratios.end() },
+		.setsPerPool = std::clamp(initialSets, 1u, MAX_SETS_PER_POOL),
+	};
+
+	allocator.readyPools.emplace_back(getReadyPool(ctx, allocator));
+
+	return allocator;
+}
+
+VkDescriptorSet vkcore::allocateDescriptorSet(
 	const VulkanContext& ctx,
+	DescriptorAllocator& allocator,
 	const VkDescriptorSetLayout descriptorSetLayout,
-	const VkDescriptorPool pool
+	const DescriptorSetLayoutInfo& layoutInfo
 ) {
+	VkDescriptorPool pool{ getReadyPool(ctx, allocator) };
+
 	VkDescriptorSetAllocateInfo allocInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
 		.descriptorPool = pool,
@@ -163,63 +129,111 @@ VkDescriptorSet vkcore::allocateDescriptorSets(
 	};
 
 	VkDescriptorSet set{};
-	if (vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, &set) !=
-		VK_SUCCESS) {
-		logFatal("could not create descriptor sets");
+	VkResult res{
+		vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, &set)
+	};
+
+	// the pool can't take this set, retry once in a new one. another ready
+	// pool may be just as full
+	if (res == VK_ERROR_OUT_OF_POOL_MEMORY ||
+		res == VK_ERROR_FRAGMENTED_POOL) {
+		allocator.fullPools.emplace_back(pool);
+
+		pool = createAllocatorPool(ctx, allocator, {});
+		allocInfo.descriptorPool = pool;
+
+		res = vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, &set);
+	}
+
+	// the ratios don't fit the layout, it gets a pool sized for it
+	if (res == VK_ERROR_OUT_OF_POOL_MEMORY ||
+		res == VK_ERROR_FRAGMENTED_POOL) {
+		allocator.fullPools.emplace_back(pool);
+
+		pool = createAllocatorPool(ctx, allocator, layoutInfo);
+		allocInfo.descriptorPool = pool;
+
+		res = vkAllocateDescriptorSets(ctx.device.logical, &allocInfo, &set);
 	}
 
+	if (res != VK_SUCCESS) {
+		logFatal("could not allocate descriptor set: ", res);
+	}
+
+	allocator.readyPools.emplace_back(pool);
+
 	return set;
 }
 
-namespace {
-	std::vector<VkDescriptorPoolSize> createDescriptorPoolSizes(
-		const std::span<const vkcore::DescriptorBindingInfo>& descriptorInfos
-	) {
-		std::vector<VkDescriptorPoolSize> sizes;
-		sizes.reserve(descriptorInfos.size());
-
-		for (const auto& info : descriptorInfos) {
-			VkDescriptorPoolSize descriptorSize{
-				.type = info.type,
-				.descriptorCount = info.count,
-			};
-			sizes.emplace_back(descriptorSize);
-		}
-
-		return sizes;
+void vkcore::resetDescriptorAllocator(
+	const VulkanContext& ctx, DescriptorAllocator& allocator
+) {
+	for (const auto& pool : allocator.readyPools) {
+		CHECK_VK_FATAL(vkResetDescriptorPool(ctx.device.logical, pool, 0));
+	}
+	for (const auto& pool : allocator.fullPools) {
+		CHECK_VK_FATAL(vkResetDescriptorPool(ctx.device.logical, pool, 0));
+		allocator.readyPools.emplace_back(pool);
 	}
 
-	std::vector<VkDescriptorPoolSize> createDescriptorPoolSizes(
-		const std::span<const vkcore::DescriptorSetLayoutInfo>& shaderLayoutInfo
-	) {
-		std::vector<VkDescriptorPoolSize> sizes;
+	allocator.fullPools.clear();
+}
 
-		for (const auto& setInfo : shaderLayoutInfo) {
-			sizes.reserve(setInfo.size());
+void vkcore::destroyDescriptorAllocator(
+	const VulkanContext& ctx, DescriptorAllocator& allocator
+) {
+	for (const auto& pool : allocator.readyPools) {
+		vkDestroyDescriptorPool(ctx.device.logical, pool, nullptr);
+	}
+	for (const auto& pool : allocator.fullPools) {
+		vkDestroyDescriptorPool(ctx.device.logical, pool, nullptr);
+	}
+
+	allocator.readyPools.clear();
+	allocator.fullPools.clear();
+}
 
-			for (auto& info : setInfo) {
-				VkDescriptorPoolSize descriptorSize{
-					.type = info.type,
-					.descriptorCount = info.count,
-				};
-				sizes.emplace_back(descriptorSize);
-			}
+namespace {
+	VkDescriptorPool getReadyPool(
+		const VulkanContext& ctx, vkcore::DescriptorAllocator& allocator
+	) {
+		if (!allocator.readyPools.empty()) {
+			VkDescriptorPool pool{ allocator.readyPools.back() };
+			allocator.readyPools.pop_back();
+			return pool;
 		}
 
-		return sizes;
+		return createAllocatorPool(ctx, allocator, {});
 	}
 
-	VkDescriptorPool baseCreateDescriptorPool(
+	VkDescriptorPool createAllocatorPool(
 		const VulkanContext& ctx,
-		const std::span<const VkDescriptorPoolSize>& descriptorSizes,
-		const uint32_t maxSets,
-		DeletionQueue& deletionQueue
+		vkcore::DescriptorAllocator& allocator,
+		const std::span<const vkcore::DescriptorBindingInfo> fitBindings
 	) {
+		std::vector<VkDescriptorPoolSize> sizes;
+		sizes.reserve(allocator.ratios.size() + fitBindings.size());
+		for (const auto& ratio : allocator.ratios) {
+			sizes.emplace_back(VkDescriptorPoolSize{
+				.type = ratio.type,
+				.descriptorCount = std::max(
+					(uint32_t)(ratio.ratio * allocator.setsPerPool), 1u
+				),
+			});
+		}
+		// sizes of the same type add up
+		for (const auto& binding : fitBindings) {
+			sizes.emplace_back(VkDescriptorPoolSize{
+				.type = binding.type,
+				.descriptorCount = binding.count * allocator.setsPerPool,
+			});
+		}
+
 		VkDescriptorPoolCreateInfo descriptorPoolInfo{
 			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-			.maxSets = maxSets,
-			.poolSizeCount = (uint32_t)descriptorSizes.size(),
-			.pPoolSizes = descriptorSizes.data(),
+			.maxSets = allocator.setsPerPool,
+			.poolSizeCount = (uint32_t)sizes.size(),
+			.pPoolSizes = sizes.data(),
 		};
 
 		VkDescriptorPool pool{};
@@ -229,10 +243,8 @@ namespace {
 			logFatal("couldnt create descriptor pool");
 		}
 
-		auto deleter{ [=]() {
-			vkDestroyDescriptorPool(ctx.device.logical, pool, nullptr);
-		} };
-		deletionQueue.pushFunction(deleter);
+		allocator.setsPerPool =
+			std::min(allocator.setsPerPool * 2, MAX_SETS_PER_POOL);
 
 		return pool;
 	}
@@ -4,6 +4,7 @@
 #include <vector>
 #include <array>
 #include <span>
+#include <string>
 
 #include <vulkan/vulkan.h>
 
@@ -13,6 +14,7 @@ struct VulkanContext;
 namespace vkcore {
 	struct ShaderInputInfo;
 	struct ShaderInfo;
+	struct ObjectRegistry;
 }  // namespace vkcore
 class DeletionQueue;
 
@@ -25,9 +27,21 @@ namespace vkcore {
 
 	using DescriptorSetLayoutInfo = std::vector<DescriptorBindingInfo>;
 
+	struct SpecializationConstantInfo {
+		uint32_t id;
+		std::string name;
+	};
+
+	// only 32 bit scalars, bools are VkBool32 and floats their bits
+	struct SpecializationConstant {
+		uint32_t id;
+		uint32_t value;
+	};
+
 	struct ShaderLayoutInfo {
 		std::vector<DescriptorSetLayoutInfo> descriptorSetLayoutInfos;
 		std::vector<VkPushConstantRange> pushConstantRanges;
+		std::vector<SpecializationConstantInfo> specializationConstants;
 	};
 
 	struct ShaderLayout {
@@ -35,44 +49,71 @@ namespace vkcore {
 		std::vector<VkPushConstantRange> pushConstants{};
 	};
 
+	// descriptors of a type a pool gets for every set it can hold
+	struct DescriptorPoolRatio {
+		VkDescriptorType type;
+		float ratio;
+	};
+
+	// hands out sets from a chain of pools. when every pool is full another
+	// one twice as large is added, pools are kept across resets so steady
+	// use stops creating them. not thread safe
+	struct DescriptorAllocator {
+		std::vector<DescriptorPoolRatio> ratios;
+		uint32_t setsPerPool;
+
+		std::vector<VkDescriptorPool> readyPools;
+		std::vector<VkDescriptorPool> fullPools;
+	};
+
+	// set layouts come from registry, deletionQueue releases them
 	vkcore::ShaderLayout createShaderLayout(
 		const VulkanContext& ctx,
+		ObjectRegistry& registry,
 		const ShaderInputInfo& inputInfo,
 		const VkShaderStageFlags stage,
 		DeletionQueue& deletionQueue
 	);
 
-	VkDescriptorPool createDescriptorPool(
-		const VulkanContext& ctx,
-		const std::span<const DescriptorBindingInfo>& descriptorInfos,
-		const uint32_t maxSets,
-		DeletionQueue& deletionQueue
-	);
-
-	VkDescriptorPool createDescriptorPool(
-		const VulkanContext& ctx,
-		const std::span<const DescriptorSetLayoutInfo>& shaderDescriptorInfo,
-		const uint32_t maxSets,
-		DeletionQueue& deletionQueue
-	);
-
 	std::vector<VkDescriptorSetLayout> createDescriptorSetLayouts(
 		const VulkanContext& ctx,
+		ObjectRegistry& registry,
 		const std::span<const DescriptorSetLayoutInfo>& shaderDescriptorInfo,
 		const VkShaderStageFlags stage,
 		DeletionQueue& deletionQueue
 	);
 
-	std::vector<VkDescriptorSet> allocateDescriptorSets(
+	VkDescriptorSet allocateDescriptorSets(
 		const VulkanContext& ctx,
-		const std::span<const VkDescriptorSetLayout>& descriptorSetLayouts,
+		const VkDescriptorSetLayout descriptorSetLayout,
 		const VkDescriptorPool pool
 	);
 
-	VkDescriptorSet allocateDescriptorSets(
+	DescriptorAllocator createDescriptorAllocator(
 		const VulkanContext& ctx,
+		const std::span<const DescriptorPoolRatio>& ratios,
+		const uint32_t initialSets
+	);
+
+	// layoutInfo holds the bindings of descriptorSetLayout. a set the ratios
+	// don't fit gets a pool sized from them, so allocating never fails for
+	// lack of pool space
+	VkDescriptorSet allocateDescriptorSet(
+		const VulkanContext& ctx,
+		DescriptorAllocator& allocator,
 		const VkDescriptorSetLayout descriptorSetLayout,
-		const VkDescriptorPool pool
+		const DescriptorSetLayoutInfo& layoutInfo
+	);
+
+	// frees every set of the allocator in one call per pool, the gpu has to
+	// be done with all of them
+	void resetDescriptorAllocator(
+		const VulkanContext& ctx, DescriptorAllocator& allocator
+	);
+
+	// pools are added after creation, so they can't be on a deletion queue
+	void destroyDescriptorAllocator(
+		const VulkanContext& ctx, DescriptorAllocator& allocator
 	);
 
 }  // namespace vkcore
@@ -0,0 +1,210 @@
+#include "VulkanRenderer/RendererPCH.h"
+
+#include "Barriers.h"
+
+#include "debug/Debug.h"
+#include "VulkanRenderer/DefaultCreateInfos.h"
+
+vkutils::LayoutAccess vkutils::getLayoutAccess(const VkImageLayout layout) {
+	switch (layout) {
+		case VK_IMAGE_LAYOUT_UNDEFINED:
+		case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+			// presentation is ordered by semaphores
+			return { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+		case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					 VK_ACCESS_2_TRANSFER_READ_BIT };
+		case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+			return { VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+					 VK_ACCESS_2_TRANSFER_WRITE_BIT };
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			return { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+						 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+		case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+			return { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+					 VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+						 VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+		case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		case VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL:
+			return { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+						 VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+					 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+						 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+		case VK_IMAGE_LAYOUT_GENERAL:
+			// only storage images are kept in general
+			return { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					 VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+						 VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+		default:
+			// layouts nothing here uses, callers that know better should go
+			// through an ImageStateTracker
+			return { VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+					 VK_ACCESS_2_MEMORY_READ_BIT |
+						 VK_ACCESS_2_MEMORY_WRITE_BIT };
+	}
+}
+
+VkAccessFlags2 vkutils::getWriteAccess(const VkAccessFlags2 access) {
+	constexpr VkAccessFlags2 writeAccessMask{
+		VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+		VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT |
+		VK_ACCESS_2_MEMORY_WRITE_BIT
+	};
+
+	return access & writeAccessMask;
+}
+
+bool vkutils::syncImageAccess(
+	ImageSyncState& state,
+	const VkPipelineStageFlags2 stages,
+	const VkAccessFlags2 access,
+	const VkImageLayout layout,
+	const bool discardContents,
+	VkImageMemoryBarrier2* outBarrier
+) {
+	*outBarrier = VkImageMemoryBarrier2{
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.dstStageMask = stages,
+		.dstAccessMask = access,
+		.oldLayout = discardContents ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout,
+		.newLayout = layout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+	};
+
+	const VkAccessFlags2 writeAccess{ getWriteAccess(access) };
+	const bool layoutChange{ discardContents || layout != state.layout };
+
+	// writes and layout transitions wait on every earlier use
+	if (layoutChange || writeAccess) {
+		outBarrier->srcStageMask = state.writeStages | state.readStages;
+		outBarrier->srcAccessMask = state.writeAccess;
+
+		bool needsBarrier{ layoutChange ||
+						   outBarrier->srcStageMask != VK_PIPELINE_STAGE_2_NONE };
+
+		// a layout transition counts as a write later reads must see
+		state.writeStages = stages;
+		state.writeAccess = writeAccess;
+		state.readStages = writeAccess ? VK_PIPELINE_STAGE_2_NONE : stages;
+		state.readAccess = writeAccess ? VK_ACCESS_2_NONE : access;
+		state.layout = layout;
+
+		return needsBarrier;
+	}
+
+	// read after read in the same layout, only new stages need a barrier
+	bool alreadyVisible{ (state.readStages & stages) == stages &&
+						 (state.readAccess & access) == access };
+	if (alreadyVisible) {
+		return false;
+	}
+
+	state.readStages |= stages;
+	state.readAccess |= access;
+
+	if (state.writeStages == VK_PIPELINE_STAGE_2_NONE) {
+		return false;
+	}
+
+	outBarrier->srcStageMask = state.writeStages;
+	outBarrier->srcAccessMask = state.writeAccess;
+
+	return true;
+}
+
+void vkutils::trackImage(
+	ImageStateTracker& tracker,
+	const VkImage image,
+	const VkImageAspectFlags aspect,
+	const ImageSyncState& state
+) {
+	tracker.images[image] = TrackedImage{ .aspect = aspect, .state = state };
+}
+
+const vkutils::ImageSyncState& vkutils::getImageState(
+	const ImageStateTracker& tracker, const VkImage image
+) {
+	auto it{ tracker.images.find(image) };
+	assertFatal(it != tracker.images.end(), "image is not tracked");
+
+	return it->second.state;
+}
+
+void vkutils::requestImageAccess(
+	ImageStateTracker& tracker,
+	const VkImage image,
+	const VkPipelineStageFlags2 stages,
+	const VkAccessFlags2 access,
+	const VkImageLayout layout,
+	const bool discardContents
+) {
+	auto it{ tracker.images.find(image) };
+	assertFatal(it != tracker.images.end(), "image is not tracked");
+
+	TrackedImage& trackedImage{ it->second };
+
+	VkImageMemoryBarrier2 barrier{};
+	if (!syncImageAccess(
+			trackedImage.state,
+			stages,
+			access,
+			layout,
+			discardContents,
+			&barrier
+		)) {
+		return;
+	}
+
+	barrier.image = image;
+	barrier.subresourceRange =
+		vkdefaults::subresourceRange(trackedImage.aspect);
+
+	// barriers in one batch are unordered, a second access to the same image
+	// has to be flushed first
+	for (const auto& pendingBarrier : tracker.pendingBarriers) {
+		assertWarning(
+			pendingBarrier.image != image,
+			"image accessed twice without flushing barriers"
+		);
+	}
+
+	tracker.pendingBarriers.emplace_back(barrier);
+}
+
+std::vector<VkImageMemoryBarrier2>
+	vkutils::takePendingBarriers(ImageStateTracker& tracker) {
+	std::vector<VkImageMemoryBarrier2> barriers{
+		std::move(tracker.pendingBarriers)
+	};
+	tracker.pendingBarriers.clear();
+
+	return barriers;
+}
+
+void vkutils::cmdFlushBarriers(
+	ImageStateTracker& tracker, const VkCommandBuffer cmdBuffer
+) {
+	cmdPipelineBarriers(cmdBuffer, tracker.pendingBarriers);
+	tracker.pendingBarriers.clear();
+}
+
+void vkutils::cmdPipelineBarriers(
+	const VkCommandBuffer cmdBuffer,
+	const std::span<const VkImageMemoryBarrier2> imageBarriers
+) {
+	if (imageBarriers.empty()) {
+		return;
+	}
+
+	VkDependencyInfo depInfo{
+		.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+		.imageMemoryBarrierCount = (uint32_t)imageBarriers.size(),
+		.pImageMemoryBarriers = imageBarriers.data(),
+	};
+	vkCmdPipelineBarrier2(cmdBuffer, &depInfo);
+}
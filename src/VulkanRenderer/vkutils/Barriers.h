@@ -0,0 +1,81 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace vkutils {
+	// last accesses to an image since its last write or layout transition
+	struct ImageSyncState {
+		VkPipelineStageFlags2 writeStages{};
+		VkAccessFlags2 writeAccess{};
+		VkPipelineStageFlags2 readStages{};
+		VkAccessFlags2 readAccess{};
+		VkImageLayout layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+	};
+
+	struct TrackedImage {
+		VkImageAspectFlags aspect;
+		ImageSyncState state;
+	};
+
+	// records the state of each image so barriers only wait on the stages
+	// that actually touched it. barriers are batched until flushed
+	struct ImageStateTracker {
+		std::unordered_map<VkImage, TrackedImage> images;
+		std::vector<VkImageMemoryBarrier2> pendingBarriers;
+	};
+
+	// the stages and accesses an image in a layout is usually used with
+	struct LayoutAccess {
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+	};
+	LayoutAccess getLayoutAccess(const VkImageLayout layout);
+
+	VkAccessFlags2 getWriteAccess(const VkAccessFlags2 access);
+
+	// returns false when the access needs no barrier
+	bool syncImageAccess(
+		ImageSyncState& state,
+		const VkPipelineStageFlags2 stages,
+		const VkAccessFlags2 access,
+		const VkImageLayout layout,
+		const bool discardContents,
+		VkImageMemoryBarrier2* outBarrier
+	);
+
+	void trackImage(
+		ImageStateTracker& tracker,
+		const VkImage image,
+		const VkImageAspectFlags aspect,
+		const ImageSyncState& state
+	);
+	const ImageSyncState&
+		getImageState(const ImageStateTracker& tracker, const VkImage image);
+
+	// discardContents transitions from undefined, dropping the contents
+	void requestImageAccess(
+		ImageStateTracker& tracker,
+		const VkImage image,
+		const VkPipelineStageFlags2 stages,
+		const VkAccessFlags2 access,
+		const VkImageLayout layout,
+		const bool discardContents = false
+	);
+
+	std::vector<VkImageMemoryBarrier2>
+		takePendingBarriers(ImageStateTracker& tracker);
+
+	// records every pending barrier in a single vkCmdPipelineBarrier2
+	void cmdFlushBarriers(
+		ImageStateTracker& tracker, const VkCommandBuffer cmdBuffer
+	);
+
+	void cmdPipelineBarriers(
+		const VkCommandBuffer cmdBuffer,
+		const std::span<const VkImageMemoryBarrier2> imageBarriers
+	);
+}  // namespace vkutils
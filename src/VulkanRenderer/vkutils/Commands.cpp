@@ -5,9 +5,64 @@
 #include "Commands.h"
 
 #include "debug/Debug.h"
+#include "VulkanRenderer/Cleanup.h"
 #include "VulkanRenderer/Context.h"
 #include "VulkanRenderer/DefaultCreateInfos.h"
 
+vkutils::CommandBufferPool vkutils::createCommandBufferPool(
+	const VulkanContext& ctx,
+	const uint32_t queueFamilyIndex,
+	DeletionQueue& deletionQueue
+) {
+	VkCommandPoolCreateInfo poolCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = queueFamilyIndex,
+	};
+
+	CommandBufferPool cmdBufferPool{};
+	if (vkCreateCommandPool(
+			ctx.device.logical, &poolCreateInfo, nullptr, &cmdBufferPool.pool
+		) != VK_SUCCESS) {
+		logFatal("could not create command pool");
+	}
+
+	deletionQueue.pushFunction([=, pool = cmdBufferPool.pool]() {
+		vkDestroyCommandPool(ctx.device.logical, pool, nullptr);
+	});
+
+	return cmdBufferPool;
+}
+
+void vkutils::resetCommandBufferPool(
+	const VulkanContext& ctx, CommandBufferPool& cmdBufferPool
+) {
+	CHECK_VK_FATAL(vkResetCommandPool(ctx.device.logical, cmdBufferPool.pool, 0)
+	);
+	cmdBufferPool.used = 0;
+}
+
+VkCommandBuffer vkutils::getCommandBuffer(
+	const VulkanContext& ctx, CommandBufferPool& cmdBufferPool
+) {
+	if (cmdBufferPool.used == cmdBufferPool.buffers.size()) {
+		VkCommandBufferAllocateInfo allocInfo{
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.commandPool = cmdBufferPool.pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+
+		VkCommandBuffer cmdBuffer{};
+		CHECK_VK_FATAL(
+			vkAllocateCommandBuffers(ctx.device.logical, &allocInfo, &cmdBuffer)
+		);
+		cmdBufferPool.buffers.emplace_back(cmdBuffer);
+	}
+
+	return cmdBufferPool.buffers[cmdBufferPool.used++];
+}
+
 void vkutils::immediateSubmit(
 	const VulkanContext& ctx,
 	const VkCommandBuffer cmdBuffer,
@@ -2,10 +2,33 @@
 
 #include <vulkan/vulkan.h>
 #include <functional>
+#include <vector>
 
 struct VulkanContext;
+class DeletionQueue;
 
 namespace vkutils {
+	// primary command buffers for one frame in flight on one queue family.
+	// the whole pool is reset once the frame's last submissions finished
+	struct CommandBufferPool {
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> buffers;
+		uint32_t used;
+	};
+
+	CommandBufferPool createCommandBufferPool(
+		const VulkanContext& ctx,
+		const uint32_t queueFamilyIndex,
+		DeletionQueue& deletionQueue
+	);
+	void resetCommandBufferPool(
+		const VulkanContext& ctx, CommandBufferPool& cmdBufferPool
+	);
+	// allocates more buffers as needed, they are kept across resets
+	VkCommandBuffer getCommandBuffer(
+		const VulkanContext& ctx, CommandBufferPool& cmdBufferPool
+	);
+
 	void immediateSubmit(
 		const VulkanContext& ctx,
 		const VkCommandBuffer cmdBuffer,
@@ -18,6 +18,55 @@ VkSemaphore vkutils::createSemaphore(const VulkanContext& context) {
 	return semaphore;
 }
 
+VkSemaphore vkutils::createTimelineSemaphore(
+	const VulkanContext& context, const uint64_t initialValue
+) {
+	VkSemaphoreTypeCreateInfo semTypeCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = initialValue,
+	};
+	VkSemaphoreCreateInfo semCreateInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &semTypeCreateInfo,
+	};
+
+	VkSemaphore semaphore{};
+	VkResult res{ vkCreateSemaphore(
+		context.device.logical, &semCreateInfo, nullptr, &semaphore
+	) };
+	assertFatal(res == VK_SUCCESS, "could not create timeline semaphore: ", res);
+
+	return semaphore;
+}
+
+uint64_t vkutils::getTimelineValue(
+	const VulkanContext& context, const VkSemaphore timeline
+) {
+	uint64_t value{};
+	CHECK_VK_FATAL(
+		vkGetSemaphoreCounterValue(context.device.logical, timeline, &value)
+	);
+
+	return value;
+}
+
+void vkutils::waitForTimeline(
+	const VulkanContext& context,
+	const VkSemaphore timeline,
+	const uint64_t value
+) {
+	VkSemaphoreWaitInfo waitInfo{
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.semaphoreCount = 1,
+		.pSemaphores = &timeline,
+		.pValues = &value,
+	};
+	CHECK_VK_FATAL(
+		vkWaitSemaphores(context.device.logical, &waitInfo, UINT64_MAX)
+	);
+}
+
 VkFence vkutils::createFence(
 	const VulkanContext& context, const VkFenceCreateFlags& flags
 ) {
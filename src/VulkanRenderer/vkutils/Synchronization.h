@@ -6,7 +6,29 @@
 struct VulkanContext;
 
 namespace vkutils {
+	// a queue paired with a timeline semaphore it signals on every submit
+	struct TimelineQueue {
+		VkQueue queue;
+		uint32_t familyIndex;
+
+		VkSemaphore timeline;
+		// last value a submission to this queue will signal
+		uint64_t value;
+	};
+
 	VkSemaphore createSemaphore(const VulkanContext& context);
+	VkSemaphore createTimelineSemaphore(
+		const VulkanContext& context, const uint64_t initialValue
+	);
+	uint64_t getTimelineValue(
+		const VulkanContext& context, const VkSemaphore timeline
+	);
+	void waitForTimeline(
+		const VulkanContext& context,
+		const VkSemaphore timeline,
+		const uint64_t value
+	);
+
 	VkFence createFence(
 		const VulkanContext& context, const VkFenceCreateFlags& flags
 	);
@@ -0,0 +1,36 @@
+#ifndef BINDLESS_GLSL
+#define BINDLESS_GLSL
+
+// the bindless heap, bindings match vkcore::BindlessType. resources are
+// indexed with indices passed through push constants
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_SET 0
+
+#define BINDLESS_STORAGE_IMAGE_BINDING 0
+#define BINDLESS_SAMPLED_IMAGE_BINDING 1
+#define BINDLESS_SAMPLER_BINDING 2
+#define BINDLESS_STORAGE_BUFFER_BINDING 3
+
+// storage images need a format to be read, so each format gets its own
+// array aliasing the same binding. storage buffers alias the same way, as
+// layout (set = BINDLESS_SET, binding = BINDLESS_STORAGE_BUFFER_BINDING)
+// buffer Block { ... } name[];
+#define BINDLESS_STORAGE_IMAGES(format, name) \
+	layout (set = BINDLESS_SET, binding = BINDLESS_STORAGE_IMAGE_BINDING, \
+			format) uniform image2D name[]
+
+layout (set = BINDLESS_SET, binding = BINDLESS_SAMPLED_IMAGE_BINDING)
+	uniform texture2D bindlessTextures[];
+layout (set = BINDLESS_SET, binding = BINDLESS_SAMPLER_BINDING)
+	uniform sampler bindlessSamplers[];
+
+vec4 sampleBindless(uint textureIndex, uint samplerIndex, vec2 uv) {
+	return texture(
+		sampler2D(bindlessTextures[nonuniformEXT(textureIndex)],
+				  bindlessSamplers[nonuniformEXT(samplerIndex)]),
+		uv
+	);
+}
+
+#endif
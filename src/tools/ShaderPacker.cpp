@@ -0,0 +1,187 @@
+// packs compiled shaders into one archive with their reflected layouts,
+// run by the build after glslc.
+//   ShaderPacker <archive> <shader.spv>...
+
+#include <vulkan/vulkan.h>
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "VulkanRenderer/ShaderArchive.h"
+#include "VulkanRenderer/ShaderReflection.h"
+#include "debug/Debug.h"
+#include "utils/MappedFile.h"
+
+using namespace vkcore;
+
+namespace {
+	// debug instructions, nothing at runtime needs names or source lines
+	constexpr uint32_t SPV_OP_SOURCE_CONTINUED{ 2 };
+	constexpr uint32_t SPV_OP_SOURCE{ 3 };
+	constexpr uint32_t SPV_OP_SOURCE_EXTENSION{ 4 };
+	constexpr uint32_t SPV_OP_NAME{ 5 };
+	constexpr uint32_t SPV_OP_MEMBER_NAME{ 6 };
+	constexpr uint32_t SPV_OP_STRING{ 7 };
+	constexpr uint32_t SPV_OP_LINE{ 8 };
+	constexpr uint32_t SPV_OP_NO_LINE{ 317 };
+	constexpr uint32_t SPV_OP_MODULE_PROCESSED{ 330 };
+
+	constexpr size_t SPV_HEADER_WORDS{ 5 };
+
+	// empty when the binary is malformed. strings stay while anything but
+	// OpLine and OpSource uses them, debugPrintf formats and non-semantic
+	// debug info are strings as well
+	std::vector<char> stripDebugInstructions(const std::span<const char> spv);
+	bool isDebugInstruction(const uint32_t opcode);
+}  // namespace
+
+int main(int argc, char* argv[]) {
+	if (argc < 2) {
+		logWarning("usage: ShaderPacker <archive> <shader.spv>...");
+		return 1;
+	}
+
+	// the archive's inputs point into these
+	std::vector<std::vector<char>> strippedSpvs;
+	std::vector<ShaderArchiveInput> shaders;
+	strippedSpvs.reserve(argc - 2);
+
+	for (int i{ 2 }; i < argc; i++) {
+		std::filesystem::path spvPath{ argv[i] };
+
+		VkShaderStageFlags stage{ getShaderStage(spvPath) };
+		if (!stage) {
+			logWarning("invalid shader extension ", spvPath);
+			return 1;
+		}
+
+		auto file{ MappedFile::open(spvPath) };
+		if (!file) {
+			logWarning("could not open ", spvPath);
+			return 1;
+		}
+
+		// reflected before stripping, names of specialization constants
+		// are debug info
+		ShaderSourceInfo sourceInfo{
+			.file = file,
+			.spv = file->getData(),
+			.stage = stage,
+		};
+		ShaderInputInfo inputInfo{ reflectShader(sourceInfo) };
+
+		strippedSpvs.emplace_back(stripDebugInstructions(sourceInfo.spv));
+		if (strippedSpvs.back().empty()) {
+			logWarning(spvPath, " is not valid spir-v");
+			return 1;
+		}
+
+		shaders.emplace_back(ShaderArchiveInput{
+			.name = spvPath.filename().string(),
+			.spv = strippedSpvs.back(),
+			.stage = stage,
+			.inputInfo = std::move(inputInfo),
+		});
+	}
+
+	if (!writeShaderArchive(argv[1], shaders)) {
+		return 1;
+	}
+
+	return 0;
+}
+
+namespace {
+	std::vector<char> stripDebugInstructions(const std::span<const char> spv
+	) {
+		if (spv.size() % sizeof(uint32_t) != 0 ||
+			spv.size() < SPV_HEADER_WORDS * sizeof(uint32_t)) {
+			return {};
+		}
+
+		std::vector<uint32_t> words(spv.size() / sizeof(uint32_t));
+		std::memcpy(words.data(), spv.data(), spv.size());
+
+		std::vector<uint32_t> stripped(
+			words.begin(), words.begin() + SPV_HEADER_WORDS
+		);
+		stripped.reserve(words.size());
+
+		// validates the binary on the way
+		std::vector<size_t> offsets;
+		std::unordered_set<uint32_t> unusedStrings;
+		size_t offset{ SPV_HEADER_WORDS };
+		while (offset < words.size()) {
+			uint32_t opcode{ words[offset] & 0xffff };
+			uint32_t wordCount{ words[offset] >> 16 };
+			if (wordCount == 0 || offset + wordCount > words.size()) {
+				return {};
+			}
+
+			if (opcode == SPV_OP_STRING) {
+				if (wordCount < 2) {
+					return {};
+				}
+				unusedStrings.insert(words[offset + 1]);
+			}
+
+			offsets.emplace_back(offset);
+			offset += wordCount;
+		}
+
+		// literals that happen to equal a string's id keep it, which is
+		// only ever too much debug info
+		for (size_t start : offsets) {
+			uint32_t opcode{ words[start] & 0xffff };
+			uint32_t wordCount{ words[start] >> 16 };
+			if (isDebugInstruction(opcode)) {
+				continue;
+			}
+
+			for (uint32_t i{ 1 }; i < wordCount; i++) {
+				unusedStrings.erase(words[start + i]);
+			}
+		}
+
+		for (size_t start : offsets) {
+			uint32_t opcode{ words[start] & 0xffff };
+			uint32_t wordCount{ words[start] >> 16 };
+			const bool usedString{ opcode == SPV_OP_STRING &&
+								   !unusedStrings.contains(words[start + 1]) };
+			if (isDebugInstruction(opcode) && !usedString) {
+				continue;
+			}
+
+			stripped.insert(
+				stripped.end(),
+				words.begin() + start,
+				words.begin() + start + wordCount
+			);
+		}
+
+		std::vector<char> bytes(stripped.size() * sizeof(uint32_t));
+		std::memcpy(bytes.data(), stripped.data(), bytes.size());
+
+		return bytes;
+	}
+
+	bool isDebugInstruction(const uint32_t opcode) {
+		switch (opcode) {
+			case SPV_OP_SOURCE_CONTINUED:
+			case SPV_OP_SOURCE:
+			case SPV_OP_SOURCE_EXTENSION:
+			case SPV_OP_NAME:
+			case SPV_OP_MEMBER_NAME:
+			case SPV_OP_STRING:
+			case SPV_OP_LINE:
+			case SPV_OP_NO_LINE:
+			case SPV_OP_MODULE_PROCESSED:
+				return true;
+			default:
+				return false;
+		}
+	}
+}  // namespace
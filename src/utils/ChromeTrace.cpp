@@ -0,0 +1,63 @@
+#include "ChromeTrace.h"
+#include "debug/Debug.h"
+
+#include <fstream>
+#include <iomanip>
+#include <string_view>
+
+namespace {
+	void writeJsonString(std::ofstream& file, std::string_view str);
+}
+
+bool writeChromeTrace(
+	const std::filesystem::path& path,
+	std::span<const TraceEvent> events,
+	std::span<const TraceTrack> tracks
+) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		logWarning("could not open trace file ", path);
+		return false;
+	}
+
+	// timestamps are in microseconds, keep sub microsecond gpu zones
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+
+	bool first{ true };
+	for (const auto& track : tracks) {
+		file << (first ? "" : ",\n");
+		file << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << track.pid
+			 << ",\"tid\":" << track.tid << ",\"args\":{\"name\":";
+		writeJsonString(file, track.name);
+		file << "}}";
+		first = false;
+	}
+
+	for (const auto& event : events) {
+		file << (first ? "" : ",\n");
+		file << "{\"ph\":\"X\",\"name\":";
+		writeJsonString(file, event.name);
+		file << ",\"pid\":" << event.pid << ",\"tid\":" << event.tid
+			 << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs
+			 << "}";
+		first = false;
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
+
+namespace {
+	void writeJsonString(std::ofstream& file, std::string_view str) {
+		file << '"';
+		for (char c : str) {
+			if (c == '"' || c == '\\') {
+				file << '\\';
+			}
+			file << c;
+		}
+		file << '"';
+	}
+}  // namespace
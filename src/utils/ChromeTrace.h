@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <filesystem>
+#include <span>
+#include <string>
+
+// complete ("X") events of the chrome trace format, loadable by
+// chrome://tracing and ui.perfetto.dev
+struct TraceEvent {
+	std::string name;
+	uint32_t pid;
+	uint32_t tid;
+
+	double startUs;
+	double durationUs;
+};
+
+// names the row events with the same pid and tid are drawn in
+struct TraceTrack {
+	std::string name;
+	uint32_t pid;
+	uint32_t tid;
+};
+
+bool writeChromeTrace(
+	const std::filesystem::path& path,
+	std::span<const TraceEvent> events,
+	std::span<const TraceTrack> tracks
+);
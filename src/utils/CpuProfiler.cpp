@@ -0,0 +1,166 @@
+#include "CpuProfiler.h"
+#include "ChromeTrace.h"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+	// per thread, a zone is 24 bytes
+	constexpr uint64_t CPU_ZONE_BUFFER_SIZE{ 1 << 14 };
+
+	constexpr uint32_t CPU_TRACE_PID{ 0 };
+
+	// fields are atomics so a trace can be written while threads record,
+	// zones overwritten mid copy are dropped
+	struct CpuZoneEvent {
+		std::atomic<const char*> name;
+		std::atomic<uint64_t> startNs;
+		std::atomic<uint64_t> endNs;
+	};
+
+	struct CpuZoneBuffer {
+		uint32_t threadId;
+		// guarded by the registry mutex
+		std::string threadName;
+
+		// zones ever written, the ring holds the last CPU_ZONE_BUFFER_SIZE
+		std::atomic<uint64_t> writeIndex;
+		std::array<CpuZoneEvent, CPU_ZONE_BUFFER_SIZE> events;
+	};
+
+	// buffers are never freed so zones of finished threads can be dumped
+	struct CpuProfilerRegistry {
+		std::mutex mutex;
+		std::vector<std::unique_ptr<CpuZoneBuffer>> buffers;
+	};
+
+	thread_local CpuZoneBuffer* t_ZoneBuffer{};
+	const uint64_t s_EpochNs{ CpuProfiler::now() };
+
+	CpuProfilerRegistry& getRegistry();
+	CpuZoneBuffer& getThreadBuffer();
+}  // namespace
+
+void CpuProfiler::recordZone(
+	const char* name, const uint64_t startNs, const uint64_t endNs
+) {
+	CpuZoneBuffer& buffer{ getThreadBuffer() };
+
+	const uint64_t index{ buffer.writeIndex.load(std::memory_order_relaxed) };
+	CpuZoneEvent& event{ buffer.events[index % CPU_ZONE_BUFFER_SIZE] };
+
+	// a reader that sees any of the stores below also sees writeIndex at
+	// index, so it knows this slot is being overwritten
+	std::atomic_thread_fence(std::memory_order_release);
+	event.name.store(name, std::memory_order_relaxed);
+	event.startNs.store(startNs, std::memory_order_relaxed);
+	event.endNs.store(endNs, std::memory_order_relaxed);
+
+	buffer.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const std::string& name) {
+	CpuZoneBuffer& buffer{ getThreadBuffer() };
+
+	std::lock_guard<std::mutex> lock(getRegistry().mutex);
+	buffer.threadName = name;
+}
+
+bool CpuProfiler::writeTrace(const std::filesystem::path& path) {
+	std::vector<TraceEvent> events;
+	std::vector<TraceTrack> tracks;
+	{
+		CpuProfilerRegistry& registry{ getRegistry() };
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		for (const auto& buffer : registry.buffers) {
+			tracks.emplace_back(TraceTrack{
+				.name = buffer->threadName.empty()
+					? "thread " + std::to_string(buffer->threadId)
+					: buffer->threadName,
+				.pid = CPU_TRACE_PID,
+				.tid = buffer->threadId,
+			});
+
+			const uint64_t end{
+				buffer->writeIndex.load(std::memory_order_acquire)
+			};
+			const uint64_t begin{
+				end > CPU_ZONE_BUFFER_SIZE ? end - CPU_ZONE_BUFFER_SIZE : 0
+			};
+
+			struct CopiedZone {
+				uint64_t index;
+				const char* name;
+				uint64_t startNs;
+				uint64_t endNs;
+			};
+			std::vector<CopiedZone> zones;
+			zones.reserve(end - begin);
+			for (uint64_t i{ begin }; i < end; i++) {
+				const CpuZoneEvent& event{
+					buffer->events[i % CPU_ZONE_BUFFER_SIZE]
+				};
+				zones.emplace_back(CopiedZone{
+					.index = i,
+					.name = event.name.load(std::memory_order_relaxed),
+					.startNs = event.startNs.load(std::memory_order_relaxed),
+					.endNs = event.endNs.load(std::memory_order_relaxed),
+				});
+			}
+
+			// the slot of the zone being written when writeIndex was read
+			// again and everything older than the ring may have been torn
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t newEnd{
+				buffer->writeIndex.load(std::memory_order_relaxed)
+			};
+			const uint64_t firstIntact{ newEnd + 1 > CPU_ZONE_BUFFER_SIZE
+											? newEnd + 1 - CPU_ZONE_BUFFER_SIZE
+											: 0 };
+
+			for (const auto& zone : zones) {
+				if (zone.index < firstIntact || zone.startNs < s_EpochNs) {
+					continue;
+				}
+
+				events.emplace_back(TraceEvent{
+					.name = zone.name,
+					.pid = CPU_TRACE_PID,
+					.tid = buffer->threadId,
+					.startUs = (double)(zone.startNs - s_EpochNs) / 1000.0,
+					.durationUs = (double)(zone.endNs - zone.startNs) / 1000.0,
+				});
+			}
+		}
+	}
+
+	return writeChromeTrace(path, events, tracks);
+}
+
+namespace {
+	CpuProfilerRegistry& getRegistry() {
+		// function local so zones recorded during static init find it
+		static CpuProfilerRegistry registry;
+		return registry;
+	}
+
+	CpuZoneBuffer& getThreadBuffer() {
+		if (t_ZoneBuffer) {
+			return *t_ZoneBuffer;
+		}
+
+		CpuProfilerRegistry& registry{ getRegistry() };
+		std::lock_guard<std::mutex> lock(registry.mutex);
+
+		auto buffer{ std::make_unique<CpuZoneBuffer>() };
+		buffer->threadId = (uint32_t)registry.buffers.size();
+		t_ZoneBuffer = buffer.get();
+		registry.buffers.emplace_back(std::move(buffer));
+
+		return *t_ZoneBuffer;
+	}
+}  // namespace
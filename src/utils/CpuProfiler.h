@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+// scoped cpu zones recorded into a ring buffer per thread. recording is a
+// few relaxed stores into the calling thread's buffer, no locks, so it stays
+// enabled in release builds. the rings keep the last zones of every thread
+// and are dumped as a chrome trace on demand.
+// define DISABLE_CPU_PROFILER to compile zones out entirely
+namespace CpuProfiler {
+	inline std::atomic<bool> g_Enabled{ true };
+
+	inline void setEnabled(const bool enabled) {
+		g_Enabled.store(enabled, std::memory_order_relaxed);
+	}
+	inline bool isEnabled() {
+		return g_Enabled.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				   std::chrono::steady_clock::now().time_since_epoch()
+		)
+			.count();
+	}
+
+	// name must outlive the profiler, string literals are expected
+	void recordZone(
+		const char* name, const uint64_t startNs, const uint64_t endNs
+	);
+	void setThreadName(const std::string& name);
+
+	// every thread's buffered zones, pid 0 with a track per thread
+	bool writeTrace(const std::filesystem::path& path);
+
+	class ScopedZone {
+	   public:
+		explicit ScopedZone(const char* name)
+			: m_Name(name), m_Recording(isEnabled()) {
+			if (m_Recording) {
+				m_StartNs = now();
+			}
+		}
+		~ScopedZone() {
+			if (m_Recording) {
+				recordZone(m_Name, m_StartNs, now());
+			}
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	   private:
+		const char* m_Name;
+		bool m_Recording;
+		uint64_t m_StartNs{};
+	};
+}  // namespace CpuProfiler
+
+#define CPU_ZONE_CONCAT_INNER(a, b) a##b
+#define CPU_ZONE_CONCAT(a, b) CPU_ZONE_CONCAT_INNER(a, b)
+
+#ifdef DISABLE_CPU_PROFILER
+	#define CPU_ZONE(name)
+#else
+	#define CPU_ZONE(name) \
+		CpuProfiler::ScopedZone CPU_ZONE_CONCAT(cpuZone, __LINE__) { name }
+#endif
+
+#define CPU_FUNCTION_ZONE() CPU_ZONE(__func__)
@@ -0,0 +1,132 @@
+#include "FileWatcher.h"
+
+#include "debug/Debug.h"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef __linux__
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory) :
+	m_Directory(directory) {
+	m_Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_Fd < 0) {
+		logWarning("could not create inotify instance");
+		return;
+	}
+
+	// editors often save by renaming a temporary file over the original
+	if (inotify_add_watch(
+			m_Fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO
+		) < 0) {
+		logWarning("could not watch ", directory);
+		close(m_Fd);
+		m_Fd = -1;
+	}
+}
+
+FileWatcher::~FileWatcher() {
+	if (m_Fd >= 0) {
+		close(m_Fd);
+	}
+}
+
+bool FileWatcher::isValid() const {
+	return m_Fd >= 0;
+}
+
+std::vector<std::filesystem::path>
+	FileWatcher::waitForChanges(const std::chrono::milliseconds timeout) {
+	std::vector<std::filesystem::path> changed;
+	if (m_Fd < 0) {
+		std::this_thread::sleep_for(timeout);
+		return changed;
+	}
+
+	pollfd pollInfo{ .fd = m_Fd, .events = POLLIN };
+	if (poll(&pollInfo, 1, (int)timeout.count()) <= 0) {
+		return changed;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		ssize_t length{ read(m_Fd, buffer, sizeof(buffer)) };
+		if (length <= 0) {
+			break;
+		}
+
+		for (ssize_t offset{}; offset < length;) {
+			const auto* event{ (const inotify_event*)(buffer + offset) };
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->len == 0 || (event->mask & IN_ISDIR)) {
+				continue;
+			}
+
+			std::filesystem::path path{ m_Directory / event->name };
+			if (std::find(changed.begin(), changed.end(), path) ==
+				changed.end()) {
+				changed.emplace_back(std::move(path));
+			}
+		}
+	}
+
+	return changed;
+}
+
+#else
+
+FileWatcher::FileWatcher(const std::filesystem::path& directory) :
+	m_Directory(directory) {
+	m_Valid = std::filesystem::is_directory(directory);
+	if (!m_Valid) {
+		logWarning("could not watch ", directory);
+		return;
+	}
+
+	scanWriteTimes(nullptr);
+}
+
+FileWatcher::~FileWatcher() {}
+
+bool FileWatcher::isValid() const {
+	return m_Valid;
+}
+
+std::vector<std::filesystem::path>
+	FileWatcher::waitForChanges(const std::chrono::milliseconds timeout) {
+	std::this_thread::sleep_for(timeout);
+
+	std::vector<std::filesystem::path> changed;
+	if (m_Valid) {
+		scanWriteTimes(&changed);
+	}
+
+	return changed;
+}
+
+void FileWatcher::scanWriteTimes(std::vector<std::filesystem::path>* changed
+) {
+	std::error_code error{};
+	for (const auto& entry :
+		 std::filesystem::directory_iterator(m_Directory, error)) {
+		if (!entry.is_regular_file(error)) {
+			continue;
+		}
+
+		auto writeTime{ entry.last_write_time(error) };
+		auto& knownTime{ m_WriteTimes[entry.path().string()] };
+		if (changed && knownTime != writeTime) {
+			changed->emplace_back(entry.path());
+		}
+		knownTime = writeTime;
+	}
+}
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// reports files in a directory that were written or moved in. uses inotify
+// on linux and compares write times everywhere else
+class FileWatcher {
+   public:
+	explicit FileWatcher(const std::filesystem::path& directory);
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	bool isValid() const;
+
+	// blocks for up to timeout and returns the files changed since the last
+	// call, each at most once
+	std::vector<std::filesystem::path>
+		waitForChanges(const std::chrono::milliseconds timeout);
+
+   private:
+	std::filesystem::path m_Directory;
+
+#ifdef __linux__
+	int m_Fd{ -1 };
+#else
+	void scanWriteTimes(std::vector<std::filesystem::path>* changed);
+
+	std::unordered_map<std::string, std::filesystem::file_time_type>
+		m_WriteTimes;
+	bool m_Valid{};
+#endif
+};
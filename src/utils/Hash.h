@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <span>
+
+// 64 bit fnv-1a, not cryptographic. good enough to tell shader binaries
+// apart
+inline uint64_t hashBytes(
+	const std::span<const char> bytes, uint64_t hash = 0xcbf29ce484222325
+) {
+	for (const char byte : bytes) {
+		hash ^= (uint8_t)byte;
+		hash *= 0x100000001b3;
+	}
+
+	return hash;
+}
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#include "debug/Debug.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+	if (m_Data) {
+		UnmapViewOfFile(m_Data);
+	}
+	if (m_Mapping) {
+		CloseHandle(m_Mapping);
+	}
+	if (m_File) {
+		CloseHandle(m_File);
+	}
+#else
+	if (m_Data) {
+		munmap(const_cast<char*>(m_Data), m_Size);
+	}
+#endif
+}
+
+std::shared_ptr<const MappedFile>
+	MappedFile::open(const std::filesystem::path& path) {
+	auto file{ std::make_shared<MappedFile>() };
+
+#ifdef _WIN32
+	HANDLE handle{ CreateFileW(
+		path.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		nullptr
+	) };
+	if (handle == INVALID_HANDLE_VALUE) {
+		logWarning("could not open ", path);
+		return nullptr;
+	}
+	file->m_File = handle;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(handle, &size)) {
+		logWarning("could not read the size of ", path);
+		return nullptr;
+	}
+	file->m_Size = (size_t)size.QuadPart;
+
+	// empty files can't be mapped, they have no data either way
+	if (file->m_Size == 0) {
+		return file;
+	}
+
+	file->m_Mapping =
+		CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!file->m_Mapping) {
+		logWarning("could not map ", path);
+		return nullptr;
+	}
+
+	file->m_Data = (const char*)MapViewOfFile(
+		file->m_Mapping, FILE_MAP_READ, 0, 0, 0
+	);
+#else
+	int fd{ ::open(path.c_str(), O_RDONLY | O_CLOEXEC) };
+	if (fd < 0) {
+		logWarning("could not open ", path);
+		return nullptr;
+	}
+
+	struct stat fileStat {};
+	if (fstat(fd, &fileStat) != 0) {
+		logWarning("could not read the size of ", path);
+		close(fd);
+		return nullptr;
+	}
+	file->m_Size = (size_t)fileStat.st_size;
+
+	// empty files can't be mapped, they have no data either way
+	if (file->m_Size == 0) {
+		close(fd);
+		return file;
+	}
+
+	// the mapping keeps the file referenced, the descriptor isn't needed
+	void* data{ mmap(nullptr, file->m_Size, PROT_READ, MAP_PRIVATE, fd, 0) };
+	close(fd);
+
+	if (data != MAP_FAILED) {
+		file->m_Data = (const char*)data;
+	}
+#endif
+
+	if (!file->m_Data) {
+		logWarning("could not map ", path);
+		return nullptr;
+	}
+
+	return file;
+}
+
+std::span<const char> MappedFile::getData() const {
+	return { m_Data, m_Size };
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <filesystem>
+#include <memory>
+#include <span>
+
+// read only view of a whole file, mapped rather than copied. the view stays
+// valid for the lifetime of the object
+class MappedFile {
+   public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// null when the file could not be opened or mapped
+	static std::shared_ptr<const MappedFile>
+		open(const std::filesystem::path& path);
+
+	std::span<const char> getData() const;
+
+   private:
+	const char* m_Data{};
+	size_t m_Size{};
+
+#ifdef _WIN32
+	void* m_File{};
+	void* m_Mapping{};
+#endif
+};
@@ -0,0 +1,107 @@
+#include "ThreadPool.h"
+#include "CpuProfiler.h"
+
+#include <string>
+
+ThreadPool::ThreadPool(const uint32_t workerCount) {
+	for (uint32_t i{}; i < workerCount; i++) {
+		m_Workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_BatchAvailable.notify_all();
+
+	for (auto& worker : m_Workers) {
+		worker.join();
+	}
+}
+
+uint32_t ThreadPool::getThreadCount() const {
+	return (uint32_t)m_Workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(
+	const uint32_t count,
+	const std::function<void(uint32_t index, uint32_t threadIndex)>& job
+) {
+	if (count == 0) {
+		return;
+	}
+
+	if (m_Workers.empty() || count == 1) {
+		for (uint32_t i{}; i < count; i++) {
+			job(i, 0);
+		}
+		return;
+	}
+
+	auto batch{ std::make_shared<Batch>() };
+	batch->job = &job;
+	batch->count = count;
+	batch->nextIndex = 0;
+	batch->remaining = count;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Batch = batch;
+		m_BatchGeneration++;
+	}
+	m_BatchAvailable.notify_all();
+
+	runBatch(*batch, 0);
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_BatchDone.wait(lock, [&]() {
+		return batch->remaining.load(std::memory_order_acquire) == 0;
+	});
+	m_Batch.reset();
+}
+
+void ThreadPool::workerLoop(const uint32_t threadIndex) {
+	CpuProfiler::setThreadName("worker " + std::to_string(threadIndex));
+
+	uint64_t seenGeneration{};
+	while (true) {
+		std::shared_ptr<Batch> batch;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_BatchAvailable.wait(lock, [&]() {
+				return m_Stopping || m_BatchGeneration != seenGeneration;
+			});
+			if (m_Stopping) {
+				return;
+			}
+
+			seenGeneration = m_BatchGeneration;
+			batch = m_Batch;
+		}
+
+		if (batch) {
+			runBatch(*batch, threadIndex);
+		}
+	}
+}
+
+void ThreadPool::runBatch(Batch& batch, const uint32_t threadIndex) {
+	while (true) {
+		const uint32_t index{
+			batch.nextIndex.fetch_add(1, std::memory_order_relaxed)
+		};
+		if (index >= batch.count) {
+			return;
+		}
+
+		(*batch.job)(index, threadIndex);
+
+		if (batch.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+			// the lock keeps the wake up from landing between the caller
+			// checking remaining and going to sleep
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_BatchDone.notify_all();
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of workers for fork join work. the thread calling parallelFor
+// works too and is thread index 0, workers are 1 and up
+class ThreadPool {
+   public:
+	explicit ThreadPool(const uint32_t workerCount);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// thread indices passed to jobs are below this
+	uint32_t getThreadCount() const;
+
+	// runs job(index, threadIndex) for every index below count and returns
+	// once all of them finished. not reentrant
+	void parallelFor(
+		const uint32_t count,
+		const std::function<void(uint32_t index, uint32_t threadIndex)>& job
+	);
+
+   private:
+	struct Batch {
+		const std::function<void(uint32_t, uint32_t)>* job;
+		uint32_t count;
+		std::atomic<uint32_t> nextIndex;
+		std::atomic<uint32_t> remaining;
+	};
+
+	void workerLoop(const uint32_t threadIndex);
+	void runBatch(Batch& batch, const uint32_t threadIndex);
+
+	std::vector<std::thread> m_Workers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_BatchAvailable;
+	std::condition_variable m_BatchDone;
+
+	// workers that wake up late keep the batch alive, they find no indices
+	// left and never touch the job
+	std::shared_ptr<Batch> m_Batch;
+	uint64_t m_BatchGeneration{};
+	bool m_Stopping{};
+};